@@ -1,11 +1,23 @@
 #ifndef TETORIO_TETORIO_H
 #define TETORIO_TETORIO_H
 
+#include "bot/BotEngine.h"
 #include "network/Server.h"
+#include "protocol/Message.h"
+#include "replay/ReplayArchive.h"
+#include "replay/ReplayWriter.h"
+#include "replay/VerificationPool.h"
+#include "room/Match.h"
+#include "room/Matchmaker.h"
+#include "room/SpectatorFeed.h"
+#include "room/UpdateEncoder.h"
 #include "room/RoomManager.h"
 #include "session/SessionManager.h"
 
+#include <chrono>
 #include <cstdint>
+#include <memory>
+#include <unordered_map>
 
 namespace tetorio {
 
@@ -70,6 +82,13 @@ public:
    */
   room::RoomManager &getRoomManager() { return roomManager_; }
 
+  /**
+   * set how often spectators get a frame, rounded to a divisor of the tick
+   * rate
+   * @param hz spectator frames per second, clamped to 1..TICK_RATE_HZ
+   */
+  void setSpectatorRate(int hz);
+
   /**
    * send data to a player by player ID
    * @param playerId player ID
@@ -95,6 +114,8 @@ public:
   void broadcastToAll(const uint8_t *data, size_t len);
 
 private:
+  struct RunningMatch;
+
   /**
    * handle client connection
    * @param clientFd client socket file descriptor
@@ -127,9 +148,345 @@ private:
    */
   void processSessionBuffer(uint32_t playerId);
 
+  /**
+   * handle one decoded message
+   * @param playerId player ID
+   * @param type message type
+   * @param payload pointer to payload
+   * @param len payload length
+   */
+  void handleMessage(uint32_t playerId, protocol::MessageType type,
+                     const uint8_t *payload, size_t len);
+
+  /**
+   * handle input message of a player in a playing room
+   * @param playerId player ID
+   * @param payload pointer to payload
+   * @param len payload length
+   * @return true if handled, false if malformed or out of sequence
+   */
+  bool handleInput(uint32_t playerId, const uint8_t *payload, size_t len);
+
+  /**
+   * handle placement message of a player in a playing room
+   * @param playerId player ID
+   * @param payload pointer to payload
+   * @param len payload length
+   * @return true if accepted, false if malformed or unreachable
+   */
+  bool handlePlacement(uint32_t playerId, const uint8_t *payload, size_t len);
+
+  /**
+   * check the prediction of a tagged move after it was applied
+   * @param running match of the player
+   * @param slot slot of the player
+   * @param tag prediction tag of the move
+   */
+  void checkPrediction(RunningMatch &running, size_t slot,
+                       const protocol::PredictionTag &tag);
+
+  /**
+   * send the ack or correction owed for the moves of the last batch
+   * @param playerId player ID
+   */
+  void flushPrediction(uint32_t playerId);
+
+  /**
+   * send a player its ID, resume token and where it is
+   * @param playerId player ID
+   */
+  void sendSessionInfo(uint32_t playerId);
+
+  /**
+   * take over a detached session from a fresh connection and send what the
+   * client missed as deltas from the versions it holds
+   * @param playerId player ID of the fresh session
+   * @param payload RESUME payload
+   * @param len payload length
+   * @return true if resumed, false if the token or payload is invalid
+   */
+  bool handleResume(uint32_t playerId, const uint8_t *payload, size_t len);
+
+  /**
+   * start watching a room, a running game is sent right away
+   * @param playerId player ID
+   * @param roomId room ID, 0 to stop watching
+   * @return true if handled, false if the room can not be watched
+   */
+  bool handleSpectate(uint32_t playerId, uint32_t roomId);
+
+  /**
+   * stop watching a room
+   * @param playerId player ID
+   * @return true if stopped, false if player was not spectating
+   */
+  bool stopSpectating(uint32_t playerId);
+
+  /**
+   * take the next spectator frame of a match and send it to spectators
+   * that are due, each gets one delta from the frame it last received;
+   * paced and backlogged spectators skip frames
+   * @param roomId room ID
+   * @param running match of the room
+   * @param final whether this is the last frame, sent regardless of pacing
+   */
+  void publishSpectatorFrame(uint32_t roomId, RunningMatch &running,
+                             bool final = false);
+
+  /**
+   * queue a shared message for every spectator of a room, in order with
+   * their frames
+   * @param room room being watched
+   * @param frame complete framed message
+   */
+  void sendToSpectators(const room::Room &room,
+                        const room::SpectatorFeed::Frame &frame);
+
+  /**
+   * stream an archived replay to a player
+   * @param playerId player ID
+   * @param gameId archive game ID
+   * @return true if queued, false if not found
+   */
+  bool handleReplayRequest(uint32_t playerId, uint64_t gameId);
+
+  /**
+   * send a framed message to a player
+   * @param playerId player ID
+   * @param type message type
+   * @param payload pointer to payload
+   * @param len payload length
+   */
+  void sendMessage(uint32_t playerId, protocol::MessageType type,
+                   const uint8_t *payload, size_t len);
+
+  /**
+   * handle game started in a room
+   * @param roomId room ID
+   */
+  void onGameStarted(uint32_t roomId);
+
+  /**
+   * handle game finished in a room
+   * @param roomId room ID
+   */
+  void onGameFinished(uint32_t roomId);
+
+  /**
+   * handle player leaving a room
+   * @param roomId room ID
+   * @param playerId player ID
+   */
+  void onPlayerLeft(uint32_t roomId, uint32_t playerId);
+
+  /**
+   * run one game tick: resolve garbage and send tick updates
+   */
+  void onTick();
+
+  /**
+   * send a timestamped ping to every session
+   */
+  void sendPings();
+
+  /**
+   * sample the send queue of everyone in a running match and adjust how
+   * often they get opponent boards and spectator frames
+   */
+  void updateRates();
+
+  /**
+   * sample the send queue of one session
+   * @param playerId player ID
+   */
+  void updateRate(uint32_t playerId);
+
+  /**
+   * queue a player for matchmaking
+   * @param playerId player ID
+   * @param latencyMs latency estimate of the player
+   * @return true if queued, false if the player is in a room
+   */
+  bool handleQueueJoin(uint32_t playerId, uint16_t latencyMs);
+
+  /**
+   * remove a player from the matchmaking queue
+   * @param playerId player ID
+   * @return true if removed, false if not queued
+   */
+  bool leaveQueue(uint32_t playerId);
+
+  /**
+   * form matches from the queue and start a room for each
+   */
+  void runMatchmaking();
+
+  /**
+   * seat a bot in the waiting room of its host
+   * @param playerId player ID of the host
+   * @param level bot level, see protocol::BOT_LEVEL_COUNT
+   * @return true if seated, false if not the host of a waiting room with a
+   *         free seat
+   */
+  bool handleAddBot(uint32_t playerId, uint8_t level);
+
+  /**
+   * start a practice game of a player against one bot
+   * @param playerId player ID
+   * @param level bot level, see protocol::BOT_LEVEL_COUNT
+   * @return true if started, false if the player is in a room
+   */
+  bool handlePractice(uint32_t playerId, uint8_t level);
+
+  /**
+   * create a bot and seat it in a room
+   * @param roomId room ID
+   * @param level bot level, see protocol::BOT_LEVEL_COUNT
+   * @return bot player ID, 0 if the room has no free seat
+   */
+  uint32_t addBot(uint32_t roomId, uint8_t level);
+
+  /**
+   * play the next input of every bot of a match that is due, and start a
+   * search for bots that finished their piece
+   * @param roomId room ID
+   * @param running match of the room
+   */
+  void driveBots(uint32_t roomId, RunningMatch &running);
+
+  /**
+   * take finished bot searches from the engine
+   */
+  void onBotResults();
+
+  /**
+   * remove the bots of rooms whose last human player left
+   */
+  void closeAbandonedRooms();
+
+  /**
+   * submit a finished match for anti-cheat verification
+   * @param room room of the match
+   * @param match finished match
+   */
+  void submitVerification(const room::Room &room, room::Match &match);
+
+  /**
+   * handle verification results from the pool
+   */
+  void onVerificationResults();
+
+  /**
+   * get milliseconds since a match started
+   * @param roomId room ID
+   * @return elapsed milliseconds, 0 if no match
+   */
+  uint64_t getMatchTimeMs(uint32_t roomId) const;
+
+  // game ticks per second
+  static constexpr int TICK_RATE_HZ = 30;
+
+  // spectator frames per second unless set with setSpectatorRate()
+  static constexpr int DEFAULT_SPECTATOR_RATE_HZ = 15;
+
+  // shared frames a spectator may have queued before it skips frames
+  static constexpr size_t MAX_SPECTATOR_BACKLOG = 4;
+
+  // ticks between send queue samples of match players and spectators
+  static constexpr uint64_t RATE_SAMPLE_TICKS = TICK_RATE_HZ / 5;
+
+  // ticks between checks for detached sessions past their grace period
+  static constexpr uint64_t DETACHED_CHECK_TICKS = TICK_RATE_HZ;
+
+  // ticks between sweeps freeing the send storage of idle connections
+  static constexpr uint64_t BUFFER_RECLAIM_TICKS = 10 * TICK_RATE_HZ;
+
+  // ticks between allocation audit reports of an audit build
+  static constexpr uint64_t AUDIT_REPORT_TICKS = 10 * TICK_RATE_HZ;
+
+  // ticks between pings to each session
+  static constexpr uint64_t PING_INTERVAL_TICKS = TICK_RATE_HZ;
+
+  // ticks between matchmaking passes
+  static constexpr uint64_t MATCHMAKING_INTERVAL_TICKS = TICK_RATE_HZ / 2;
+
+  // threads searching bot moves
+  static constexpr size_t BOT_SEARCH_THREADS = 2;
+
+  // search limits of each bot level
+  static constexpr bot::Difficulty BOT_DIFFICULTIES[protocol::BOT_LEVEL_COUNT] =
+      {bot::DIFFICULTY_EASY, bot::DIFFICULTY_NORMAL, bot::DIFFICULTY_HARD,
+       bot::DIFFICULTY_EXPERT};
+
+  // ticks between inputs of each bot level, easier bots also play slower
+  static constexpr uint64_t BOT_INPUT_INTERVAL_TICKS
+      [protocol::BOT_LEVEL_COUNT] = {6, 3, 2, 1};
+
   network::Server server_;
   session::SessionManager sessionManager_;
   room::RoomManager roomManager_;
+  replay::ReplayWriter replayWriter_;
+  replay::ArchiveReader replayArchive_; // read side of the writer's archive
+  replay::VerificationPool verifier_;
+  room::Matchmaker matchmaker_;
+  bot::BotEngine botEngine_;
+  int tickFd_ = -1; // timerfd driving onTick()
+  uint64_t tickCount_ = 0; // ticks run since start
+  int spectatorInterval_ = TICK_RATE_HZ / DEFAULT_SPECTATOR_RATE_HZ; // ticks
+  // scratch buffers reused across calls, so steady play does not allocate
+  std::vector<uint8_t> messageFrame_;      // sendMessage()
+  std::vector<uint8_t> predictionPayload_; // flushPrediction()
+  std::vector<uint8_t> tickFrame_;         // onTick()
+  std::vector<uint32_t> matchedPlayers_;   // runMatchmaking()
+  std::vector<bot::BotMove> botMoves_;     // onBotResults()
+
+  /**
+   * BotPlayer stores a server-side bot seated in a room.
+   */
+  struct BotPlayer {
+    uint32_t roomId = 0;            // room the bot sits in
+    bot::Difficulty difficulty;     // search limits
+    uint64_t inputInterval = 1;     // ticks between inputs
+    uint64_t nextInputTick = 0;     // tick the next input is due
+    std::vector<game::Input> path;  // inputs of the current piece
+    size_t nextInput = 0;           // next input of path
+    uint32_t pathPiece = 0;         // pieces placed when path was searched
+    bool searching = false;         // search for the current piece queued
+  };
+
+  std::unordered_map<uint32_t, BotPlayer> bots_; // bot player ID -> bot
+  uint32_t nextBotId_ = room::FIRST_BOT_ID;
+  std::vector<uint32_t> abandonedRooms_; // rooms left with bots only
+
+  /**
+   * Prediction stores the reconciliation state of a predicting player.
+   */
+  struct Prediction {
+    uint32_t lastSequence = 0;     // last applied move sequence
+    uint32_t confirmedVersion = 0; // board version the client is known to have
+    uint8_t epoch = 0;             // corrections sent so far (wraps)
+    bool pending = false;          // ack or correction owed for the batch
+    bool matched = false;          // last predicted hash was right
+    bool diverged = false;         // correction owed
+  };
+
+  /**
+   * RunningMatch stores a match and its monotonic start time.
+   */
+  struct RunningMatch {
+    std::unique_ptr<room::Match> match;
+    std::chrono::steady_clock::time_point startedAt;
+    std::vector<Prediction> predictions; // by slot
+    std::unique_ptr<room::UpdateEncoder> updates; // tick updates
+    std::unique_ptr<room::SpectatorFeed> spectatorFeed; // spectator frames
+    // frame version last sent to each spectator, 0 or absent if none
+    std::unordered_map<uint32_t, uint32_t> spectatorVersions;
+    // GAME_START message for spectators, on the lane of their frames
+    room::SpectatorFeed::Frame gameStart;
+    std::vector<size_t> botSlots; // slots played by bots
+  };
+
+  std::unordered_map<uint32_t, RunningMatch> matches_; // roomId -> match
 };
 
 } // namespace tetorio
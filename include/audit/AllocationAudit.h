@@ -0,0 +1,184 @@
+#ifndef TETORIO_AUDIT_ALLOCATION_AUDIT_H
+#define TETORIO_AUDIT_ALLOCATION_AUDIT_H
+
+#include "protocol/Message.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace audit {
+
+/**
+ * Phase tags what the event loop is doing when an allocation happens.
+ */
+enum class Phase : uint8_t {
+  IDLE = 0, // outside any tagged phase
+  ACCEPT,   // accepting connections and creating sessions
+  READ,     // receiving data and connection errors
+  DISPATCH, // handling a parsed message
+  WRITE,    // flushing send buffers
+  TIMERS,   // ticks and other watched fds
+};
+
+constexpr size_t PHASE_COUNT = 6;
+
+// message types are one byte on the wire
+constexpr size_t MESSAGE_TYPE_COUNT = 256;
+
+/**
+ * AllocationCounters stores heap activity of one phase or message type.
+ */
+struct AllocationCounters {
+  uint64_t allocations = 0; // operator new calls
+  uint64_t bytes = 0;       // bytes requested
+  uint64_t frees = 0;       // operator delete calls, phases only
+  uint64_t messages = 0;    // messages handled, message types only
+};
+
+/**
+ * IterationCounters stores how event loop iterations allocated.
+ */
+struct IterationCounters {
+  uint64_t iterations = 0;            // iterations ended
+  uint64_t allocatingIterations = 0;  // iterations with any allocation
+  uint64_t maxAllocations = 0;        // most allocations in one iteration
+};
+
+#ifdef TETORIO_ALLOC_AUDIT
+
+// the audit build replaces global operator new and delete and counts every
+// call of the calling thread; only the event loop thread is tagged
+
+constexpr bool ENABLED = true;
+
+/**
+ * PhaseScope tags allocations of the current thread with a phase until it
+ * goes out of scope.
+ */
+class PhaseScope {
+public:
+  explicit PhaseScope(Phase phase);
+  ~PhaseScope();
+  PhaseScope(const PhaseScope &) = delete;
+  PhaseScope &operator=(const PhaseScope &) = delete;
+
+private:
+  Phase previous_;
+};
+
+/**
+ * MessageScope tags allocations with the dispatch phase and charges them
+ * to a message type until it goes out of scope.
+ */
+class MessageScope {
+public:
+  explicit MessageScope(protocol::MessageType type);
+  ~MessageScope();
+  MessageScope(const MessageScope &) = delete;
+  MessageScope &operator=(const MessageScope &) = delete;
+
+private:
+  Phase previousPhase_;
+  int previousType_;
+  uint64_t startAllocations_;
+  uint64_t startBytes_;
+};
+
+/**
+ * NoAllocationGuard aborts with a report if the current thread allocates
+ * between its construction and destruction, for tests asserting that a
+ * steady state path is allocation free.
+ */
+class NoAllocationGuard {
+public:
+  explicit NoAllocationGuard(const char *what);
+  ~NoAllocationGuard();
+  NoAllocationGuard(const NoAllocationGuard &) = delete;
+  NoAllocationGuard &operator=(const NoAllocationGuard &) = delete;
+
+private:
+  const char *what_;
+  uint64_t startAllocations_;
+};
+
+/**
+ * end an event loop iteration, folding its allocations into the
+ * iteration counters
+ */
+void endIteration();
+
+/**
+ * get the allocations of the current thread so far
+ * @return allocation count
+ */
+uint64_t getThreadAllocations();
+
+/**
+ * get the counters of a phase
+ * @param phase phase
+ * @return counters since the last reset
+ */
+AllocationCounters getPhaseCounters(Phase phase);
+
+/**
+ * get the counters of a message type
+ * @param type message type
+ * @return counters since the last reset
+ */
+AllocationCounters getMessageCounters(protocol::MessageType type);
+
+/**
+ * get the iteration counters
+ * @return counters since the last reset
+ */
+IterationCounters getIterationCounters();
+
+/**
+ * write the counters of the current thread, allocations made while writing
+ * are not counted
+ * @param out output stream
+ */
+void report(std::ostream &out);
+
+/**
+ * clear the counters of the current thread
+ */
+void reset();
+
+#else // TETORIO_ALLOC_AUDIT
+
+// without the audit build every hook compiles to nothing
+
+constexpr bool ENABLED = false;
+
+class PhaseScope {
+public:
+  explicit PhaseScope(Phase) {}
+};
+
+class MessageScope {
+public:
+  explicit MessageScope(protocol::MessageType) {}
+};
+
+class NoAllocationGuard {
+public:
+  explicit NoAllocationGuard(const char *) {}
+};
+
+inline void endIteration() {}
+inline uint64_t getThreadAllocations() { return 0; }
+inline AllocationCounters getPhaseCounters(Phase) { return {}; }
+inline AllocationCounters getMessageCounters(protocol::MessageType) {
+  return {};
+}
+inline IterationCounters getIterationCounters() { return {}; }
+inline void report(std::ostream &) {}
+inline void reset() {}
+
+#endif // TETORIO_ALLOC_AUDIT
+
+} // namespace audit
+
+#endif // TETORIO_AUDIT_ALLOCATION_AUDIT_H
@@ -0,0 +1,126 @@
+#ifndef TETORIO_BOT_BOT_ENGINE_H
+#define TETORIO_BOT_BOT_ENGINE_H
+
+#include "Evaluator.h"
+#include "ThreadPool.h"
+#include "game/Bag.h"
+#include "game/Board.h"
+#include "game/Input.h"
+#include "game/MoveGenerator.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace bot {
+
+/**
+ * Difficulty stores bot search limits.
+ */
+struct Difficulty {
+  int depth = 1;         // number of pieces searched (current + preview)
+  int width = 1;         // beam width kept per depth
+  int timeBudgetMs = 10; // search time budget in milliseconds
+};
+
+// difficulty presets
+constexpr Difficulty DIFFICULTY_EASY{1, 1, 5};
+constexpr Difficulty DIFFICULTY_NORMAL{2, 4, 15};
+constexpr Difficulty DIFFICULTY_HARD{3, 8, 30};
+constexpr Difficulty DIFFICULTY_EXPERT{game::PREVIEW_SIZE + 1, 16, 60};
+
+/**
+ * BotRequest stores the game state a bot searches from.
+ */
+struct BotRequest {
+  uint32_t botId = 0;                             // bot player ID
+  game::Board board;                              // current board
+  game::CellType current = game::CellType::EMPTY; // active piece
+  game::CellType hold = game::CellType::EMPTY;    // held piece
+  bool holdAvailable = true;                      // hold not used this turn
+  std::array<uint8_t, game::PREVIEW_SIZE> preview{}; // Bag::getPreview()
+  Difficulty difficulty;                          // search limits
+};
+
+/**
+ * BotMove stores the result of a bot search.
+ */
+struct BotMove {
+  uint32_t botId = 0;              // bot player ID
+  bool found = false;              // false if every placement tops out
+  bool useHold = false;            // hold before placing
+  game::CellType piece = game::CellType::EMPTY; // piece placed
+  game::Placement placement;       // lock position
+  std::vector<game::Input> path;   // inputs from spawn including HOLD
+  double score = 0.0;              // score of the best line
+  int depthReached = 0;            // depth completed within time budget
+  size_t nodes = 0;                // nodes evaluated
+};
+
+/**
+ * BotEngine runs bot searches on a thread pool off the network thread.
+ * results are collected by the event loop with pollResults(), and the
+ * notify fd becomes readable whenever results are waiting.
+ */
+class BotEngine {
+public:
+  /**
+   * constructor
+   * @param threadCount number of search threads (0 = hardware concurrency)
+   * @param weights heuristic weights
+   */
+  explicit BotEngine(size_t threadCount = 0,
+                     const EvaluatorWeights &weights = EvaluatorWeights{});
+
+  /**
+   * destructor
+   */
+  ~BotEngine();
+
+  // copy constructor and assignment operator deleted to prevent copying
+  BotEngine(const BotEngine &) = delete;
+  BotEngine &operator=(const BotEngine &) = delete;
+
+  /**
+   * queue a search for a bot
+   * @param request game state to search from
+   * @return true if queued, false if a search for the bot is in flight
+   */
+  bool requestMove(const BotRequest &request);
+
+  /**
+   * collect finished searches, called from the event loop
+   * @param out output vector, finished moves are appended
+   * @return number of moves appended
+   */
+  size_t pollResults(std::vector<BotMove> &out);
+
+  /**
+   * get eventfd that becomes readable when results are waiting
+   * @return file descriptor, -1 if unavailable
+   */
+  int getNotifyFd() const { return notifyFd_; }
+
+  /**
+   * run beam search synchronously
+   * @param request game state to search from
+   * @param evaluator board evaluator
+   * @return best move found within the time budget
+   */
+  static BotMove search(const BotRequest &request, const Evaluator &evaluator);
+
+private:
+  Evaluator evaluator_;
+  ThreadPool pool_;
+  std::unordered_set<uint32_t> inFlight_; // bots searching (event loop only)
+  std::mutex resultMutex_;
+  std::vector<BotMove> results_;
+  int notifyFd_ = -1;
+};
+
+} // namespace bot
+
+#endif // TETORIO_BOT_BOT_ENGINE_H
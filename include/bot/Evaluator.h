@@ -0,0 +1,91 @@
+#ifndef TETORIO_BOT_EVALUATOR_H
+#define TETORIO_BOT_EVALUATOR_H
+
+#include "game/Board.h"
+#include "game/BoardBatch.h"
+
+namespace bot {
+
+/**
+ * BoardFeatures stores heuristic features of a board.
+ */
+struct BoardFeatures {
+  int aggregateHeight = 0; // sum of column heights
+  int maxHeight = 0;       // highest column
+  int holes = 0;           // empty cells below the top of their column
+  int bumpiness = 0;       // sum of height differences between neighbors
+  int wellDepth = 0;       // depth of the deepest single-column well
+};
+
+/**
+ * EvaluatorWeights stores weights of the board heuristic.
+ */
+struct EvaluatorWeights {
+  double aggregateHeight = -0.51;
+  double maxHeight = -0.05;
+  double holes = -0.36;
+  double bumpiness = -0.18;
+  double wellDepth = 0.08;
+  double linesCleared = 0.76;
+  double topOut = -1000.0;
+};
+
+/**
+ * Evaluator scores boards for bot search.
+ */
+class Evaluator {
+public:
+  /**
+   * constructor
+   * @param weights heuristic weights
+   */
+  explicit Evaluator(const EvaluatorWeights &weights = EvaluatorWeights{})
+      : weights_(weights) {}
+
+  /**
+   * compute heuristic features of a board
+   * @param board board to inspect
+   * @return board features
+   */
+  static BoardFeatures computeFeatures(const game::Board &board);
+
+  /**
+   * score a board after a placement
+   * @param board board after lines were cleared
+   * @param linesCleared number of lines the placement cleared
+   * @return score, higher is better
+   */
+  double evaluate(const game::Board &board, int linesCleared) const;
+
+  /**
+   * score the first lanes of a batch, same scores as evaluate()
+   * @param batch boards after lines were cleared
+   * @param count number of lanes to score
+   * @param linesCleared lines cleared per lane
+   * @param scores output, score per lane
+   */
+  void evaluateBatch(const game::BoardBatch &batch, int count,
+                     const int *linesCleared, double *scores) const;
+
+private:
+  /**
+   * fill the height based features from column heights
+   * @param heights column heights
+   * @param features features to fill
+   */
+  static void addHeightFeatures(const int *heights, BoardFeatures &features);
+
+  /**
+   * combine features into a score
+   * @param features board features
+   * @param linesCleared number of lines the placement cleared
+   * @return score, higher is better
+   */
+  double score(const BoardFeatures &features, int linesCleared) const;
+
+  EvaluatorWeights weights_;
+};
+
+} // namespace bot
+
+#endif // TETORIO_BOT_EVALUATOR_H
@@ -0,0 +1,98 @@
+#ifndef TETORIO_BOT_THREAD_POOL_H
+#define TETORIO_BOT_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bot {
+
+/**
+ * ThreadPool runs tasks on worker threads with work stealing.
+ * each worker owns a deque, taking its newest task first while idle workers
+ * steal the oldest task of another worker.
+ */
+class ThreadPool {
+public:
+  // task type run by workers
+  using Task = std::function<void()>;
+
+  /**
+   * constructor
+   * @param threadCount number of worker threads (0 = hardware concurrency)
+   */
+  explicit ThreadPool(size_t threadCount = 0);
+
+  /**
+   * destructor, waits for workers to exit
+   */
+  ~ThreadPool();
+
+  // copy constructor and assignment operator deleted to prevent copying
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /**
+   * submit a task, tasks submitted from a worker stay on that worker
+   * @param task task to run
+   */
+  void submit(Task task);
+
+  /**
+   * stop workers, running tasks finish and queued tasks are discarded
+   */
+  void stop();
+
+  /**
+   * get number of worker threads
+   * @return worker count
+   */
+  size_t getThreadCount() const { return threads_.size(); }
+
+  /**
+   * get number of tasks waiting to run
+   * @return pending task count
+   */
+  size_t getPendingCount() const { return pending_.load(); }
+
+private:
+  /**
+   * Worker stores task deque of one worker thread.
+   */
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  /**
+   * worker thread loop
+   * @param index worker index
+   */
+  void run(size_t index);
+
+  /**
+   * take a task from own deque or steal from others
+   * @param index worker index
+   * @param task output task
+   * @return true if a task was taken
+   */
+  bool take(size_t index, Task &task);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+  std::mutex sleepMutex_;
+  std::condition_variable wakeup_;
+  std::atomic<bool> running_{true};
+  std::atomic<size_t> pending_{0};
+  std::atomic<size_t> nextWorker_{0};
+};
+
+} // namespace bot
+
+#endif // TETORIO_BOT_THREAD_POOL_H
@@ -1,10 +1,11 @@
 #ifndef TETORIO_GAME_BAG_H
 #define TETORIO_GAME_BAG_H
 
+#include "PieceSequence.h"
+
 #include <array>
 #include <cstdint>
-#include <deque>
-#include <random>
+#include <memory>
 
 namespace game {
 
@@ -14,7 +15,8 @@ constexpr int PREVIEW_SIZE = 5;
 
 /**
  * Bag is 7-Bag randomizer system on game.
- * each player should have their own Bag with a unique seed.
+ * the pieces come from PieceSequence which may be shared by all players in a
+ * room, in which case each Bag only keeps its own index into the sequence.
  */
 class Bag {
 public:
@@ -24,6 +26,12 @@ public:
    */
   explicit Bag(uint64_t seed = 0);
 
+  /**
+   * constructor reading from a shared sequence
+   * @param sequence piece sequence shared with other players
+   */
+  explicit Bag(std::shared_ptr<PieceSequence> sequence);
+
   /**
    * destructor
    */
@@ -35,6 +43,12 @@ public:
    */
   void reset(uint64_t seed);
 
+  /**
+   * reset the bag to the start of a shared sequence
+   * @param sequence piece sequence shared with other players
+   */
+  void reset(std::shared_ptr<PieceSequence> sequence);
+
   /**
    * get the current seed
    * @return current seed
@@ -62,25 +76,30 @@ public:
   std::array<uint8_t, PREVIEW_SIZE> getPreview() const;
 
   /**
-   * get total number of pieces generated so far
-   * @return count of piec
+   * get total number of pieces consumed so far
+   * @return count of pieces, which is also the index of the next piece
    */
   uint32_t getPieceCount() const;
 
-private:
   /**
-   * generate new shuffled bag and add to queue
+   * move the bag to a position in the sequence (e.g. restoring a snapshot)
+   * @param count number of pieces consumed
+   */
+  void setPieceCount(uint32_t count);
+
+  /**
+   * get the sequence the bag reads from
+   * @return reference to the piece sequence
    */
-  void generateBag();
+  const PieceSequence &getSequence() const { return *sequence_; }
 
+private:
   /**
-   * ensure queue has enough pieces for preview
+   * ensure sequence has enough pieces for preview
    */
   void ensureQueue();
 
-  uint64_t seed_;
-  std::mt19937_64 rng_;
-  std::deque<uint8_t> queue_;
+  std::shared_ptr<PieceSequence> sequence_;
   uint32_t pieceCount_;
 };
 
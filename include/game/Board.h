@@ -11,6 +11,9 @@ constexpr int BOARD_WIDTH = 10;
 constexpr int BOARD_HEIGHT = 20;
 constexpr int BOARD_BUFFER = 4;
 
+// row bitmask with every column occupied
+constexpr uint16_t FULL_ROW_MASK = (1u << BOARD_WIDTH) - 1;
+
 /**
  * CellType matches cell values.
  */
@@ -37,6 +40,17 @@ constexpr uint8_t CELL_J = static_cast<uint8_t>(CellType::J);
 constexpr uint8_t CELL_L = static_cast<uint8_t>(CellType::L);
 constexpr uint8_t CELL_GARBAGE = static_cast<uint8_t>(CellType::GARBAGE);
 
+// most garbage segments applied in one write
+constexpr int MAX_GARBAGE_SEGMENTS = 8;
+
+/**
+ * GarbageSegment stores consecutive garbage lines sharing a hole.
+ */
+struct GarbageSegment {
+  uint8_t lines = 0;      // number of lines
+  uint8_t holeColumn = 0; // column index for the hole (0-9)
+};
+
 /**
  * Board represents board for game.
  */
@@ -124,6 +138,15 @@ x   * @param x x coordinate
    */
   bool addGarbageLines(int lines, int holeColumn);
 
+  /**
+   * add several garbage segments from the bottom in one shift, the first
+   * segment ends up on top as if the segments were added in order
+   * @param segments garbage segments
+   * @param count number of segments
+   * @return true if successful, false if would cause game over
+   */
+  bool addGarbage(const GarbageSegment *segments, int count);
+
   /**
    * check if the board has any blocks above the visible area
    * @return true if blocks exist above visible area, false otherwise
@@ -153,10 +176,103 @@ x   * @param x x coordinate
     return grid_;
   }
 
+  /**
+   * get occupancy bitmask of a row
+   * @param y y coordinate of the row
+   * @return bit x set if cell (x, y) is occupied, 0 if out of bounds
+   */
+  uint16_t getRowMask(int y) const {
+    if (y < 0 || y >= BOARD_HEIGHT + BOARD_BUFFER) {
+      return 0;
+    }
+    return rowMask_[y];
+  }
+
+  /**
+   * get the version of the board, incremented on every modification
+   * @return current board version
+   */
+  uint32_t getVersion() const { return version_; }
+
+  /**
+   * get the version at which a row was last modified
+   * @param y y coordinate of the row
+   * @return row version, 0 if out of bounds
+   */
+  uint32_t getRowVersion(int y) const;
+
+  /**
+   * get mask of rows modified after a given version
+   * @param version version the caller already has
+   * @return bit y set if row y changed after version
+   */
+  uint32_t getRowsChangedSince(uint32_t version) const;
+
+  /**
+   * get mask of rows modified since the last clearDirtyRows()
+   * @return bit y set if row y is dirty
+   */
+  uint32_t getDirtyRows() const { return dirtyRows_; }
+
+  /**
+   * get the version at which the dirty mask was last cleared
+   * @return version of the last clearDirtyRows()
+   */
+  uint32_t getDirtyBaseVersion() const { return dirtyBaseVersion_; }
+
+  /**
+   * clear the dirty mask after changes have been sent
+   */
+  void clearDirtyRows() {
+    dirtyRows_ = 0;
+    dirtyBaseVersion_ = version_;
+  }
+
+  /**
+   * get the zobrist hash of the board, maintained incrementally
+   * @return 64-bit board hash
+   */
+  uint64_t getHash() const { return hash_; }
+
+  /**
+   * compute the zobrist hash from scratch
+   * @return 64-bit board hash, equal to getHash()
+   */
+  uint64_t computeHash() const;
+
 private:
+  /**
+   * record that a row changed in the current version
+   * @param y y coordinate of the row
+   */
+  void markRowDirty(int y) {
+    dirtyRows_ |= 1u << y;
+    rowVersion_[y] = version_;
+  }
+
+  /**
+   * replace the hash of a row and update the board hash
+   * @param y y coordinate of the row
+   * @param rowHash new row hash
+   */
+  void setRowHash(int y, uint64_t rowHash);
+
   // grid[y][x]: y=0 is bottom, y=23 is top (buffer)
   std::array<std::array<uint8_t, BOARD_WIDTH>, BOARD_HEIGHT + BOARD_BUFFER>
       grid_;
+
+  // occupancy bitmask per row, kept in sync with grid_
+  std::array<uint16_t, BOARD_HEIGHT + BOARD_BUFFER> rowMask_{};
+
+  // change tracking for delta snapshots
+  std::array<uint32_t, BOARD_HEIGHT + BOARD_BUFFER> rowVersion_{};
+  uint32_t version_ = 0;
+  uint32_t dirtyRows_ = 0;
+  uint32_t dirtyBaseVersion_ = 0;
+
+  // zobrist hash of each row (position independent) and of the board
+  std::array<uint64_t, BOARD_HEIGHT + BOARD_BUFFER> rowHash_{};
+  uint64_t hash_ = 0;
 };
 
 } // namespace game
@@ -0,0 +1,128 @@
+#ifndef TETORIO_GAME_BOARD_BATCH_H
+#define TETORIO_GAME_BOARD_BATCH_H
+
+#include "Board.h"
+#include "Piece.h"
+
+#include <array>
+#include <cstdint>
+
+namespace game {
+
+// number of boards processed together by batch kernels
+constexpr int BATCH_LANES = 16;
+
+/**
+ * SimdLevel matches kernel implementations selectable at runtime.
+ */
+enum class SimdLevel : uint8_t {
+  SCALAR = 0, // portable fallback
+  SSE2 = 1,   // 8 lanes per register, two registers per row
+  AVX2 = 2    // 16 lanes per register, one register per row
+};
+
+/**
+ * BoardBatch stores row masks of up to 16 boards interleaved by row,
+ * rows[y][lane], so each kernel step handles the same row of every board.
+ * only occupancy is kept, cell types are not part of the batch.
+ * every kernel gives the same result as the matching Board method.
+ */
+class BoardBatch {
+public:
+  // per-lane results
+  using LaneMasks = std::array<uint32_t, BATCH_LANES>;
+  using LaneCounts = std::array<uint8_t, BATCH_LANES>;
+  using LaneHeights = std::array<std::array<uint8_t, BOARD_WIDTH>, BATCH_LANES>;
+
+  /**
+   * constructor, all lanes empty
+   */
+  BoardBatch();
+
+  /**
+   * destructor
+   */
+  ~BoardBatch() = default;
+
+  /**
+   * set all lanes to empty boards
+   */
+  void clear();
+
+  /**
+   * copy row masks of a board into a lane
+   * @param lane lane index (0-15)
+   * @param board board to copy
+   */
+  void load(int lane, const Board &board);
+
+  /**
+   * get row mask of a lane
+   * @param lane lane index (0-15)
+   * @param y y coordinate of the row
+   * @return row mask, 0 if out of range
+   */
+  uint16_t getRowMask(int lane, int y) const;
+
+  /**
+   * test one piece position against every lane, same as Piece::collides
+   * @param type piece type
+   * @param rotation rotation state
+   * @param x x position
+   * @param y y position
+   * @return bit lane set if the piece collides on that lane
+   */
+  uint32_t collides(CellType type, Rotation rotation, int x, int y) const;
+
+  /**
+   * find full rows of every lane, same as Board::isRowFull
+   * @param out bit y set if row y of the lane is full
+   */
+  void fullRows(LaneMasks &out) const;
+
+  /**
+   * compute column heights of every lane, same as Board::getColumnHeight
+   * @param out column heights per lane
+   */
+  void columnHeights(LaneHeights &out) const;
+
+  /**
+   * count holes of every lane, empty cells below the top of their column
+   * @param out hole count per lane
+   */
+  void holeCounts(LaneCounts &out) const;
+
+  /**
+   * clear full rows of every lane, same as Board::clearFullRows
+   * @param cleared number of cleared rows per lane
+   */
+  void clearFullRows(LaneCounts &cleared);
+
+  /**
+   * get the kernel implementation in use
+   * @return active simd level
+   */
+  static SimdLevel getSimdLevel();
+
+  /**
+   * force a kernel implementation, capped to what the cpu supports
+   * @param level requested simd level
+   * @return simd level actually selected
+   */
+  static SimdLevel setSimdLevel(SimdLevel level);
+
+  /**
+   * detect the best kernel implementation supported by the cpu
+   * @return best simd level
+   */
+  static SimdLevel detectSimdLevel();
+
+private:
+  // rows_[y][lane], 32-byte aligned for vector loads
+  alignas(32) std::array<std::array<uint16_t, BATCH_LANES>,
+                         BOARD_HEIGHT + BOARD_BUFFER> rows_;
+};
+
+} // namespace game
+
+#endif // TETORIO_GAME_BOARD_BATCH_H
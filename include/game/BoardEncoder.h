@@ -0,0 +1,86 @@
+#ifndef TETORIO_GAME_BOARD_ENCODER_H
+#define TETORIO_GAME_BOARD_ENCODER_H
+
+#include "Board.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace game {
+
+/**
+ * BoardFrameType matches the first byte of an encoded board frame.
+ */
+enum class BoardFrameType : uint8_t {
+  KEYFRAME = 0, // full board, rows not listed are empty
+  DELTA = 1     // rows changed since base version
+};
+
+// packed size of one row (4 bits per cell)
+constexpr size_t PACKED_ROW_SIZE = BOARD_WIDTH / 2;
+
+/**
+ * BoardEncoder encodes boards into keyframe and delta frames.
+ *
+ * frame layout (little endian):
+ *   u8  frame type
+ *   u32 board version
+ *   u32 base version (delta only)
+ *   u24 row mask, bit y set if row y is present
+ *   runs of [u8 count][5 bytes packed row] covering the present rows in
+ *   ascending order, where count consecutive present rows share the same
+ *   content and each byte packs cell x in the low nibble and x + 1 in the
+ *   high nibble
+ */
+class BoardEncoder {
+public:
+  /**
+   * append keyframe of the board to output
+   * @param board board to encode
+   * @param out output buffer
+   * @return number of bytes appended
+   */
+  static size_t encodeKeyframe(const Board &board, std::vector<uint8_t> &out);
+
+  /**
+   * append delta against a version the client has acknowledged,
+   * falls back to keyframe if base version is unknown
+   * @param board board to encode
+   * @param baseVersion version acknowledged by the client (0 = none)
+   * @param out output buffer
+   * @return number of bytes appended
+   */
+  static size_t encodeDelta(const Board &board, uint32_t baseVersion,
+                            std::vector<uint8_t> &out);
+
+  /**
+   * apply an encoded frame to a board
+   * @param data pointer to frame data
+   * @param len length of frame data
+   * @param board board to update
+   * @param version version the board is at, updated to the frame version
+   * @return bytes consumed, 0 if frame is malformed or base version mismatch,
+   *         in which case board and version are left unchanged
+   */
+  static size_t decode(const uint8_t *data, size_t len, Board &board,
+                       uint32_t &version);
+
+private:
+  /**
+   * append header and rows selected by mask
+   * @param board board to encode
+   * @param type frame type
+   * @param baseVersion base version written for delta frames
+   * @param rowMask rows to encode
+   * @param out output buffer
+   * @return number of bytes appended
+   */
+  static size_t encodeRows(const Board &board, BoardFrameType type,
+                           uint32_t baseVersion, uint32_t rowMask,
+                           std::vector<uint8_t> &out);
+};
+
+} // namespace game
+
+#endif // TETORIO_GAME_BOARD_ENCODER_H
@@ -0,0 +1,256 @@
+#ifndef TETORIO_GAME_GAME_H
+#define TETORIO_GAME_GAME_H
+
+#include "Bag.h"
+#include "Board.h"
+#include "Input.h"
+#include "Piece.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace game {
+
+/**
+ * InputResult stores the outcome of one input.
+ */
+struct InputResult {
+  bool accepted = false;  // input changed the state
+  bool locked = false;    // active piece was locked
+  bool spin = false;      // lock was a spin
+  int linesCleared = 0;   // lines cleared by the lock
+  int attack = 0;         // garbage lines sent by the lock
+  bool toppedOut = false; // game over caused by the input
+};
+
+/**
+ * PlacementClaim stores a lock position reported by a client.
+ */
+struct PlacementClaim {
+  uint32_t pieceIndex = 0;          // pieces placed before this one
+  int x = 0;                        // x position of the piece
+  int y = 0;                        // y position of the piece
+  Rotation rotation = Rotation::R0; // rotation of the piece
+  bool spin = false;                // reached by a rotation while immobile
+  bool hold = false;                // hold before placing
+};
+
+/**
+ * Game simulates one player: board, bag, active piece and hold.
+ * it advances only on inputs and garbage, so replaying the same calls
+ * reproduces the same state.
+ */
+class Game {
+public:
+  /**
+   * constructor reading from a shared sequence
+   * @param sequence piece sequence shared with other players
+   */
+  explicit Game(std::shared_ptr<PieceSequence> sequence);
+
+  /**
+   * constructor with a private sequence
+   * @param seed random seed
+   */
+  explicit Game(uint64_t seed);
+
+  /**
+   * destructor
+   */
+  ~Game() = default;
+
+  /**
+   * apply one player input
+   * @param input input to apply
+   * @return result of the input
+   */
+  InputResult applyInput(Input input);
+
+  /**
+   * place the active piece at a claimed position and lock it
+   * @param claim claimed placement, checked for reachability from spawn
+   * @return result of the lock, rejected if the claim is not reachable
+   */
+  InputResult applyPlacement(const PlacementClaim &claim);
+
+  /**
+   * add garbage lines to the board, pushing the active piece up if needed
+   * @param lines number of garbage lines
+   * @param holeColumn column index for the hole (0-9)
+   * @return true if applied, false if the player topped out
+   */
+  bool receiveGarbage(int lines, int holeColumn);
+
+  /**
+   * add several garbage segments in one shift, pushing the active piece up
+   * @param segments garbage segments, the first ends up on top
+   * @param count number of segments
+   * @return true if applied, false if the player topped out
+   */
+  bool receiveGarbage(const GarbageSegment *segments, int count);
+
+  /**
+   * mark the player as topped out (e.g. left the game)
+   */
+  void forfeit() { toppedOut_ = true; }
+
+  /**
+   * check if the player has topped out
+   * @return true if game over for this player
+   */
+  bool isToppedOut() const { return toppedOut_; }
+
+  /**
+   * get the board
+   * @return reference to the board
+   */
+  const Board &getBoard() const { return board_; }
+
+  /**
+   * get the bag
+   * @return reference to the bag
+   */
+  const Bag &getBag() const { return bag_; }
+
+  /**
+   * get the active piece
+   * @return reference to the active piece
+   */
+  const Piece &getActivePiece() const { return active_; }
+
+  /**
+   * get the held piece type
+   * @return held piece, CellType::EMPTY if none
+   */
+  CellType getHold() const { return hold_; }
+
+  /**
+   * check if the active piece may still be held
+   * @return true if hold was not used since the last lock
+   */
+  bool isHoldAvailable() const { return !holdUsed_; }
+
+  /**
+   * get the number of locked pieces
+   * @return locked piece count
+   */
+  uint32_t getPiecesPlaced() const { return piecesPlaced_; }
+
+  /**
+   * get the total number of cleared lines
+   * @return cleared line count
+   */
+  uint32_t getLinesCleared() const { return linesCleared_; }
+
+  /**
+   * get the total number of garbage lines sent
+   * @return attack total
+   */
+  uint32_t getAttackSent() const { return attackSent_; }
+
+  /**
+   * get hash of board, active piece, hold and queue position
+   * @return game state hash
+   */
+  uint64_t getStateHash() const;
+
+  /**
+   * append a snapshot of the whole game state
+   * @param out output buffer
+   */
+  void encodeSnapshot(std::vector<uint8_t> &out) const {
+    encodeSnapshot(out, 0);
+  }
+
+  /**
+   * append a snapshot whose board is a delta against a known version
+   * @param out output buffer
+   * @param baseVersion board version the receiver has (0 = keyframe)
+   */
+  void encodeSnapshot(std::vector<uint8_t> &out, uint32_t baseVersion) const;
+
+  /**
+   * restore state from a snapshot, the game must read the same sequence
+   * @param data pointer to snapshot data
+   * @param len length of data
+   * @return bytes consumed, 0 if malformed
+   */
+  size_t decodeSnapshot(const uint8_t *data, size_t len) {
+    uint32_t boardVersion = 0;
+    return decodeSnapshot(data, len, boardVersion);
+  }
+
+  /**
+   * restore state from a snapshot that may hold a board delta
+   * @param data pointer to snapshot data
+   * @param len length of data
+   * @param boardVersion version the board is at, updated to the new version
+   * @return bytes consumed, 0 if malformed or base version mismatch, in
+   *         which case the game is left unchanged
+   */
+  size_t decodeSnapshot(const uint8_t *data, size_t len,
+                        uint32_t &boardVersion);
+
+  /**
+   * get attack for a clear
+   * @param lines number of cleared lines
+   * @param spin whether the lock was a spin
+   * @param combo consecutive clearing locks before this one
+   * @param backToBack whether the previous difficult clear chains
+   * @param perfectClear whether the board is empty after the clear
+   * @return garbage lines to send
+   */
+  static int computeAttack(int lines, bool spin, int combo, bool backToBack,
+                           bool perfectClear);
+
+private:
+  // offset added to piece coordinates in snapshots
+  static constexpr int SNAPSHOT_XY_OFFSET = 8;
+
+  // most pieces placed a restored snapshot may claim
+  static constexpr uint64_t MAX_SNAPSHOT_PIECES = 1u << 24;
+
+  /**
+   * spawn the next piece from the bag
+   */
+  void spawnNext();
+
+  /**
+   * spawn a specific piece type
+   * @param type piece type
+   */
+  void spawn(CellType type);
+
+  /**
+   * try to rotate the active piece with kicks
+   * @param to target rotation
+   * @param half180 whether to use 180 kick table
+   * @return true if rotated
+   */
+  bool tryRotate(Rotation to, bool half180);
+
+  /**
+   * lock active piece, clear lines and spawn next
+   * @param result result to fill
+   */
+  void lockActive(InputResult &result);
+
+  Board board_;
+  Bag bag_;
+  Piece active_;
+  CellType hold_ = CellType::EMPTY;
+  bool holdUsed_ = false;         // hold used since last lock
+  bool lastMoveRotation_ = false; // last successful move was a rotation
+  bool toppedOut_ = false;
+  bool backToBack_ = false;       // last clear was a tetris or spin clear
+  int combo_ = 0;                 // consecutive clearing locks
+  uint32_t piecesPlaced_ = 0;
+  uint32_t linesCleared_ = 0;
+  uint32_t attackSent_ = 0;
+};
+
+} // namespace game
+
+#endif // TETORIO_GAME_GAME_H
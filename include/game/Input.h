@@ -0,0 +1,25 @@
+#ifndef TETORIO_GAME_INPUT_H
+#define TETORIO_GAME_INPUT_H
+
+#include <cstdint>
+
+namespace game {
+
+/**
+ * Input matches player inputs applied to the active piece.
+ */
+enum class Input : uint8_t {
+  NONE = 0,
+  MOVE_LEFT = 1,  // move one column left
+  MOVE_RIGHT = 2, // move one column right
+  ROTATE_CW = 3,  // rotate clockwise with SRS kicks
+  ROTATE_CCW = 4, // rotate counter-clockwise with SRS kicks
+  ROTATE_180 = 5, // rotate 180 degrees with 180 kicks
+  SOFT_DROP = 6,  // move one row down
+  HARD_DROP = 7,  // drop to the floor and lock
+  HOLD = 8        // swap active piece with hold
+};
+
+} // namespace game
+
+#endif // TETORIO_GAME_INPUT_H
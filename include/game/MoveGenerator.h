@@ -0,0 +1,193 @@
+#ifndef TETORIO_GAME_MOVE_GENERATOR_H
+#define TETORIO_GAME_MOVE_GENERATOR_H
+
+#include "Board.h"
+#include "Input.h"
+#include "Piece.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace game {
+
+/**
+ * Placement stores a reachable lock position of a piece.
+ */
+struct Placement {
+  int x = 0;                         // x position of the piece
+  int y = 0;                         // y position of the piece
+  Rotation rotation = Rotation::R0;  // rotation of the piece
+  bool spin = false;                 // locked by rotation while immobile
+  uint16_t state = 0;                // search state, used to rebuild path
+};
+
+/**
+ * MoveGenerator enumerates every lock position reachable from spawn.
+ *
+ * it runs breadth-first search over (x, y, rotation, last move was rotation)
+ * using left/right shifts, one-row soft drops and SRS kicks including 180
+ * kicks, so tucks and spins are found. visited states live in a fixed
+ * bitset and lock positions are deduplicated by the cells they occupy, so
+ * a generation does not allocate once the output vector has grown.
+ */
+class MoveGenerator {
+public:
+  /**
+   * constructor
+   */
+  MoveGenerator() = default;
+
+  /**
+   * destructor
+   */
+  ~MoveGenerator() = default;
+
+  /**
+   * generate all distinct lock positions for a piece type
+   * @param board board to search on
+   * @param type piece type spawned at its spawn position
+   * @param out output vector, cleared before filling
+   * @return number of placements, 0 if the spawn position is blocked
+   */
+  size_t generate(const Board &board, CellType type,
+                  std::vector<Placement> &out);
+
+  /**
+   * rebuild the input path of a placement from the last generate() call
+   * @param placement placement returned by the last generate()
+   * @param path output inputs from spawn, ending with HARD_DROP
+   * @return true if built, false if the state was not visited
+   */
+  bool buildPath(const Placement &placement, std::vector<Input> &path) const;
+
+  /**
+   * find a reachable placement occupying the same cells as a given position
+   * @param board board to search on
+   * @param type piece type
+   * @param x claimed x position
+   * @param y claimed y position
+   * @param rotation claimed rotation
+   * @param spin whether the position must be reached by a spin
+   * @param out matching placement if found
+   * @return true if reachable, false otherwise
+   */
+  bool findPlacement(const Board &board, CellType type, int x, int y,
+                     Rotation rotation, bool spin, Placement &out);
+
+  /**
+   * check if a position is reached by rotating at spawn, shifting along the
+   * spawn row and dropping straight down, without a search
+   * @param board board to test against
+   * @param type piece type
+   * @param x x position
+   * @param y y position
+   * @param rotation rotation state
+   * @return true if reachable that way, false if unknown
+   */
+  static bool isDropReachable(const Board &board, CellType type, int x, int y,
+                              Rotation rotation);
+
+  /**
+   * check if a position is reached by a drop followed by shifts along its
+   * row (a tuck), without a search
+   * @param board board to test against
+   * @param type piece type
+   * @param x x position
+   * @param y y position
+   * @param rotation rotation state
+   * @return true if reachable that way, false if unknown
+   */
+  static bool isTuckReachable(const Board &board, CellType type, int x, int y,
+                              Rotation rotation);
+
+  /**
+   * check if a position is reached by one kicked rotation from a drop or
+   * tuck position, without a search
+   * @param board board to test against
+   * @param type piece type
+   * @param x x position
+   * @param y y position
+   * @param rotation rotation state
+   * @return true if reachable that way, false if unknown
+   */
+  static bool isSpinReachable(const Board &board, CellType type, int x, int y,
+                              Rotation rotation);
+
+  /**
+   * check if a piece cannot move left, right or up
+   * @param board board to test against
+   * @param type piece type
+   * @param rotation rotation state
+   * @param x x position
+   * @param y y position
+   * @return true if immobile, false otherwise
+   */
+  static bool isImmobile(const Board &board, CellType type, Rotation rotation,
+                         int x, int y);
+
+  /**
+   * get key identifying the cells a piece occupies
+   * @param type piece type
+   * @param rotation rotation state
+   * @param x x position
+   * @param y y position
+   * @return footprint key, equal for positions covering the same cells
+   */
+  static uint64_t footprint(CellType type, Rotation rotation, int x, int y);
+
+private:
+  // state space: x in [-X_OFFSET, STATE_X - X_OFFSET), y in [0, STATE_Y)
+  static constexpr int X_OFFSET = 3;
+  static constexpr int STATE_X = 16;
+  static constexpr int STATE_Y = 32;
+  static constexpr int STATE_COUNT = STATE_X * STATE_Y * 4 * 2;
+  static constexpr uint16_t NO_PARENT = 0xFFFF;
+
+  // open-addressing table for footprint deduplication, at least twice the
+  // state count so every resting state fits and probes stay short
+  static constexpr int FOOTPRINT_TABLE_BITS = 13;
+  static constexpr size_t FOOTPRINT_TABLE_SIZE = size_t{1}
+                                                 << FOOTPRINT_TABLE_BITS;
+  static_assert(FOOTPRINT_TABLE_SIZE >= 2 * STATE_COUNT,
+                "footprint table must hold every state");
+
+  /**
+   * visit a state if it is new
+   * @param x x position
+   * @param y y position
+   * @param rotation rotation state
+   * @param rotated whether the state was reached by rotation
+   * @param parent parent state
+   * @param input input leading from parent
+   */
+  void visit(int x, int y, Rotation rotation, bool rotated, uint16_t parent,
+             Input input);
+
+  /**
+   * insert footprint into dedupe table
+   * @param key footprint key
+   * @return true if inserted, false if already present
+   */
+  bool insertFootprint(uint64_t key);
+
+  // search buffers, reused across generations
+  std::array<uint64_t, STATE_COUNT / 64> visited_{};
+  std::array<uint16_t, STATE_COUNT> parent_{};
+  std::array<Input, STATE_COUNT> parentInput_{};
+  std::array<uint16_t, STATE_COUNT> queue_{};
+  size_t queueTail_ = 0;
+
+  // footprint table stamped per generation to avoid clearing
+  std::array<uint64_t, FOOTPRINT_TABLE_SIZE> footprintKeys_{};
+  std::array<uint32_t, FOOTPRINT_TABLE_SIZE> footprintStamps_{};
+  uint32_t generation_ = 0;
+
+  // placements buffer for findPlacement()
+  std::vector<Placement> scratch_;
+};
+
+} // namespace game
+
+#endif // TETORIO_GAME_MOVE_GENERATOR_H
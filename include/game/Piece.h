@@ -37,6 +37,9 @@ public:
   // 4x4 shape matrix
   using Shape = std::array<std::array<bool, 4>, 4>;
 
+  // shape rows as bitmasks, bit c set if shape[row][c] is filled
+  using RowMasks = std::array<uint16_t, 4>;
+
   /**
    * create a piece of given type at spawn position
    * @param type piece type
@@ -86,6 +89,43 @@ public:
    */
   static const Shape &getShape(CellType type, Rotation rotation);
 
+  /**
+   * get the shape rows as bitmasks for a specific rotation
+   * @param type piece type
+   * @param rotation rotation state
+   * @return reference to row masks, row 0 is top
+   */
+  static const RowMasks &getRowMasks(CellType type, Rotation rotation);
+
+  /**
+   * check if a piece overlaps blocks or leaves the board,
+   * shape cell (row, col) maps to board cell (x + col, y - row)
+   * @param board board to test against
+   * @param type piece type
+   * @param rotation rotation state
+   * @param x x position
+   * @param y y position
+   * @return true if colliding, false if the position is free
+   */
+  static bool collides(const Board &board, CellType type, Rotation rotation,
+                       int x, int y);
+
+  /**
+   * check if this piece collides at its current position
+   * @param board board to test against
+   * @return true if colliding, false if the position is free
+   */
+  bool collides(const Board &board) const {
+    return collides(board, type_, rotation_, x_, y_);
+  }
+
+  /**
+   * write the cells of this piece into the board
+   * @param board board to write to
+   * @return true if all cells were inside the board, false otherwise
+   */
+  bool lock(Board &board) const;
+
   /**
    * get spawn position for a piece type
    * @param type piece type
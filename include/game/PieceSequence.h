@@ -0,0 +1,77 @@
+#ifndef TETORIO_GAME_PIECE_SEQUENCE_H
+#define TETORIO_GAME_PIECE_SEQUENCE_H
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace game {
+
+/**
+ * PieceSequence is 7-Bag piece sequence shared by every player in a room.
+ * pieces are generated lazily in blocks of 7 and never change once generated,
+ * so the whole sequence can be described to clients by its seed alone.
+ * not thread-safe; it is expected to be advanced from the event loop only.
+ */
+class PieceSequence {
+public:
+  /**
+   * constructor
+   * @param seed random seed (0 = generate from clock)
+   */
+  explicit PieceSequence(uint64_t seed = 0);
+
+  /**
+   * destructor
+   */
+  ~PieceSequence() = default;
+
+  // copy constructor and assignment operator deleted to prevent copying
+  PieceSequence(const PieceSequence &) = delete;
+  PieceSequence &operator=(const PieceSequence &) = delete;
+
+  /**
+   * get the seed of the sequence
+   * @return seed
+   */
+  uint64_t getSeed() const { return seed_; }
+
+  /**
+   * generate blocks until at least count pieces are available
+   * @param count number of pieces required
+   */
+  void ensure(uint32_t count);
+
+  /**
+   * get piece at index, generating blocks if necessary
+   * @param index piece index from the start of the game
+   * @return piece of cell value (CELL_I ~ CELL_L)
+   */
+  uint8_t at(uint32_t index);
+
+  /**
+   * get number of pieces generated so far
+   * @return count of generated pieces
+   */
+  uint32_t size() const { return static_cast<uint32_t>(pieces_.size()); }
+
+  /**
+   * get raw piece data generated so far
+   * @return pointer to the first piece
+   */
+  const uint8_t *data() const { return pieces_.data(); }
+
+private:
+  /**
+   * generate new shuffled block of 7 pieces and append to sequence
+   */
+  void generateBlock();
+
+  uint64_t seed_;
+  std::mt19937_64 rng_;
+  std::vector<uint8_t> pieces_;
+};
+
+} // namespace game
+
+#endif // TETORIO_GAME_PIECE_SEQUENCE_H
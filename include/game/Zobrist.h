@@ -0,0 +1,112 @@
+#ifndef TETORIO_GAME_ZOBRIST_H
+#define TETORIO_GAME_ZOBRIST_H
+
+#include "Board.h"
+
+#include <array>
+#include <cstdint>
+
+namespace game {
+
+class Bag;
+class Piece;
+
+namespace zobrist {
+
+// number of distinct cell values covered by the key table (4-bit cells)
+constexpr int CELL_VALUES = 16;
+
+/**
+ * mix 64-bit value (splitmix64 finalizer)
+ * @param value value to mix
+ * @return mixed value
+ */
+constexpr uint64_t mix(uint64_t value) {
+  value ^= value >> 30;
+  value *= 0xBF58476D1CE4E5B9ULL;
+  value ^= value >> 27;
+  value *= 0x94D049BB133111EBULL;
+  value ^= value >> 31;
+  return value;
+}
+
+/**
+ * generate the n-th key of the fixed key stream, which is identical on
+ * server and clients so hashes can be compared across the network
+ * @param n key index
+ * @return key
+ */
+constexpr uint64_t key(uint64_t n) {
+  return mix(0x7E70A10ULL + (n + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+/**
+ * CellKeys is key table for (column, cell value) pairs.
+ */
+struct CellKeys {
+  std::array<std::array<uint64_t, CELL_VALUES>, BOARD_WIDTH> keys{};
+
+  constexpr CellKeys() {
+    for (int x = 0; x < BOARD_WIDTH; ++x) {
+      // empty cells contribute nothing so an empty row hashes to 0
+      for (int v = 1; v < CELL_VALUES; ++v) {
+        keys[x][v] = key(static_cast<uint64_t>(x * CELL_VALUES + v));
+      }
+    }
+  }
+};
+
+/**
+ * RowKeys is salt table for row positions.
+ */
+struct RowKeys {
+  std::array<uint64_t, BOARD_HEIGHT + BOARD_BUFFER> keys{};
+
+  constexpr RowKeys() {
+    for (int y = 0; y < BOARD_HEIGHT + BOARD_BUFFER; ++y) {
+      keys[y] = key(static_cast<uint64_t>(BOARD_WIDTH * CELL_VALUES + y));
+    }
+  }
+};
+
+constexpr CellKeys CELL_KEYS{};
+constexpr RowKeys ROW_KEYS{};
+
+/**
+ * get key for a cell value in a column, independent of row
+ * @param x column index (0-9)
+ * @param value cell value
+ * @return cell key
+ */
+constexpr uint64_t cellKey(int x, uint8_t value) {
+  return CELL_KEYS.keys[x][value & (CELL_VALUES - 1)];
+}
+
+/**
+ * get contribution of a row to the board hash, rows are hashed without
+ * position so a shifted row keeps its row hash and only this salt changes
+ * @param y row index
+ * @param rowHash xor of cell keys in the row
+ * @return contribution to board hash, 0 for empty row
+ */
+constexpr uint64_t rowKey(int y, uint64_t rowHash) {
+  return rowHash == 0 ? 0 : mix(rowHash ^ ROW_KEYS.keys[y]);
+}
+
+} // namespace zobrist
+
+/**
+ * fold active piece, hold and queue position into a board hash, which gives
+ * the value clients send per lock to detect desync
+ * @param board player board
+ * @param active active piece
+ * @param hold held piece type (CellType::EMPTY if none)
+ * @param bag player bag
+ * @return game state hash
+ */
+uint64_t hashGameState(const Board &board, const Piece &active, CellType hold,
+                       const Bag &bag);
+
+} // namespace game
+
+#endif // TETORIO_GAME_ZOBRIST_H
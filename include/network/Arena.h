@@ -0,0 +1,99 @@
+#ifndef TETORIO_NETWORK_ARENA_H
+#define TETORIO_NETWORK_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace network {
+
+// bytes of the first arena block
+constexpr size_t DEFAULT_ARENA_BLOCK_SIZE = 64 * 1024;
+
+/**
+ * Span stores a view of contiguous elements owned elsewhere, e.g. by an
+ * Arena; it is valid until the owner is reset.
+ */
+template <typename T> struct Span {
+  T *data = nullptr; // first element
+  size_t size = 0;   // element count
+
+  bool empty() const { return size == 0; }
+  T *begin() const { return data; }
+  T *end() const { return data + size; }
+  T &operator[](size_t index) const { return data[index]; }
+};
+
+/**
+ * Arena hands out memory for temporaries of one event loop iteration by
+ * bumping an offset, and takes it all back at once with reset(). a block
+ * that overflows gets extra blocks for the rest of the iteration, and
+ * reset() merges them into one block big enough for next time, so a
+ * steady load stops calling the allocator. only trivially destructible
+ * types may live in it, nothing is destroyed.
+ */
+class Arena {
+public:
+  /**
+   * constructor
+   * @param blockSize bytes of the first block
+   */
+  explicit Arena(size_t blockSize = DEFAULT_ARENA_BLOCK_SIZE);
+
+  // copy constructor and assignment operator deleted to prevent copying
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  /**
+   * allocate raw memory
+   * @param bytes number of bytes
+   * @param alignment power of two alignment
+   * @return pointer valid until the next reset()
+   */
+  void *allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+  /**
+   * allocate an uninitialized array
+   * @param count element count
+   * @return span over the array, valid until the next reset()
+   */
+  template <typename T> Span<T> allocateArray(size_t count) {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "arena memory is never destroyed");
+    if (count == 0) {
+      return {};
+    }
+    return {static_cast<T *>(allocate(count * sizeof(T), alignof(T))),
+            count};
+  }
+
+  /**
+   * take back everything allocated since the last reset
+   */
+  void reset();
+
+  /**
+   * get the bytes allocated since the last reset
+   * @return used bytes, alignment padding included
+   */
+  size_t getUsedBytes() const { return used_ + overflowUsed_; }
+
+  /**
+   * get the size of the main block
+   * @return capacity in bytes
+   */
+  size_t getCapacity() const { return capacity_; }
+
+private:
+  std::unique_ptr<uint8_t[]> block_;  // main block
+  size_t capacity_;                   // main block size
+  size_t used_ = 0;                   // main block bytes handed out
+  std::vector<std::unique_ptr<uint8_t[]>> overflow_; // extra blocks
+  size_t overflowUsed_ = 0;           // bytes requested from extra blocks
+};
+
+} // namespace network
+
+#endif // TETORIO_NETWORK_ARENA_H
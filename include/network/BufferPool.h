@@ -0,0 +1,89 @@
+#ifndef TETORIO_NETWORK_BUFFER_POOL_H
+#define TETORIO_NETWORK_BUFFER_POOL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace network {
+
+// size classes of pooled buffers, each four times the previous
+constexpr size_t BUFFER_CLASS_COUNT = 6;
+constexpr size_t MIN_BUFFER_CLASS_SIZE = 64;
+constexpr size_t MAX_BUFFER_CLASS_SIZE =
+    MIN_BUFFER_CLASS_SIZE << (2 * (BUFFER_CLASS_COUNT - 1));
+
+// bytes a pool keeps for reuse, buffers released beyond it are freed
+constexpr size_t DEFAULT_MAX_POOLED_BYTES = 16 * 1024 * 1024;
+
+/**
+ * BufferPool lends byte buffers in size classes. connections hold a
+ * buffer only while they have bytes in it and give it back once drained,
+ * so idle connections hold none and busy ones reuse the same storage
+ * without calling the allocator.
+ */
+class BufferPool {
+public:
+  /**
+   * constructor
+   * @param maxPooledBytes bytes kept for reuse at most
+   */
+  explicit BufferPool(size_t maxPooledBytes = DEFAULT_MAX_POOLED_BYTES)
+      : maxPooledBytes_(maxPooledBytes) {}
+
+  /**
+   * grow a buffer to hold at least capacity bytes, keeping its content;
+   * the old storage goes back to the pool
+   * @param buffer buffer to grow
+   * @param capacity bytes the buffer must hold
+   */
+  void reserve(std::vector<uint8_t> &buffer, size_t capacity);
+
+  /**
+   * give the storage of a buffer back, the buffer is left empty without
+   * capacity
+   * @param buffer buffer to release
+   */
+  void release(std::vector<uint8_t> &buffer);
+
+  /**
+   * free the pooled buffers that were not needed since the last trim, so
+   * a burst does not keep its memory; meant to run every few seconds
+   * @return bytes freed
+   */
+  size_t trim();
+
+  /**
+   * get the bytes kept for reuse
+   * @return pooled capacity in bytes
+   */
+  size_t getPooledBytes() const { return pooledBytes_; }
+
+private:
+  /**
+   * take a buffer of the smallest class holding capacity bytes
+   * @param capacity bytes needed
+   * @return empty buffer with at least capacity bytes of storage
+   */
+  std::vector<uint8_t> acquire(size_t capacity);
+
+  /**
+   * get the size of a class
+   * @param sizeClass class index
+   * @return buffer size in bytes
+   */
+  static size_t classSize(size_t sizeClass) {
+    return MIN_BUFFER_CLASS_SIZE << (2 * sizeClass);
+  }
+
+  std::array<std::vector<std::vector<uint8_t>>, BUFFER_CLASS_COUNT> free_;
+  // fewest pooled buffers of each class since the last trim
+  std::array<size_t, BUFFER_CLASS_COUNT> lowWater_{};
+  size_t pooledBytes_ = 0;  // capacity of all pooled buffers
+  size_t maxPooledBytes_;   // pooled capacity limit
+};
+
+} // namespace network
+
+#endif // TETORIO_NETWORK_BUFFER_POOL_H
@@ -1,16 +1,162 @@
+#include <array>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
 #include <vector>
 
 namespace network {
 
+// largest chunk header a file stream framer may write
+constexpr size_t MAX_CHUNK_HEADER_SIZE = 16;
+
+// file bytes sent per chunk before other traffic gets a turn
+constexpr size_t FILE_CHUNK_SIZE = 16384;
+
+/**
+ * FileStream stores a file range being streamed to a client with
+ * sendfile(). the range is cut into chunks, each preceded by a header from
+ * the framer, so the receiver can tell chunks apart from other messages.
+ * memory use is fixed no matter how large the range is.
+ */
+struct FileStream {
+  // write header for a chunk of chunkLen bytes, return header length
+  using Framer = std::function<size_t(size_t chunkLen, uint8_t *header)>;
+
+  int fd = -1;              // file descriptor owned by the stream
+  uint64_t offset = 0;      // next file offset to send
+  uint64_t remaining = 0;   // bytes of the range not yet sent
+  Framer framer;            // chunk header writer
+  std::array<uint8_t, MAX_CHUNK_HEADER_SIZE> header{}; // current chunk header
+  size_t headerLen = 0;     // current header length
+  size_t headerSent = 0;    // current header bytes sent
+  size_t chunkRemaining = 0; // current chunk file bytes not yet sent
+
+  /**
+   * check if a chunk was started and not finished, other data must wait
+   * @return true if in the middle of a chunk
+   */
+  bool inChunk() const {
+    return headerSent < headerLen || chunkRemaining > 0;
+  }
+};
+
+// unsent bytes the kernel may hold per connection, the rest waits in the
+// lanes so control data can still overtake bulk data
+constexpr size_t SEND_LOWAT_BYTES = 16384;
+
+// control bytes sent per bulk byte while both lanes are backlogged, so bulk
+// keeps at least a quarter of the connection
+constexpr int64_t CONTROL_SHARE = 3;
+
+// entries a drained-from-the-front queue skips before it compacts
+constexpr size_t BULK_QUEUE_COMPACT_ENTRIES = 32;
+
 /**
- * ClientBuffer store client send buffer.
+ * BulkQueue stores a FIFO of bulk lane entries in one vector. it allocates
+ * nothing until first used and keeps its storage when drained, so a busy
+ * lane does not allocate per entry; release() frees the storage of a lane
+ * gone idle.
+ */
+template <typename T> class BulkQueue {
+public:
+  bool empty() const { return head_ == items_.size(); }
+  size_t size() const { return items_.size() - head_; }
+  size_t capacity() const { return items_.capacity(); }
+  T &front() { return items_[head_]; }
+  const T &front() const { return items_[head_]; }
+
+  typename std::vector<T>::iterator begin() {
+    return items_.begin() + static_cast<ptrdiff_t>(head_);
+  }
+  typename std::vector<T>::iterator end() { return items_.end(); }
+  typename std::vector<T>::const_iterator begin() const {
+    return items_.begin() + static_cast<ptrdiff_t>(head_);
+  }
+  typename std::vector<T>::const_iterator end() const { return items_.end(); }
+
+  void push_back(T &&item) { items_.push_back(std::move(item)); }
+
+  /**
+   * remove the front entry, dropping what it references right away
+   */
+  void pop_front() {
+    items_[head_] = T();
+    if (++head_ == items_.size()) {
+      items_.clear();
+      head_ = 0;
+    } else if (head_ >= BULK_QUEUE_COMPACT_ENTRIES &&
+               head_ * 2 >= items_.size()) {
+      items_.erase(items_.begin(),
+                   items_.begin() + static_cast<ptrdiff_t>(head_));
+      head_ = 0;
+    }
+  }
+
+  /**
+   * remove all entries, keeping the storage
+   */
+  void clear() {
+    items_.clear();
+    head_ = 0;
+  }
+
+  /**
+   * remove all entries and free the storage
+   */
+  void release() {
+    std::vector<T>().swap(items_);
+    head_ = 0;
+  }
+
+private:
+  std::vector<T> items_; // entries, the first head_ already removed
+  size_t head_ = 0;      // index of the front entry
+};
+
+/**
+ * SharedFrame stores a reference to a message encoded once and queued for
+ * many clients, so fan-out costs no copy per client.
+ */
+struct SharedFrame {
+  std::shared_ptr<const std::vector<uint8_t>> bytes; // complete message
+  size_t offset = 0;   // frame bytes already sent
+};
+
+/**
+ * ClientBuffer store client send buffer. it has two lanes: control data
+ * appended with send() goes first, bulk data (shared frames, then file
+ * chunks) gets a turn at message boundaries once control has used its
+ * share. each lane keeps its own order, so a client that must see two
+ * messages in order gets both on the same lane. data storage is lent by
+ * the server's BufferPool and given back whenever the control lane drains.
  */
 struct ClientBuffer {
-  std::vector<uint8_t> data; // send buffer data
-  size_t offset = 0;         // current send offset
-  bool wantWrite = false;    // whether EPOLLOUT is registered
+  std::vector<uint8_t> data;     // control lane data
+  size_t offset = 0;             // current send offset
+  bool wantWrite = false;        // whether EPOLLOUT is registered
+  BulkQueue<SharedFrame> shared; // bulk lane, shared frames
+  BulkQueue<FileStream> files;   // bulk lane, file ranges after frames
+  size_t controlPending = 0;     // data bytes left of the started write
+  int64_t bulkCredit = 0;        // > 0 when bulk is owed a turn
+  bool bulkUsed = false;         // bulk queued since the last idle sweep
+
+  /**
+   * check if bulk data is queued
+   * @return true if shared frames or files are queued
+   */
+  bool hasBulk() const { return !shared.empty() || !files.empty(); }
+
+  /**
+   * check if a bulk message was started and not finished, control data
+   * must wait
+   * @return true if in the middle of a shared frame or file chunk
+   */
+  bool inBulk() const {
+    return (!shared.empty() && shared.front().offset > 0) ||
+           (!files.empty() && files.front().inChunk());
+  }
 
   /**
    * append data to send buffer
@@ -43,6 +189,21 @@ struct ClientBuffer {
    */
   const uint8_t *current() const { return data.data() + offset; }
   bool empty() const { return offset >= data.size(); }
+
+  /**
+   * reset to the state of a new connection, keeping lane storage; data
+   * storage is expected to be released to the pool already
+   */
+  void reset() {
+    data.clear();
+    offset = 0;
+    wantWrite = false;
+    shared.clear();
+    files.clear();
+    controlPending = 0;
+    bulkCredit = 0;
+    bulkUsed = false;
+  }
 };
 
 } // namespace network
\ No newline at end of file
@@ -0,0 +1,92 @@
+#ifndef TETORIO_NETWORK_NODE_POOL_H
+#define TETORIO_NETWORK_NODE_POOL_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace network {
+
+// erased map nodes a pool keeps for reuse by default
+constexpr size_t DEFAULT_NODE_POOL_LIMIT = 16384;
+
+/**
+ * NodePool keeps the nodes of erased map entries and hands them to the
+ * next insert, so a map whose keys come and go stops calling the allocator
+ * once it has been at its size. a recycled value is left as it was when
+ * erased; callers reset it.
+ */
+template <typename Map> class NodePool {
+public:
+  using Key = typename Map::key_type;
+  using Node = typename Map::node_type;
+
+  /**
+   * constructor
+   * @param limit nodes kept at most, more are freed
+   */
+  explicit NodePool(size_t limit = DEFAULT_NODE_POOL_LIMIT) : limit_(limit) {}
+
+  /**
+   * insert a key with a pooled node, or a new default value if none is
+   * pooled; an existing entry is left as it is
+   * @param map map to insert into
+   * @param key key to insert
+   * @return iterator to the entry and true if it was inserted
+   */
+  std::pair<typename Map::iterator, bool> insert(Map &map, const Key &key) {
+    if (nodes_.empty()) {
+      return map.try_emplace(key);
+    }
+
+    Node node = std::move(nodes_.back());
+    nodes_.pop_back();
+    node.key() = key;
+    auto result = map.insert(std::move(node));
+    if (!result.inserted) {
+      nodes_.push_back(std::move(result.node));
+    }
+    return {result.position, result.inserted};
+  }
+
+  /**
+   * erase an entry and keep its node
+   * @param map map to erase from
+   * @param it entry to erase
+   */
+  void erase(Map &map, typename Map::iterator it) {
+    Node node = map.extract(it);
+    if (nodes_.size() < limit_) {
+      nodes_.push_back(std::move(node));
+    }
+  }
+
+  /**
+   * erase an entry by key and keep its node
+   * @param map map to erase from
+   * @param key key to erase
+   * @return true if erased, false if not found
+   */
+  bool erase(Map &map, const Key &key) {
+    auto it = map.find(key);
+    if (it == map.end()) {
+      return false;
+    }
+    erase(map, it);
+    return true;
+  }
+
+  /**
+   * get the number of pooled nodes
+   * @return pooled node count
+   */
+  size_t size() const { return nodes_.size(); }
+
+private:
+  std::vector<Node> nodes_; // erased nodes ready for reuse
+  size_t limit_;            // pooled node limit
+};
+
+} // namespace network
+
+#endif // TETORIO_NETWORK_NODE_POOL_H
@@ -1,10 +1,14 @@
 #ifndef TETORIO_NETWORK_SERVER_H
 #define TETORIO_NETWORK_SERVER_H
 
+#include "Arena.h"
+#include "BufferPool.h"
 #include "ClientBuffer.h"
+#include "NodePool.h"
 
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <netinet/in.h>
 #include <sys/epoll.h>
 #include <unordered_map>
@@ -30,6 +34,16 @@ struct ServerState {
   bool running = false; // server running state
 };
 
+/**
+ * SendQueueInfo store how much a client connection has queued.
+ */
+struct SendQueueInfo {
+  size_t bufferedBytes = 0;  // data and shared frames not yet written
+  uint32_t kernelUnsent = 0; // bytes in the socket not yet sent
+  uint32_t kernelRttUs = 0;  // smoothed rtt of the kernel, 0 if unknown
+  uint32_t retransmits = 0;  // segments retransmitted over the lifetime
+};
+
 /**
  * Server accept and manage client connections.
  */
@@ -40,6 +54,7 @@ public:
   using ClientDisconnectCallback = std::function<void(int clientFd)>;
   using ClientDataCallback =
       std::function<void(int clientFd, const uint8_t *data, size_t len)>;
+  using WatchCallback = std::function<void()>;
 
   /**
    * constructor
@@ -99,7 +114,7 @@ public:
   void runEventLoop();
 
   /**
-   * send data to client
+   * send data to client on the control lane, ahead of bulk data
    * @param clientFd client socket file descriptor
    * @param data pointer to data to send
    * @param len length of data to send
@@ -107,6 +122,60 @@ public:
    */
   bool send(int clientFd, const uint8_t *data, size_t len);
 
+  /**
+   * stream a file range to client on the bulk lane, chunks interleave with
+   * shared frames
+   * @param clientFd client socket file descriptor
+   * @param fileFd file to read, duplicated so the caller keeps ownership
+   * @param offset start offset in the file
+   * @param length number of bytes to stream
+   * @param framer writes the header sent before each chunk
+   * @return true if queued, false if client not found or failed
+   */
+  bool sendFile(int clientFd, int fileFd, uint64_t offset, uint64_t length,
+                FileStream::Framer framer);
+
+  /**
+   * queue a message shared by many clients without copying it, on the bulk
+   * lane
+   * @param clientFd client socket file descriptor
+   * @param frame complete framed message, kept alive until sent
+   * @return true if queued, false if client not found or frame empty
+   */
+  bool sendShared(int clientFd,
+                  std::shared_ptr<const std::vector<uint8_t>> frame);
+
+  /**
+   * get the number of shared frames not yet fully sent to a client
+   * @param clientFd client socket file descriptor
+   * @return queued shared frames, 0 if client not found
+   */
+  size_t getSharedBacklog(int clientFd) const;
+
+  /**
+   * get the send queue of a client, buffered here and in the kernel;
+   * file streams are not counted
+   * @param clientFd client socket file descriptor
+   * @param info output queue state
+   * @return true if successful, false if client not found
+   */
+  bool getSendQueueInfo(int clientFd, SendQueueInfo &info) const;
+
+  /**
+   * close a client connection, the disconnect callback runs as usual
+   * @param clientFd client socket file descriptor
+   * @return true if closed, false if client not found
+   */
+  bool disconnect(int clientFd);
+
+  /**
+   * free the bulk lane storage of clients that queued no bulk data since
+   * the last call and the pooled send buffers not needed since then,
+   * meant to run every few seconds
+   * @return number of clients whose lane storage was freed
+   */
+  size_t reclaimIdleBuffers();
+
   /**
    * broadcast data to all clients
    * @param data pointer to data to send
@@ -120,6 +189,34 @@ public:
    */
   std::vector<int> getClientFds() const;
 
+  /**
+   * get all connected client file descriptors without a heap allocation
+   * @param arena arena holding the result
+   * @return span of client file descriptors, valid until the arena resets
+   */
+  Span<const int> getClientFds(Arena &arena) const;
+
+  /**
+   * get the arena for temporaries of the current event loop iteration, it
+   * is reset when the iteration ends
+   * @return iteration arena
+   */
+  Arena &getArena() { return arena_; }
+
+  /**
+   * watch a non-client fd (e.g. an eventfd) from the event loop
+   * @param fd file descriptor to watch for readability
+   * @param callback callback run while fd is readable
+   * @return true if successful, false if failed
+   */
+  bool addWatch(int fd, WatchCallback callback);
+
+  /**
+   * stop watching a fd
+   * @param fd file descriptor
+   */
+  void removeWatch(int fd);
+
   /**
    * set client connect callback
    * @param callback callback function
@@ -207,6 +304,22 @@ private:
    */
   void handleWrite(int clientFd);
 
+  /**
+   * send or start the next bulk message of a client
+   * @param clientFd client socket file descriptor
+   * @param buf send buffer of the client
+   * @return 1 on progress, 0 if blocked, -1 on error
+   */
+  int sendBulk(int clientFd, ClientBuffer &buf);
+
+  /**
+   * send the current chunk of a file stream
+   * @param clientFd client socket file descriptor
+   * @param stream stream with a started chunk
+   * @return 1 if the chunk is complete, 0 if blocked, -1 on error
+   */
+  int sendFileChunk(int clientFd, FileStream &stream);
+
   /**
    * close client connection
    * @param clientFd client socket file descriptor
@@ -237,6 +350,10 @@ private:
   ServerConfig config_;                           // server configuration
   ServerState state_;                             // server runtime state
   std::unordered_map<int, ClientBuffer> clients_; // client fd -> send buffer
+  NodePool<std::unordered_map<int, ClientBuffer>> clientNodes_; // closed
+  BufferPool bufferPool_; // control lane storage
+  Arena arena_;           // temporaries of one event loop iteration
+  std::unordered_map<int, WatchCallback> watches_; // watched fd -> callback
 
   // callbacks for server events
   ClientConnectCallback clientConnectCallback_;
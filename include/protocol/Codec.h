@@ -0,0 +1,75 @@
+#ifndef TETORIO_PROTOCOL_CODEC_H
+#define TETORIO_PROTOCOL_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace protocol {
+
+/**
+ * append little endian unsigned integer
+ * @param out output buffer
+ * @param value value to append
+ * @param bytes number of bytes to write (1-8)
+ */
+inline void writeLE(std::vector<uint8_t> &out, uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; ++i) {
+    out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+/**
+ * read little endian unsigned integer
+ * @param data pointer to data, must hold at least bytes bytes
+ * @param bytes number of bytes to read (1-8)
+ * @return value read
+ */
+inline uint64_t readLE(const uint8_t *data, int bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < bytes; ++i) {
+    value |= static_cast<uint64_t>(data[i]) << (8 * i);
+  }
+  return value;
+}
+
+/**
+ * append unsigned LEB128 varint
+ * @param out output buffer
+ * @param value value to append
+ */
+inline void writeVarint(std::vector<uint8_t> &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+/**
+ * read unsigned LEB128 varint
+ * @param data pointer to data
+ * @param len length of data
+ * @param pos read position, advanced past the varint
+ * @param value output value
+ * @return true if read, false if truncated or too long
+ */
+inline bool readVarint(const uint8_t *data, size_t len, size_t &pos,
+                       uint64_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (pos >= len) {
+      return false;
+    }
+    uint8_t byte = data[pos++];
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace protocol
+
+#endif // TETORIO_PROTOCOL_CODEC_H
@@ -0,0 +1,153 @@
+#ifndef TETORIO_PROTOCOL_MESSAGE_H
+#define TETORIO_PROTOCOL_MESSAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace protocol {
+
+// message header: u16 payload length (little endian) + u8 message type
+constexpr size_t HEADER_SIZE = 3;
+
+// largest payload accepted from clients
+constexpr size_t MAX_PAYLOAD_SIZE = 4096;
+
+/**
+ * MessageType matches the type byte of a message.
+ */
+enum class MessageType : uint8_t {
+  // client -> server
+  HEARTBEAT = 1,   // empty
+  CREATE_ROOM = 2, // room name bytes
+  JOIN_ROOM = 3,   // u32 room ID
+  LEAVE_ROOM = 4,  // empty
+  START_GAME = 5,  // empty
+  INPUT = 6,       // u8 game::Input [prediction tag]
+  REPLAY_REQUEST = 7, // u64 archive game ID
+  PLACE = 8, // u32 piece index, i8 x, i8 y, u8 flags [prediction tag]
+  SET_TARGETING = 9, // u8 room::TargetStrategy
+  SPECTATE = 10,     // u32 room ID to watch (0 = stop watching)
+  QUEUE_JOIN = 11,   // u16 latency estimate in ms, ROOM_JOINED when matched
+  QUEUE_LEAVE = 12,  // empty
+  PONG = 13,         // u32 sequence, u64 timestamp, echoed from PING
+  RESUME = 14,       // resume token, versions held, see RESUME_BASE_SIZE
+  ADD_BOT = 15,      // u8 bot level, host seats a bot in its waiting room
+  PRACTICE = 16,     // u8 bot level, start a game against one bot
+
+  // server -> client
+  ROOM_JOINED = 64, // u32 room ID
+  GAME_START = 65,  // u64 sequence seed, u8 count, u32 player IDs
+  GAME_OVER = 66,   // u32 winner player ID (0 = none)
+  REPLAY_INFO = 67, // u64 game ID, u32 replay length
+  REPLAY_DATA = 68, // u64 game ID, replay bytes (chunk)
+  STATE_ACK = 69,   // u32 sequence, u64 state hash, u32 confirmed version
+  STATE_CORRECTION = 70, // u32 sequence, u8 epoch, u64 hash, game snapshot
+  TICK_UPDATE = 71, // per-player tick update, see room::UpdateEncoder
+  SPECTATOR_FRAME = 72, // shared spectator frame, see room::SpectatorFeed
+  PING = 73,        // u32 sequence, u64 server monotonic time in ns
+  SESSION_INFO = 74, // u32 player ID, resume token, u32 room, u32 watched room
+  ERROR = 127       // u8 message type that failed
+};
+
+// placement flags: bits 0-1 rotation, then spin and hold-first bits
+constexpr uint8_t PLACE_ROTATION_MASK = 0x03;
+constexpr uint8_t PLACE_FLAG_SPIN = 0x04;
+constexpr uint8_t PLACE_FLAG_HOLD = 0x08;
+
+// bot levels of ADD_BOT and PRACTICE: 0 easy, 1 normal, 2 hard, 3 expert
+constexpr uint8_t BOT_LEVEL_COUNT = 4;
+
+// prediction tag appended to INPUT and PLACE by predicting clients:
+// u32 sequence, u8 correction epoch, u64 predicted state hash after the move.
+// the server answers each received batch with a STATE_ACK for the last
+// sequence, or a STATE_CORRECTION if the predicted hash of a move tagged with
+// the current epoch was wrong. the correction board is a delta against the
+// last confirmed version (non-zero in an ack whose hash matched), or a
+// keyframe, and starts a new epoch so moves predicted before the client
+// applied it are not corrected again.
+constexpr size_t PREDICTION_TAG_SIZE = 13;
+
+// bytes of a resume token, handed out in SESSION_INFO
+constexpr size_t RESUME_TOKEN_SIZE = 16;
+
+// RESUME payload: resume token, u32 own board version, u32 spectator frame
+// version, u8 count, then [u8 slot, u32 board version] of opponent boards
+// the client holds. a client sends it as its first message after
+// reconnecting; the session it held is rebound to the new connection and
+// everything it missed is sent as deltas from the versions it names (0 if
+// none, own version 0 also resends GAME_START). a new token comes with the
+// SESSION_INFO reply.
+constexpr size_t RESUME_BASE_SIZE = RESUME_TOKEN_SIZE + 9;
+
+/**
+ * MessageHeader stores decoded message header.
+ */
+struct MessageHeader {
+  uint16_t length = 0;                         // payload length
+  MessageType type = MessageType::HEARTBEAT;   // message type
+};
+
+/**
+ * PredictionTag stores the prediction tag of a move.
+ */
+struct PredictionTag {
+  uint32_t sequence = 0;  // client move sequence, increasing
+  uint8_t epoch = 0;      // last correction epoch applied by the client
+  uint64_t stateHash = 0; // predicted game state hash after the move
+};
+
+/**
+ * decode prediction tag
+ * @param data pointer to PREDICTION_TAG_SIZE bytes
+ * @param tag output tag
+ */
+inline void parsePredictionTag(const uint8_t *data, PredictionTag &tag) {
+  tag.sequence = 0;
+  for (int i = 0; i < 4; ++i) {
+    tag.sequence |= static_cast<uint32_t>(data[i]) << (8 * i);
+  }
+  tag.epoch = data[4];
+  tag.stateHash = 0;
+  for (int i = 0; i < 8; ++i) {
+    tag.stateHash |= static_cast<uint64_t>(data[5 + i]) << (8 * i);
+  }
+}
+
+/**
+ * decode message header
+ * @param data pointer to data
+ * @param len length of data
+ * @param header output header
+ * @return true if a full header was available
+ */
+inline bool parseHeader(const uint8_t *data, size_t len,
+                        MessageHeader &header) {
+  if (len < HEADER_SIZE) {
+    return false;
+  }
+  header.length = static_cast<uint16_t>(data[0] | (data[1] << 8));
+  header.type = static_cast<MessageType>(data[2]);
+  return true;
+}
+
+/**
+ * append a framed message
+ * @param out output buffer
+ * @param type message type
+ * @param payload pointer to payload (can be nullptr if len is 0)
+ * @param len payload length
+ */
+inline void writeMessage(std::vector<uint8_t> &out, MessageType type,
+                         const uint8_t *payload, size_t len) {
+  out.push_back(static_cast<uint8_t>(len));
+  out.push_back(static_cast<uint8_t>(len >> 8));
+  out.push_back(static_cast<uint8_t>(type));
+  if (len > 0) {
+    out.insert(out.end(), payload, payload + len);
+  }
+}
+
+} // namespace protocol
+
+#endif // TETORIO_PROTOCOL_MESSAGE_H
@@ -0,0 +1,224 @@
+#ifndef TETORIO_REPLAY_REPLAY_ARCHIVE_H
+#define TETORIO_REPLAY_REPLAY_ARCHIVE_H
+
+#include "ReplaySimulator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace replay {
+
+// archive layout inside a directory:
+//   replays.seg: append-only segment, per game the replay bytes followed by
+//                its keyframe block
+//   replays.idx: sidecar index, one fixed-size entry per game in ID order
+//
+// keyframe block:
+//   u32 count
+//   count x { u64 time ms, u32 record offset, u32 snapshot offset,
+//             u64 frames } sorted by time, so it can be binary searched
+//   snapshots: varint clock per slot, then game::Game snapshot per slot
+// offsets are relative to the replay start and the block start.
+
+// segment and index file names
+constexpr const char *ARCHIVE_SEGMENT_FILE = "replays.seg";
+constexpr const char *ARCHIVE_INDEX_FILE = "replays.idx";
+
+// on-disk size of an index entry
+constexpr size_t ARCHIVE_INDEX_ENTRY_SIZE = 40;
+
+// on-disk size of a keyframe table entry
+constexpr size_t KEYFRAME_ENTRY_SIZE = 24;
+
+// pieces placed (all slots together) between keyframes
+constexpr uint32_t DEFAULT_KEYFRAME_INTERVAL = 64;
+
+/**
+ * ArchiveIndexEntry stores where a game lives in the segment.
+ */
+struct ArchiveIndexEntry {
+  uint64_t gameId = 0;          // archive-assigned game ID, starting at 1
+  uint64_t offset = 0;          // replay offset in the segment
+  uint32_t replayLength = 0;    // replay bytes
+  uint32_t keyframeLength = 0;  // keyframe block bytes following the replay
+  uint64_t startedAtMs = 0;     // from the replay header
+  uint32_t roomId = 0;          // from the replay header
+  uint32_t keyframeCount = 0;   // entries in the keyframe block
+};
+
+/**
+ * ArchiveWriter appends finished replays to the segment and index.
+ * not thread-safe; it is meant to be driven by the replay writer thread.
+ */
+class ArchiveWriter {
+public:
+  /**
+   * constructor
+   * @param directory archive directory, created if missing
+   * @param keyframeInterval pieces between keyframes
+   */
+  explicit ArchiveWriter(const std::string &directory,
+                         uint32_t keyframeInterval = DEFAULT_KEYFRAME_INTERVAL);
+
+  /**
+   * destructor, closes the files
+   */
+  ~ArchiveWriter();
+
+  // copy constructor and assignment operator deleted to prevent copying
+  ArchiveWriter(const ArchiveWriter &) = delete;
+  ArchiveWriter &operator=(const ArchiveWriter &) = delete;
+
+  /**
+   * open the archive, dropping a torn last entry left by a crash
+   * @return true if successful, false if failed
+   */
+  bool open();
+
+  /**
+   * close the archive
+   */
+  void close();
+
+  /**
+   * append a complete replay and its keyframes
+   * @param data pointer to replay data
+   * @param len length of replay data
+   * @return assigned game ID, 0 if failed
+   */
+  uint64_t append(const uint8_t *data, size_t len);
+
+  /**
+   * get number of games in the archive
+   * @return game count
+   */
+  uint64_t getGameCount() const { return nextGameId_ - 1; }
+
+  /**
+   * build the keyframe block of a replay by re-simulating it
+   * @param data pointer to replay data
+   * @param len length of replay data
+   * @param interval pieces between keyframes
+   * @param out output buffer, appended
+   * @return number of keyframes
+   */
+  static uint32_t buildKeyframes(const uint8_t *data, size_t len,
+                                 uint32_t interval, std::vector<uint8_t> &out);
+
+private:
+  std::string directory_;
+  uint32_t keyframeInterval_;
+  int segmentFd_ = -1;
+  int indexFd_ = -1;
+  uint64_t segmentSize_ = 0;
+  uint64_t nextGameId_ = 1;
+  std::vector<uint8_t> keyframes_; // reused keyframe block buffer
+};
+
+/**
+ * ArchiveReader maps the segment and index read-only.
+ * lookups are binary searches over the mapped index and keyframe tables,
+ * so opening a game or seeking touches only the pages it needs.
+ */
+class ArchiveReader {
+public:
+  /**
+   * constructor
+   */
+  ArchiveReader() = default;
+
+  /**
+   * destructor, unmaps the files
+   */
+  ~ArchiveReader();
+
+  // copy constructor and assignment operator deleted to prevent copying
+  ArchiveReader(const ArchiveReader &) = delete;
+  ArchiveReader &operator=(const ArchiveReader &) = delete;
+
+  /**
+   * map an archive
+   * @param directory archive directory
+   * @return true if successful, false if failed
+   */
+  bool open(const std::string &directory);
+
+  /**
+   * unmap the archive
+   */
+  void close();
+
+  /**
+   * remap if the writer appended since the last map
+   * @return true if mapped, false if failed
+   */
+  bool refresh();
+
+  /**
+   * get number of games in the archive
+   * @return game count
+   */
+  size_t getGameCount() const { return indexSize_ / ARCHIVE_INDEX_ENTRY_SIZE; }
+
+  /**
+   * get index entry by position
+   * @param position entry position (0 to getGameCount() - 1)
+   * @param entry output entry
+   * @return true if found
+   */
+  bool getEntry(size_t position, ArchiveIndexEntry &entry) const;
+
+  /**
+   * find index entry by game ID
+   * @param gameId game ID
+   * @param entry output entry
+   * @return true if found
+   */
+  bool findGame(uint64_t gameId, ArchiveIndexEntry &entry) const;
+
+  /**
+   * get replay bytes of a game
+   * @param entry index entry
+   * @return pointer into the mapped segment, nullptr if out of range
+   */
+  const uint8_t *getReplay(const ArchiveIndexEntry &entry) const;
+
+  /**
+   * get segment file descriptor, e.g. to stream replays with sendfile()
+   * @return segment file descriptor, -1 if not open
+   */
+  int getSegmentFd() const { return segmentFd_; }
+
+  /**
+   * restore a game to the state after every record up to a time
+   * @param entry index entry
+   * @param timeMs time since game start
+   * @param simulator simulator to restore into
+   * @return true if restored, false if malformed
+   */
+  bool seek(const ArchiveIndexEntry &entry, uint64_t timeMs,
+            ReplaySimulator &simulator) const;
+
+private:
+  /**
+   * map a file read-only
+   * @param fd file descriptor
+   * @param data mapped pointer, replaced
+   * @param size mapped size, replaced
+   * @return true if successful, false if failed
+   */
+  static bool mapFile(int fd, const uint8_t *&data, size_t &size);
+
+  int segmentFd_ = -1;
+  int indexFd_ = -1;
+  const uint8_t *segment_ = nullptr;
+  size_t segmentSize_ = 0;
+  const uint8_t *index_ = nullptr;
+  size_t indexSize_ = 0;
+};
+
+} // namespace replay
+
+#endif // TETORIO_REPLAY_REPLAY_ARCHIVE_H
@@ -0,0 +1,76 @@
+#ifndef TETORIO_REPLAY_REPLAY_FORMAT_H
+#define TETORIO_REPLAY_REPLAY_FORMAT_H
+
+#include "game/Game.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace replay {
+
+// replay file layout:
+//   header: "TTRP", u8 version, u64 sequence seed, u32 room ID,
+//           u64 start time (unix ms), varint player count, varint player IDs
+//   records: varint player slot, varint (delta ms << 4 | kind) [, payload]
+// delta ms is relative to the previous record of the same slot, so each
+// player forms an independent delta-timestamped stream and records stay
+// one or two bytes for ordinary inputs. records are written in the order
+// they were applied on the server, which is the order replay must use.
+
+// file magic
+constexpr uint8_t REPLAY_MAGIC[4] = {'T', 'T', 'R', 'P'};
+
+// format version
+constexpr uint8_t REPLAY_VERSION = 1;
+
+// offset added to placement x so it stays non-negative
+constexpr int PLACEMENT_X_OFFSET = 8;
+
+// bits of the record tag holding the kind
+constexpr int RECORD_KIND_BITS = 4;
+
+/**
+ * RecordKind matches the low bits of a record tag.
+ * 1-8 are game::Input values applied to the slot.
+ */
+enum class RecordKind : uint8_t {
+  INPUT_FIRST = 1, // first input value
+  INPUT_LAST = 8,  // last input value
+  GARBAGE = 9,     // varint lines, varint hole column received by slot
+  FORFEIT = 10,    // slot left the game
+  PLACEMENT = 11,  // varint x + 8, varint y, varint placement flags
+  GARBAGE_BATCH = 12, // varint count, (varint lines, varint hole) in order
+  END = 15         // end of replay, slot field is 0
+};
+
+/**
+ * ReplayHeader stores the initial state needed to re-simulate a game.
+ */
+struct ReplayHeader {
+  uint64_t seed = 0;               // piece sequence seed
+  uint32_t roomId = 0;             // room the game was played in
+  uint64_t startedAtMs = 0;        // wall clock start time in unix ms
+  std::vector<uint32_t> playerIds; // player ID of each slot
+};
+
+/**
+ * ReplayRecord stores one decoded record.
+ */
+struct ReplayRecord {
+  uint32_t slot = 0;                     // player slot
+  uint64_t timeMs = 0;                   // time since game start
+  RecordKind kind = RecordKind::END;     // kind, or input value
+  uint8_t input = 0;                     // input value if kind is input
+  uint32_t lines = 0;                    // garbage lines
+  uint32_t holeColumn = 0;               // garbage hole column
+  game::PlacementClaim placement;        // placement, index not stored
+  std::array<game::GarbageSegment, game::MAX_GARBAGE_SEGMENTS>
+      garbage;                           // garbage batch segments
+  uint8_t garbageCount = 0;              // garbage batch segment count
+};
+
+} // namespace replay
+
+#endif // TETORIO_REPLAY_REPLAY_FORMAT_H
@@ -0,0 +1,87 @@
+#ifndef TETORIO_REPLAY_REPLAY_READER_H
+#define TETORIO_REPLAY_REPLAY_READER_H
+
+#include "ReplayFormat.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace replay {
+
+/**
+ * ReplayReader decodes a replay from memory without copying it.
+ * records are decoded one at a time, so a reader can start at any record
+ * boundary given the slot clocks at that point.
+ */
+class ReplayReader {
+public:
+  /**
+   * constructor
+   * @param data pointer to replay data, must outlive the reader
+   * @param len length of data
+   */
+  ReplayReader(const uint8_t *data, size_t len);
+
+  /**
+   * destructor
+   */
+  ~ReplayReader() = default;
+
+  /**
+   * decode the header, must be called before next()
+   * @param header output header
+   * @return true if decoded, false if malformed
+   */
+  bool readHeader(ReplayHeader &header);
+
+  /**
+   * decode the next record
+   * @param record output record
+   * @return true if decoded, false at end of replay or on malformed data
+   */
+  bool next(ReplayRecord &record);
+
+  /**
+   * check if the end record was reached
+   * @return true if complete
+   */
+  bool isComplete() const { return complete_; }
+
+  /**
+   * check if malformed data was found
+   * @return true if an error occurred
+   */
+  bool hasError() const { return error_; }
+
+  /**
+   * get read offset
+   * @return offset of the next record
+   */
+  size_t getOffset() const { return pos_; }
+
+  /**
+   * continue reading from a record boundary
+   * @param offset offset of a record
+   * @param slotTimesMs clock of every slot at that record
+   */
+  void seek(size_t offset, const std::vector<uint64_t> &slotTimesMs);
+
+  /**
+   * get clock of every slot, time of the last record read
+   * @return time since game start per slot
+   */
+  const std::vector<uint64_t> &getSlotTimes() const { return slotTimesMs_; }
+
+private:
+  const uint8_t *data_;
+  size_t len_;
+  size_t pos_ = 0;
+  std::vector<uint64_t> slotTimesMs_;
+  bool complete_ = false;
+  bool error_ = false;
+};
+
+} // namespace replay
+
+#endif // TETORIO_REPLAY_REPLAY_READER_H
@@ -0,0 +1,142 @@
+#ifndef TETORIO_REPLAY_REPLAY_RECORDER_H
+#define TETORIO_REPLAY_REPLAY_RECORDER_H
+
+#include "ReplayFormat.h"
+#include "ReplayWriter.h"
+#include "game/Game.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace replay {
+
+/**
+ * ReplayRecorder encodes the input log of one game.
+ * records are appended to a local buffer and copies are handed to the
+ * writer in chunks, so recording an input costs a few byte appends. the
+ * whole log stays in memory until takeLog() so it can be verified.
+ */
+class ReplayRecorder {
+public:
+  // buffered bytes that trigger a hand-off to the writer
+  static constexpr size_t FLUSH_THRESHOLD = 4096;
+
+  /**
+   * constructor, encodes the header
+   * @param writer writer receiving the chunks
+   * @param header initial state of the game
+   */
+  ReplayRecorder(ReplayWriter &writer, const ReplayHeader &header);
+
+  /**
+   * destructor, finishes the replay if not finished yet
+   */
+  ~ReplayRecorder();
+
+  // copy constructor and assignment operator deleted to prevent copying
+  ReplayRecorder(const ReplayRecorder &) = delete;
+  ReplayRecorder &operator=(const ReplayRecorder &) = delete;
+
+  /**
+   * record an input applied to a slot
+   * @param slot player slot
+   * @param timeMs time since game start
+   * @param input applied input
+   */
+  void recordInput(uint32_t slot, uint64_t timeMs, game::Input input);
+
+  /**
+   * record a placement applied to a slot
+   * @param slot player slot
+   * @param timeMs time since game start
+   * @param claim applied placement
+   */
+  void recordPlacement(uint32_t slot, uint64_t timeMs,
+                       const game::PlacementClaim &claim);
+
+  /**
+   * record garbage received by a slot
+   * @param slot player slot
+   * @param timeMs time since game start
+   * @param lines number of garbage lines
+   * @param holeColumn hole column
+   */
+  void recordGarbage(uint32_t slot, uint64_t timeMs, int lines,
+                     int holeColumn);
+
+  /**
+   * record garbage segments received by a slot in one write
+   * @param slot player slot
+   * @param timeMs time since game start
+   * @param segments garbage segments, the first ends up on top
+   * @param count number of segments
+   */
+  void recordGarbage(uint32_t slot, uint64_t timeMs,
+                     const game::GarbageSegment *segments, int count);
+
+  /**
+   * record a slot leaving the game
+   * @param slot player slot
+   * @param timeMs time since game start
+   */
+  void recordForfeit(uint32_t slot, uint64_t timeMs);
+
+  /**
+   * write the end record and hand the rest to the writer
+   * @param timeMs time since game start
+   */
+  void finish(uint64_t timeMs);
+
+  /**
+   * move the complete log out, after finish()
+   * @return replay bytes
+   */
+  std::vector<uint8_t> takeLog();
+
+  /**
+   * get key identifying the game in the writer
+   * @return game key
+   */
+  const std::string &getGameKey() const { return gameKey_; }
+
+  /**
+   * encode a replay header
+   * @param header header to encode
+   * @param out output buffer, appended
+   */
+  static void encodeHeader(const ReplayHeader &header,
+                           std::vector<uint8_t> &out);
+
+private:
+  /**
+   * write record tag and update the slot clock
+   * @param slot player slot
+   * @param timeMs time since game start
+   * @param kind record kind
+   */
+  void writeTag(uint32_t slot, uint64_t timeMs, uint8_t kind);
+
+  /**
+   * hand buffered bytes to the writer if over threshold
+   */
+  void maybeFlush();
+
+  /**
+   * copy bytes not yet handed to the writer
+   * @return chunk of new bytes
+   */
+  std::vector<uint8_t> copyUnflushed();
+
+  ReplayWriter &writer_;
+  std::string gameKey_;
+  std::vector<uint8_t> buffer_;      // whole log so far
+  size_t flushedBytes_ = 0;          // prefix already handed to the writer
+  std::vector<uint64_t> lastTimeMs_; // last record time per slot
+  bool finished_ = false;
+};
+
+} // namespace replay
+
+#endif // TETORIO_REPLAY_REPLAY_RECORDER_H
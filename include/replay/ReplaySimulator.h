@@ -0,0 +1,110 @@
+#ifndef TETORIO_REPLAY_REPLAY_SIMULATOR_H
+#define TETORIO_REPLAY_REPLAY_SIMULATOR_H
+
+#include "ReplayFormat.h"
+#include "game/Game.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace replay {
+
+/**
+ * SimulationResult stores the outcome of re-simulating a replay.
+ */
+struct SimulationResult {
+  bool complete = false;             // end record reached without error
+  uint64_t frames = 0;               // records applied
+  uint64_t durationMs = 0;           // game length from the end record
+  uint64_t finalHash = 0;            // hash of every slot's final state
+  std::vector<uint64_t> slotHashes;  // final state hash per slot
+};
+
+/**
+ * ReplaySimulator re-runs the games of a replay headlessly.
+ * it applies records in file order with no clock, so a game runs as fast
+ * as the input log can be decoded and produces the same states the
+ * server had.
+ */
+class ReplaySimulator {
+public:
+  /**
+   * constructor
+   */
+  ReplaySimulator() = default;
+
+  /**
+   * destructor
+   */
+  ~ReplaySimulator() = default;
+
+  // copy constructor and assignment operator deleted to prevent copying
+  ReplaySimulator(const ReplaySimulator &) = delete;
+  ReplaySimulator &operator=(const ReplaySimulator &) = delete;
+
+  /**
+   * start games from a replay header
+   * @param header replay header
+   */
+  void reset(const ReplayHeader &header);
+
+  /**
+   * restore every slot from keyframe snapshots, after reset()
+   * @param data pointer to one snapshot per slot
+   * @param len length of data
+   * @param frames frame count at the keyframe
+   * @return true if restored, false if malformed
+   */
+  bool restore(const uint8_t *data, size_t len, uint64_t frames);
+
+  /**
+   * apply one record
+   * @param record decoded record
+   * @return true if applied, false if the slot is out of range
+   */
+  bool apply(const ReplayRecord &record);
+
+  /**
+   * get game of a slot
+   * @param slot slot index
+   * @return reference to the game
+   */
+  const game::Game &getGame(size_t slot) const { return *games_[slot]; }
+
+  /**
+   * get number of slots
+   * @return slot count
+   */
+  size_t getSlotCount() const { return games_.size(); }
+
+  /**
+   * get number of records applied since reset
+   * @return frame count
+   */
+  uint64_t getFrameCount() const { return frames_; }
+
+  /**
+   * get hash combining the state of every slot
+   * @return combined state hash
+   */
+  uint64_t getStateHash() const;
+
+  /**
+   * re-simulate a whole replay
+   * @param data pointer to replay data
+   * @param len length of data
+   * @param result output result
+   * @return true if the replay decoded to its end record
+   */
+  bool run(const uint8_t *data, size_t len, SimulationResult &result);
+
+private:
+  std::vector<std::unique_ptr<game::Game>> games_; // game by slot
+  uint64_t frames_ = 0;
+};
+
+} // namespace replay
+
+#endif // TETORIO_REPLAY_REPLAY_SIMULATOR_H
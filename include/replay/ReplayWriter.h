@@ -0,0 +1,97 @@
+#ifndef TETORIO_REPLAY_REPLAY_WRITER_H
+#define TETORIO_REPLAY_REPLAY_WRITER_H
+
+#include "ReplayArchive.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace replay {
+
+/**
+ * ReplayWriter collects replay chunks on a background thread and appends
+ * each finished game to the replay archive.
+ * the event loop only moves a buffer into the queue under a mutex, so
+ * slow disks never block it; archive I/O and keyframe building happen on
+ * the writer thread.
+ */
+class ReplayWriter {
+public:
+  /**
+   * constructor, opens the archive and starts the writer thread
+   * @param directory archive directory, created if missing
+   * @param keyframeInterval pieces between keyframes
+   */
+  explicit ReplayWriter(const std::string &directory = "replays",
+                        uint32_t keyframeInterval = DEFAULT_KEYFRAME_INTERVAL);
+
+  /**
+   * destructor, writes queued chunks and stops the writer thread
+   */
+  ~ReplayWriter();
+
+  // copy constructor and assignment operator deleted to prevent copying
+  ReplayWriter(const ReplayWriter &) = delete;
+  ReplayWriter &operator=(const ReplayWriter &) = delete;
+
+  /**
+   * queue a chunk of a game replay
+   * @param gameKey key identifying the game until it is archived
+   * @param data chunk data, moved into the queue
+   * @param last whether the replay is complete after this chunk
+   */
+  void submit(const std::string &gameKey, std::vector<uint8_t> &&data,
+              bool last);
+
+  /**
+   * block until every queued chunk is written
+   */
+  void flush();
+
+  /**
+   * get archive directory
+   * @return directory path
+   */
+  const std::string &getDirectory() const { return directory_; }
+
+  /**
+   * get total replay bytes archived so far
+   * @return archived byte count
+   */
+  uint64_t getBytesWritten() const;
+
+private:
+  /**
+   * Chunk stores data waiting to be written.
+   */
+  struct Chunk {
+    std::string gameKey;
+    std::vector<uint8_t> data;
+    bool last = false;
+  };
+
+  /**
+   * writer thread main loop
+   */
+  void run();
+
+  std::string directory_;
+  ArchiveWriter archive_; // used by the writer thread only
+  std::deque<Chunk> queue_;
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;    // queue not empty or stopping
+  std::condition_variable drained_; // queue empty and nothing in flight
+  bool busy_ = false;               // writer thread holds a chunk
+  bool stopping_ = false;
+  uint64_t bytesWritten_ = 0;
+  std::thread thread_;
+};
+
+} // namespace replay
+
+#endif // TETORIO_REPLAY_REPLAY_WRITER_H
@@ -0,0 +1,189 @@
+#ifndef TETORIO_REPLAY_VERIFICATION_POOL_H
+#define TETORIO_REPLAY_VERIFICATION_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace replay {
+
+/**
+ * SlotReport stores what the server reported for one player of a game.
+ */
+struct SlotReport {
+  uint32_t playerId = 0;
+  uint32_t piecesPlaced = 0;
+  uint32_t linesCleared = 0;
+  uint32_t attackSent = 0;
+  bool toppedOut = false;
+  uint64_t toppedOutAtMs = 0; // time since game start, if topped out
+  uint64_t stateHash = 0;     // final game state hash
+};
+
+/**
+ * VerificationJob stores a finished game to re-simulate.
+ */
+struct VerificationJob {
+  uint32_t roomId = 0;
+  bool ranked = false;             // ranked games use the priority lane
+  std::vector<uint8_t> replay;     // complete replay bytes
+  std::vector<SlotReport> reports; // reported outcome by slot
+};
+
+/**
+ * Mismatch matches fields of a slot that did not match re-simulation.
+ */
+enum Mismatch : uint8_t {
+  MISMATCH_NONE = 0,
+  MISMATCH_PIECES = 1,
+  MISMATCH_LINES = 2,
+  MISMATCH_ATTACK = 4,
+  MISMATCH_TOP_OUT = 8, // topped out state or time
+  MISMATCH_STATE = 16   // final state hash
+};
+
+/**
+ * VerificationResult stores the outcome of a job.
+ */
+struct VerificationResult {
+  uint32_t roomId = 0;
+  bool ranked = false;
+  bool decoded = false;            // replay decoded to its end record
+  std::vector<uint32_t> playerIds; // player ID by slot
+  std::vector<uint8_t> mismatches; // Mismatch bits by slot
+
+  /**
+   * check if the game verified cleanly
+   * @return true if decoded and nothing mismatched
+   */
+  bool passed() const {
+    if (!decoded) {
+      return false;
+    }
+    for (uint8_t bits : mismatches) {
+      if (bits != MISMATCH_NONE) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+/**
+ * SubmitStatus matches what happened to a submitted job.
+ */
+enum class SubmitStatus : uint8_t {
+  QUEUED = 0,      // will be verified
+  SAMPLED_OUT = 1, // skipped by load shedding
+  DROPPED = 2      // queue full
+};
+
+/**
+ * VerificationPool re-simulates finished games on worker threads and
+ * compares the result with what the server reported.
+ *
+ * the queue is bounded and split into a ranked and a casual lane; workers
+ * always drain the ranked lane first. past half capacity casual games are
+ * sampled with a probability falling to zero at full capacity, and a
+ * ranked game arriving at a full queue evicts the oldest casual one, so
+ * submit() never waits on workers. results are collected by the event loop
+ * with pollResults(), and the notify fd becomes readable when results are
+ * waiting.
+ */
+class VerificationPool {
+public:
+  /**
+   * constructor, starts the workers
+   * @param threadCount number of workers (0 = half of hardware concurrency)
+   * @param capacity maximum queued jobs over both lanes
+   */
+  explicit VerificationPool(size_t threadCount = 0, size_t capacity = 1024);
+
+  /**
+   * destructor, stops workers, pending jobs are discarded
+   */
+  ~VerificationPool();
+
+  // copy constructor and assignment operator deleted to prevent copying
+  VerificationPool(const VerificationPool &) = delete;
+  VerificationPool &operator=(const VerificationPool &) = delete;
+
+  /**
+   * submit a job without blocking on workers
+   * @param job job to verify, moved if queued
+   * @return what happened to the job
+   */
+  SubmitStatus submit(VerificationJob &&job);
+
+  /**
+   * move finished results to out
+   * @param out output vector, appended
+   * @return number of results appended
+   */
+  size_t pollResults(std::vector<VerificationResult> &out);
+
+  /**
+   * get fd readable while results are waiting
+   * @return eventfd, -1 if unavailable
+   */
+  int getNotifyFd() const { return notifyFd_; }
+
+  /**
+   * get number of queued jobs
+   * @return queued job count
+   */
+  size_t getQueuedCount() const;
+
+  /**
+   * get number of jobs skipped by sampling
+   * @return sampled out count
+   */
+  uint64_t getSampledOutCount() const;
+
+  /**
+   * get number of jobs dropped or evicted
+   * @return dropped count
+   */
+  uint64_t getDroppedCount() const;
+
+  /**
+   * re-simulate a game and compare with its reports
+   * @param job job to verify
+   * @return verification result
+   */
+  static VerificationResult verify(const VerificationJob &job);
+
+private:
+  /**
+   * worker thread main loop
+   */
+  void run();
+
+  /**
+   * decide whether a casual job is kept under the current load
+   * @param depth queued job count
+   * @return true if kept
+   */
+  bool sampleCasual(size_t depth);
+
+  size_t capacity_;
+  std::deque<VerificationJob> ranked_; // priority lane
+  std::deque<VerificationJob> casual_;
+  std::vector<VerificationResult> results_;
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+  uint64_t sampleState_ = 0x9E3779B97F4A7C15ULL; // xorshift state
+  uint64_t sampledOut_ = 0;
+  uint64_t dropped_ = 0;
+  int notifyFd_ = -1;
+  std::vector<std::thread> threads_;
+};
+
+} // namespace replay
+
+#endif // TETORIO_REPLAY_VERIFICATION_POOL_H
@@ -0,0 +1,200 @@
+#ifndef TETORIO_ROOM_GARBAGE_LEDGER_H
+#define TETORIO_ROOM_GARBAGE_LEDGER_H
+
+#include "game/Board.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace room {
+
+// ticks an attack waits in the victim's queue before it lands
+constexpr uint32_t GARBAGE_DELAY_TICKS = 10;
+
+// most garbage lines landing on one player per tick
+constexpr int GARBAGE_CAP_PER_TICK = 8;
+
+// slot value meaning no slot
+constexpr size_t NO_SLOT = static_cast<size_t>(-1);
+
+/**
+ * TargetStrategy matches the strategy byte chosen by a player.
+ */
+enum class TargetStrategy : uint8_t {
+  RANDOM = 0,    // random alive opponent
+  ATTACKERS = 1, // whoever attacked this player last
+  KNOCKOUT = 2   // opponent closest to topping out
+};
+
+/**
+ * GarbageEventType matches the type byte of a garbage event.
+ */
+enum class GarbageEventType : uint8_t {
+  QUEUED = 1,    // slot sent lines to slot arg
+  CANCELLED = 2, // slot cancelled lines of its own pending garbage
+  APPLIED = 3,   // lines with hole column arg landed on slot
+  KNOCKOUT = 4   // slot went out, arg is its last attacker (slot if none)
+};
+
+/**
+ * GarbageEvent stores one garbage event of a tick, 4 bytes on the wire.
+ */
+struct GarbageEvent {
+  GarbageEventType type = GarbageEventType::QUEUED;
+  uint8_t slot = 0;  // slot the event is about
+  uint8_t arg = 0;   // target, hole column or attacker by type
+  uint8_t lines = 0; // lines, 0 for knockouts
+};
+
+/**
+ * GarbageDelivery stores the garbage landing on one slot in a tick.
+ */
+struct GarbageDelivery {
+  size_t slot = 0;
+  int count = 0; // number of segments
+  std::array<game::GarbageSegment, game::MAX_GARBAGE_SEGMENTS> segments;
+};
+
+/**
+ * GarbageLedger collects the attacks of a room during a tick and resolves
+ * them together: each attack first cancels the attacker's own pending
+ * garbage, the rest is queued on a target chosen by the attacker's
+ * strategy, and garbage that waited GARBAGE_DELAY_TICKS lands as one
+ * delivery per victim. slots are limited to 255 by the event format.
+ */
+class GarbageLedger {
+public:
+  /**
+   * constructor
+   * @param slotCount number of players
+   * @param seed seed for targets and holes
+   */
+  GarbageLedger(size_t slotCount, uint64_t seed);
+
+  /**
+   * destructor
+   */
+  ~GarbageLedger() = default;
+
+  /**
+   * collect an attack for the next resolve
+   * @param slot attacking slot
+   * @param lines garbage lines
+   */
+  void addAttack(size_t slot, int lines);
+
+  /**
+   * set the targeting strategy of a slot
+   * @param slot slot index
+   * @param strategy strategy for its attacks
+   */
+  void setStrategy(size_t slot, TargetStrategy strategy);
+
+  /**
+   * set how close a slot is to topping out, used by knockout targeting
+   * @param slot slot index
+   * @param height stack height of the slot
+   */
+  void setDanger(size_t slot, int height);
+
+  /**
+   * stop targeting a slot and drop its pending garbage
+   * @param slot slot index
+   */
+  void markOut(size_t slot);
+
+  /**
+   * resolve the attacks collected since the last call and advance a tick
+   * @param events garbage events, appended
+   * @param deliveries garbage landing this tick, replaced
+   */
+  void resolve(std::vector<GarbageEvent> &events,
+               std::vector<GarbageDelivery> &deliveries);
+
+  /**
+   * get pending garbage lines of a slot
+   * @param slot slot index
+   * @return lines queued on the slot
+   */
+  int getPendingLines(size_t slot) const { return pendingLines_[slot]; }
+
+  /**
+   * get the last slot that queued garbage on a slot
+   * @param slot slot index
+   * @return attacking slot, NO_SLOT if none
+   */
+  size_t getLastAttacker(size_t slot) const { return lastAttacker_[slot]; }
+
+  /**
+   * get the slot a slot is currently aiming at: its strategy's pick where
+   * that is known without randomness, else whoever it attacked last
+   * @param slot slot index
+   * @return target slot, NO_SLOT if none yet
+   */
+  size_t getTarget(size_t slot) const;
+
+  /**
+   * get the number of resolved ticks
+   * @return tick count
+   */
+  uint32_t getTick() const { return tick_; }
+
+private:
+  /**
+   * PendingGarbage stores an attack waiting in a victim's queue.
+   */
+  struct PendingGarbage {
+    uint32_t readyTick = 0; // tick the garbage may land
+    uint8_t holeColumn = 0;
+    int lines = 0;
+  };
+
+  /**
+   * Attack stores an attack collected during a tick.
+   */
+  struct Attack {
+    size_t slot = 0;
+    int lines = 0;
+  };
+
+  /**
+   * pick the target of an attack
+   * @param attacker attacking slot
+   * @return target slot, NO_SLOT if nobody else is alive
+   */
+  size_t pickTarget(size_t attacker);
+
+  /**
+   * find the two slots closest to topping out, once per tick
+   */
+  void updateKnockoutTargets();
+
+  /**
+   * check if a slot is still targetable
+   * @param slot slot index
+   * @return true if alive
+   */
+  bool isAlive(size_t slot) const { return alivePos_[slot] != NO_SLOT; }
+
+  std::vector<std::deque<PendingGarbage>> pending_; // queue by victim slot
+  std::vector<int> pendingLines_;                   // queued lines by slot
+  std::vector<TargetStrategy> strategies_;          // strategy by slot
+  std::vector<int> danger_;                         // stack height by slot
+  std::vector<size_t> lastAttacker_;                // last attacker by slot
+  std::vector<size_t> lastTarget_;                  // last target by slot
+  std::vector<size_t> alive_;    // alive slots, unordered
+  std::vector<size_t> alivePos_; // index in alive_ by slot, NO_SLOT if out
+  std::vector<Attack> attacks_;  // attacks of the current tick
+  size_t knockoutFirst_ = NO_SLOT;  // slot closest to topping out
+  size_t knockoutSecond_ = NO_SLOT; // runner up, when the first attacks
+  uint32_t tick_ = 0;
+  std::mt19937_64 rng_;
+};
+
+} // namespace room
+
+#endif // TETORIO_ROOM_GARBAGE_LEDGER_H
@@ -0,0 +1,194 @@
+#ifndef TETORIO_ROOM_MATCH_H
+#define TETORIO_ROOM_MATCH_H
+
+#include "GarbageLedger.h"
+#include "Room.h"
+#include "game/Game.h"
+#include "replay/ReplayRecorder.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace room {
+
+/**
+ * Match runs the games of every player in a room while it is playing.
+ * players are addressed by slot, their index in the room at game start,
+ * which is also the slot used by the replay.
+ */
+class Match {
+public:
+  /**
+   * constructor
+   * @param room room that started the game
+   * @param writer replay writer, nullptr to disable recording
+   * @param startedAtMs wall clock start time in unix ms
+   */
+  Match(const Room &room, replay::ReplayWriter *writer, uint64_t startedAtMs);
+
+  /**
+   * destructor
+   */
+  ~Match() = default;
+
+  // copy constructor and assignment operator deleted to prevent copying
+  Match(const Match &) = delete;
+  Match &operator=(const Match &) = delete;
+
+  /**
+   * apply an input of a player
+   * @param playerId player ID
+   * @param input input to apply
+   * @param timeMs time since game start
+   * @return result of the input, rejected if player not in match
+   */
+  game::InputResult applyInput(uint32_t playerId, game::Input input,
+                               uint64_t timeMs);
+
+  /**
+   * apply a placement of a player
+   * @param playerId player ID
+   * @param claim claimed placement
+   * @param timeMs time since game start
+   * @return result of the placement, rejected if unreachable
+   */
+  game::InputResult applyPlacement(uint32_t playerId,
+                                   const game::PlacementClaim &claim,
+                                   uint64_t timeMs);
+
+  /**
+   * mark a player as out of the game
+   * @param playerId player ID
+   * @param timeMs time since game start
+   * @return true if forfeited, false if not in match or already out
+   */
+  bool forfeit(uint32_t playerId, uint64_t timeMs);
+
+  /**
+   * set the garbage targeting strategy of a player
+   * @param playerId player ID
+   * @param strategy targeting strategy
+   * @return true if set, false if not in match or out
+   */
+  bool setTargeting(uint32_t playerId, TargetStrategy strategy);
+
+  /**
+   * resolve the garbage of one tick and land what has matured
+   * @param timeMs time since game start
+   * @return garbage events since the previous tick, valid until the next
+   */
+  const std::vector<GarbageEvent> &tick(uint64_t timeMs);
+
+  /**
+   * finish the replay
+   * @param timeMs time since game start
+   */
+  void finish(uint64_t timeMs);
+
+  /**
+   * check if at most one player is still alive
+   * @return true if the game is decided
+   */
+  bool isOver() const { return aliveCount_ <= 1; }
+
+  /**
+   * get the number of players still alive
+   * @return alive player count
+   */
+  size_t getAliveCount() const { return aliveCount_; }
+
+  /**
+   * check if a slot is out of the game
+   * @param slot slot index
+   * @return true if topped out or forfeited
+   */
+  bool isOut(size_t slot) const { return out_[slot]; }
+
+  /**
+   * get time a slot went out
+   * @param slot slot index
+   * @return time since game start, 0 if still alive
+   */
+  uint64_t getOutTimeMs(size_t slot) const { return outAtMs_[slot]; }
+
+  /**
+   * move the complete replay out, after finish()
+   * @return replay bytes, empty if recording is disabled
+   */
+  std::vector<uint8_t> takeReplay();
+
+  /**
+   * get the winner
+   * @return player ID of the last alive player, 0 if none
+   */
+  uint32_t getWinner() const;
+
+  /**
+   * get slot of a player
+   * @param playerId player ID
+   * @return slot index, -1 if not in match
+   */
+  int getSlot(uint32_t playerId) const;
+
+  /**
+   * get game of a slot
+   * @param slot slot index
+   * @return reference to the game
+   */
+  const game::Game &getGame(size_t slot) const { return *games_[slot]; }
+
+  /**
+   * get the garbage ledger
+   * @return reference to the ledger
+   */
+  const GarbageLedger &getGarbage() const { return garbage_; }
+
+  /**
+   * get player IDs by slot
+   * @return player IDs
+   */
+  const std::vector<uint32_t> &getPlayerIds() const { return playerIds_; }
+
+  /**
+   * get room ID
+   * @return room ID
+   */
+  uint32_t getRoomId() const { return roomId_; }
+
+private:
+  /**
+   * handle the outcome of an accepted input or placement
+   * @param slot slot index
+   * @param result result of the move
+   * @param timeMs time since game start
+   */
+  void onMoveApplied(size_t slot, const game::InputResult &result,
+                     uint64_t timeMs);
+
+  /**
+   * mark a slot as topped out
+   * @param slot slot index
+   * @param timeMs time since game start
+   */
+  void markOut(size_t slot, uint64_t timeMs);
+
+  uint32_t roomId_;
+  std::vector<uint32_t> playerIds_;                // player ID by slot
+  std::unordered_map<uint32_t, size_t> slotByPlayer_; // player ID -> slot
+  std::vector<std::unique_ptr<game::Game>> games_; // game by slot
+  std::vector<bool> out_;                          // topped out by slot
+  std::vector<uint64_t> outAtMs_;                  // top out time by slot
+  size_t aliveCount_ = 0;
+  GarbageLedger garbage_; // seeded by the sequence seed
+  std::vector<GarbageEvent> events_;        // events of the current tick
+  std::vector<GarbageEvent> tickEvents_;    // events of the last tick
+  std::vector<GarbageDelivery> deliveries_; // reused by tick()
+  std::unique_ptr<replay::ReplayRecorder> recorder_;
+};
+
+} // namespace room
+
+#endif // TETORIO_ROOM_MATCH_H
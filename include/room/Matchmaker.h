@@ -0,0 +1,186 @@
+#ifndef TETORIO_ROOM_MATCHMAKER_H
+#define TETORIO_ROOM_MATCHMAKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace room {
+
+// rating points covered by one rating bucket
+constexpr int RATING_BUCKET_WIDTH = 50;
+
+// ratings above this share the top bucket
+constexpr int MAX_MATCHMAKING_RATING = 5000;
+
+// upper bounds of the latency tiers in milliseconds, the last tier is open
+constexpr uint16_t LATENCY_TIER_LIMITS_MS[] = {60, 120, 200};
+constexpr size_t LATENCY_TIER_COUNT = 4;
+
+/**
+ * MatchmakerConfig stores matchmaking settings.
+ */
+struct MatchmakerConfig {
+  size_t matchSize = 2;              // players per match
+  int ratingWindow = 50;             // rating difference accepted at once
+  int ratingWidenPerSecond = 25;     // window growth per second waited
+  int maxRatingWindow = 1000;        // window never grows past this
+  uint32_t latencyWidenSeconds = 10; // wait per extra latency tier accepted
+};
+
+/**
+ * Matchmaker keeps queued players indexed by rating bucket and latency tier
+ * and forms matches in periodic batch passes. each bucket is a list ordered
+ * by queue time, so joining and leaving are O(1). a pass walks the queue
+ * oldest first; each player picks partners from the buckets inside its
+ * window, nearest rating and latency first, and the window widens the longer
+ * the player waits. once a player finds too few partners, newer players of
+ * the same bucket (whose windows are no wider) are skipped for the pass, so
+ * a pass costs O(players + buckets x window). callers hold a ticket per
+ * queued player instead of the queue hashing player IDs, which keeps join,
+ * leave and matching free of allocations once the entry pool has grown.
+ */
+class Matchmaker {
+public:
+  /**
+   * constructor
+   * @param config matchmaking settings
+   */
+  explicit Matchmaker(const MatchmakerConfig &config = MatchmakerConfig());
+
+  /**
+   * destructor
+   */
+  ~Matchmaker() = default;
+
+  // ticket value meaning not queued
+  static constexpr uint32_t NO_TICKET = UINT32_MAX;
+
+  /**
+   * queue a player, the caller keeps the ticket to leave the queue later;
+   * a player must leave before queueing again
+   * @param playerId player ID
+   * @param rating matchmaking rating
+   * @param latencyMs latency of the player to the server
+   * @param nowMs current time in milliseconds
+   * @return queue ticket, NO_TICKET if player ID is 0
+   */
+  uint32_t join(uint32_t playerId, int rating, uint16_t latencyMs,
+                uint64_t nowMs);
+
+  /**
+   * remove a player from the queue
+   * @param ticket ticket returned by join()
+   * @param playerId player ID the ticket was issued to
+   * @return true if removed, false if the ticket is not queued
+   */
+  bool leave(uint32_t ticket, uint32_t playerId);
+
+  /**
+   * check if a ticket is still queued
+   * @param ticket ticket returned by join()
+   * @param playerId player ID the ticket was issued to
+   * @return true if queued
+   */
+  bool isQueued(uint32_t ticket, uint32_t playerId) const {
+    return ticket < entries_.size() && entries_[ticket].playerId == playerId &&
+           playerId != 0;
+  }
+
+  /**
+   * run a batch pass, matched players leave the queue and their tickets
+   * become invalid
+   * @param nowMs current time in milliseconds
+   * @param maxMatches most matches to form, e.g. free rooms
+   * @param matched player IDs of formed matches, matchSize per match,
+   * appended
+   * @return number of matches formed
+   */
+  size_t formMatches(uint64_t nowMs, size_t maxMatches,
+                     std::vector<uint32_t> &matched);
+
+  /**
+   * get the number of queued players
+   * @return queue size
+   */
+  size_t getQueuedCount() const { return queuedCount_; }
+
+  /**
+   * get the number of players per match
+   * @return match size
+   */
+  size_t getMatchSize() const { return config_.matchSize; }
+
+private:
+  // entry index meaning none
+  static constexpr uint32_t NO_ENTRY = UINT32_MAX;
+
+  /**
+   * Entry stores a queued player, linked into its bucket and the queue.
+   */
+  struct Entry {
+    uint32_t playerId = 0;    // 0 once the entry is free
+    uint32_t bucket = 0;      // bucket index
+    uint64_t joinedAtMs = 0;  // queue time
+    uint32_t prev = NO_ENTRY; // bucket list, older neighbour
+    uint32_t next = NO_ENTRY; // bucket list, newer neighbour
+    uint32_t queuePrev = NO_ENTRY; // queue list, older neighbour
+    uint32_t queueNext = NO_ENTRY; // queue list, newer neighbour
+  };
+
+  /**
+   * Bucket stores the players of one rating bucket and latency tier.
+   */
+  struct Bucket {
+    uint32_t head = NO_ENTRY; // oldest entry
+    uint32_t tail = NO_ENTRY; // newest entry
+    uint32_t count = 0;
+    uint32_t failedPass = 0; // last pass a player of the bucket found no match
+  };
+
+  /**
+   * get the bucket of a rating and latency
+   * @param rating matchmaking rating
+   * @param latencyMs latency in milliseconds
+   * @return bucket index
+   */
+  uint32_t bucketOf(int rating, uint16_t latencyMs) const;
+
+  /**
+   * get a bucket by latency tier and rating bucket
+   * @param tier latency tier
+   * @param rating rating bucket
+   * @return bucket
+   */
+  Bucket &bucketAt(int tier, int rating) {
+    return buckets_[static_cast<size_t>(tier) * ratingBuckets_ +
+                    static_cast<size_t>(rating)];
+  }
+
+  /**
+   * link an entry at the tail of its bucket and the queue
+   * @param entry entry index
+   */
+  void link(uint32_t entry);
+
+  /**
+   * unlink an entry from its bucket and the queue and free it; its own
+   * queue link stays valid until the next join so a pass can step past it
+   * @param entry entry index
+   */
+  void unlink(uint32_t entry);
+
+  MatchmakerConfig config_;
+  size_t ratingBuckets_;                          // buckets per latency tier
+  std::vector<Entry> entries_;                    // entry storage
+  std::vector<uint32_t> free_;                    // free entry indices
+  std::vector<Bucket> buckets_;                   // tier major, rating minor
+  size_t queuedCount_ = 0;                        // live entries
+  uint32_t queueHead_ = NO_ENTRY;                 // oldest queued entry
+  uint32_t queueTail_ = NO_ENTRY;                 // newest queued entry
+  uint32_t pass_ = 0;                             // passes run so far
+};
+
+} // namespace room
+
+#endif // TETORIO_ROOM_MATCHMAKER_H
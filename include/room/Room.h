@@ -1,13 +1,30 @@
 #ifndef TETORIO_ROOM_ROOM_H
 #define TETORIO_ROOM_ROOM_H
 
+#include "game/PieceSequence.h"
+
 #include <cstdint>
 #include <ctime>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace room {
 
+// largest room, battle royale size
+constexpr uint8_t MAX_ROOM_PLAYERS = 99;
+
+// player IDs from here up are server-side bots, sessions count up from 1
+constexpr uint32_t FIRST_BOT_ID = 0x80000000u;
+
+/**
+ * check if a player ID belongs to a bot
+ * @param playerId player ID
+ * @return true if the player is a bot
+ */
+inline bool isBotId(uint32_t playerId) { return playerId >= FIRST_BOT_ID; }
+
 /**
  * GameState store current game room state.
  */
@@ -24,12 +41,19 @@ struct Room {
   uint32_t roomId = 0;                      // unique room ID
   std::string roomName;                     // room name
   uint32_t hostPlayerId = 0;                // host player ID
-  std::vector<uint32_t> playerIds;          // player IDs in the room
+  std::vector<uint32_t> playerIds;          // player IDs, unordered
+  std::unordered_map<uint32_t, size_t> memberIndex; // ID -> playerIds index
+  std::vector<uint32_t> spectatorIds; // spectator IDs, not counted as players
+  std::unordered_map<uint32_t, size_t> spectatorIndex; // ID -> spectatorIds
   GameState gameState = GameState::WAITING; // current game state
-  uint8_t maxPlayers = 32;                  // maximum players
+  uint8_t maxPlayers = MAX_ROOM_PLAYERS;    // maximum players
+  bool ranked = false;                      // results count for rating
   time_t createdAt = 0;                     // room creation timestamp
   time_t startedAt = 0;                     // game start timestamp
 
+  // piece sequence shared by all players during a game
+  std::shared_ptr<game::PieceSequence> pieceSequence;
+
   /**
    * default constructor
    */
@@ -44,7 +68,7 @@ struct Room {
   Room(uint32_t id, const std::string &name, uint32_t hostId)
       : roomId(id), roomName(name), hostPlayerId(hostId),
         createdAt(std::time(nullptr)) {
-    playerIds.push_back(hostId);
+    addPlayer(hostId);
   }
 
   /**
@@ -73,8 +97,16 @@ struct Room {
    * @return true if player is in the room, false otherwise
    */
   bool hasPlayer(uint32_t playerId) const {
-    for (uint32_t id : playerIds) {
-      if (id == playerId) {
+    return memberIndex.find(playerId) != memberIndex.end();
+  }
+
+  /**
+   * check if any player of the room is not a bot
+   * @return true if a human player is in the room
+   */
+  bool hasHumanPlayer() const {
+    for (uint32_t playerId : playerIds) {
+      if (!isBotId(playerId)) {
         return true;
       }
     }
@@ -109,6 +141,7 @@ struct Room {
     if (isFull() || hasPlayer(playerId)) {
       return false;
     }
+    memberIndex[playerId] = playerIds.size();
     playerIds.push_back(playerId);
     return true;
   }
@@ -119,18 +152,74 @@ struct Room {
    * @return true if removed, false if player not found
    */
   bool removePlayer(uint32_t playerId) {
-    for (auto it = playerIds.begin(); it != playerIds.end(); ++it) {
-      if (*it == playerId) {
-        playerIds.erase(it);
+    auto it = memberIndex.find(playerId);
+    if (it == memberIndex.end()) {
+      return false;
+    }
+
+    // move the last player into the hole, slots are fixed by Match anyway
+    size_t index = it->second;
+    uint32_t last = playerIds.back();
+    playerIds[index] = last;
+    memberIndex[last] = index;
+    playerIds.pop_back();
+    memberIndex.erase(playerId);
 
-        // assign new host to first player if host left
-        if (hostPlayerId == playerId && !playerIds.empty()) {
-          hostPlayerId = playerIds.front();
+    // assign new host to first human player if host left, bots can not
+    // start games
+    if (hostPlayerId == playerId && !playerIds.empty()) {
+      hostPlayerId = playerIds.front();
+      for (uint32_t id : playerIds) {
+        if (!isBotId(id)) {
+          hostPlayerId = id;
+          break;
         }
-        return true;
       }
     }
-    return false;
+    return true;
+  }
+
+  /**
+   * check if player is watching the room
+   * @param playerId player ID to check
+   * @return true if spectating, false otherwise
+   */
+  bool hasSpectator(uint32_t playerId) const {
+    return spectatorIndex.find(playerId) != spectatorIndex.end();
+  }
+
+  /**
+   * add spectator to the room, spectators do not take player places
+   * @param playerId player ID to add
+   * @return true if added, false if already playing or spectating
+   */
+  bool addSpectator(uint32_t playerId) {
+    if (hasPlayer(playerId) || hasSpectator(playerId)) {
+      return false;
+    }
+    spectatorIndex[playerId] = spectatorIds.size();
+    spectatorIds.push_back(playerId);
+    return true;
+  }
+
+  /**
+   * remove spectator from the room
+   * @param playerId player ID to remove
+   * @return true if removed, false if not spectating
+   */
+  bool removeSpectator(uint32_t playerId) {
+    auto it = spectatorIndex.find(playerId);
+    if (it == spectatorIndex.end()) {
+      return false;
+    }
+
+    size_t index = it->second;
+    uint32_t last = spectatorIds.back();
+    spectatorIds[index] = last;
+    spectatorIndex[last] = index;
+    spectatorIds.pop_back();
+    spectatorIndex.erase(playerId);
+    return true;
   }
 
   /**
@@ -143,6 +232,7 @@ struct Room {
     }
     gameState = GameState::PLAYING;
     startedAt = std::time(nullptr);
+    pieceSequence = std::make_shared<game::PieceSequence>();
     return true;
   }
 
@@ -157,6 +247,16 @@ struct Room {
   void reset() {
     gameState = GameState::WAITING;
     startedAt = 0;
+    pieceSequence.reset();
+  }
+
+  /**
+   * get the seed of the current piece sequence, sent to clients once so they
+   * can generate the same sequence locally
+   * @return seed, 0 if no game has been started
+   */
+  uint64_t getSequenceSeed() const {
+    return pieceSequence ? pieceSequence->getSeed() : 0;
   }
 };
 
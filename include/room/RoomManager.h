@@ -2,6 +2,7 @@
 #define TETORIO_ROOM_ROOM_MANAGER_H
 
 #include "Room.h"
+#include "network/Arena.h"
 
 #include <cstdint>
 #include <functional>
@@ -43,6 +44,14 @@ public:
    */
   uint32_t createRoom(const std::string &roomName, uint32_t hostPlayerId);
 
+  /**
+   * create a room for a formed match, every player joins at once
+   * @param playerIds players of the match, the first one hosts
+   * @param count number of players
+   * @return new room ID, 0 if no room is free or a player is in a room
+   */
+  uint32_t createMatchRoom(const uint32_t *playerIds, size_t count);
+
   /**
    * remove a room by room ID
    * @param roomId room ID to remove
@@ -101,6 +110,29 @@ public:
    */
   bool leaveRoom(uint32_t playerId);
 
+  /**
+   * watch a room without joining it, spectators do not count against
+   * maxPlayers and may watch a game in progress
+   * @param roomId room ID to watch
+   * @param playerId player ID
+   * @return true if spectating, false if room not found or player in a room
+   */
+  bool spectateRoom(uint32_t roomId, uint32_t playerId);
+
+  /**
+   * stop watching a room
+   * @param playerId player ID
+   * @return true if stopped, false if player was not spectating
+   */
+  bool stopSpectating(uint32_t playerId);
+
+  /**
+   * get the room a player is watching
+   * @param playerId player ID
+   * @return room ID, 0 if player is not spectating
+   */
+  uint32_t getSpectatedRoomId(uint32_t playerId) const;
+
   /**
    * start game in a room
    * @param roomId room ID
@@ -128,6 +160,21 @@ public:
    */
   std::vector<uint32_t> getWaitingRoomIds() const;
 
+  /**
+   * get all room IDs without a heap allocation
+   * @param arena arena holding the result
+   * @return span of room IDs, valid until the arena resets
+   */
+  network::Span<const uint32_t> getAllRoomIds(network::Arena &arena) const;
+
+  /**
+   * get all waiting room IDs without a heap allocation
+   * @param arena arena holding the result
+   * @return span of waiting room IDs, valid until the arena resets
+   */
+  network::Span<const uint32_t>
+  getWaitingRoomIds(network::Arena &arena) const;
+
   /**
    * get total room count
    * @return number of rooms
@@ -140,6 +187,14 @@ public:
    */
   bool isMaxRoomsReached() const { return rooms_.size() >= maxRooms_; }
 
+  /**
+   * get the number of rooms that can still be created
+   * @return free room count
+   */
+  size_t getFreeRoomCount() const {
+    return isMaxRoomsReached() ? 0 : maxRooms_ - rooms_.size();
+  }
+
   /**
    * set room created callback
    * @param callback callback function
@@ -197,6 +252,7 @@ private:
 
   std::unordered_map<uint32_t, Room> rooms_;            // roomId -> room
   std::unordered_map<uint32_t, uint32_t> playerToRoom_; // playerId -> roomId
+  std::unordered_map<uint32_t, uint32_t> spectatorToRoom_; // spectator -> room
   uint32_t nextRoomId_ = 1; // next room ID to assign
   size_t maxRooms_;         // maximum number of rooms
 
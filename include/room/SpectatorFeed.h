@@ -0,0 +1,157 @@
+#ifndef TETORIO_ROOM_SPECTATOR_FEED_H
+#define TETORIO_ROOM_SPECTATOR_FEED_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace room {
+
+class Match;
+
+// frames a delta may span, older bases get a keyframe
+constexpr uint32_t SPECTATOR_HISTORY = 8;
+
+// frame buffers a feed keeps for reuse, enough for every base of a few
+// frames still queued to slow spectators
+constexpr size_t SPECTATOR_FRAME_BUFFERS = 4 * (SPECTATOR_HISTORY + 1);
+
+/**
+ * SpectatorFeed builds the spectator frames of a match. frames are numbered
+ * and a delta applies on top of the frame it names as base. the state of
+ * the last SPECTATOR_HISTORY frames is kept, so a spectator that skipped
+ * frames (paced or backlogged) gets one delta merged from the frame it has.
+ * each frame is encoded at most once per base no matter how many spectators
+ * watch, and every spectator is sent a reference to the same bytes. older
+ * bases and late joiners get a keyframe.
+ *
+ * frame payload (little endian):
+ *   u32 frame version, u32 base version (0 = keyframe)
+ *   u32 tick, u8 alive count
+ *   u8 board count, boards of [u8 slot, u8 flags (1 = out),
+ *      u8 pending garbage, game::BoardEncoder frame]
+ * a delta lists the boards that changed since the base frame, a keyframe
+ * lists every board.
+ */
+class SpectatorFeed {
+public:
+  // complete SPECTATOR_FRAME message shared by all spectators
+  using Frame = std::shared_ptr<const std::vector<uint8_t>>;
+
+  /**
+   * constructor
+   * @param slotCount number of players in the match
+   */
+  explicit SpectatorFeed(size_t slotCount);
+
+  /**
+   * destructor
+   */
+  ~SpectatorFeed() = default;
+
+  /**
+   * check if the match moved on since the last frame
+   * @param match match of the room
+   * @return true if a new frame would carry anything
+   */
+  bool hasChanges(const Match &match) const;
+
+  /**
+   * take the next frame from the match; nothing is encoded until a
+   * spectator asks for it
+   * @param match match of the room
+   */
+  void publish(const Match &match);
+
+  /**
+   * get the latest frame for a spectator, encoded at most once per base;
+   * the match must not have changed since publish()
+   * @param match match of the room
+   * @param baseVersion frame the spectator has, 0 if none
+   * @return delta from baseVersion if it is recent enough, otherwise a
+   * keyframe; nullptr if nothing was published yet
+   */
+  Frame getFrame(const Match &match, uint32_t baseVersion);
+
+  /**
+   * get a keyframe of the latest frame
+   * @param match match of the room
+   * @return keyframe, nullptr if nothing was published yet
+   */
+  Frame getKeyframe(const Match &match) { return getFrame(match, 0); }
+
+  /**
+   * get the version of the latest frame
+   * @return frame version, 0 if nothing was published yet
+   */
+  uint32_t getVersion() const { return version_; }
+
+private:
+  /**
+   * SlotState stores what spectators saw of a slot in one frame.
+   */
+  struct SlotState {
+    uint32_t boardVersion = 0;
+    int pending = 0;
+    bool out = false;
+  };
+
+  /**
+   * get the slot states of a frame in the history
+   * @param version frame version, at most SPECTATOR_HISTORY frames old
+   * @return first of slotCount_ states
+   */
+  const SlotState *statesOf(uint32_t version) const {
+    return &history_[(version % SPECTATOR_HISTORY) * slotCount_];
+  }
+
+  /**
+   * get an empty buffer for a new frame, reusing one no spectator still
+   * has queued
+   * @return frame buffer
+   */
+  std::shared_ptr<std::vector<uint8_t>> takeBuffer();
+
+  /**
+   * append the spectator view of one slot
+   * @param match match of the room
+   * @param slot slot index
+   * @param baseVersion board version the spectator has, 0 for keyframes
+   * @param out output buffer
+   */
+  void appendSlot(const Match &match, size_t slot, uint32_t baseVersion,
+                  std::vector<uint8_t> &out) const;
+
+  /**
+   * start a frame message
+   * @param baseVersion version the frame applies to, 0 for keyframes
+   * @param out output buffer, replaced
+   */
+  void beginFrame(uint32_t baseVersion, std::vector<uint8_t> &out) const;
+
+  /**
+   * patch the message header once the payload is complete
+   * @param out frame buffer
+   */
+  static void endFrame(std::vector<uint8_t> &out);
+
+  size_t slotCount_;
+  uint32_t version_ = 0;  // latest frame
+  uint32_t tick_ = 0;     // match tick of the latest frame
+  uint8_t alive_ = 0;     // alive count of the latest frame
+
+  // slot states of the last SPECTATOR_HISTORY frames, frame major
+  std::vector<SlotState> history_;
+
+  // frames encoded for the latest version by base, 0 = keyframe
+  std::vector<std::pair<uint32_t, Frame>> frames_;
+
+  // buffers of recent frames, free again once only the feed holds them
+  std::vector<std::shared_ptr<std::vector<uint8_t>>> buffers_;
+};
+
+} // namespace room
+
+#endif // TETORIO_ROOM_SPECTATOR_FEED_H
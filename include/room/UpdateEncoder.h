@@ -0,0 +1,147 @@
+#ifndef TETORIO_ROOM_UPDATE_ENCODER_H
+#define TETORIO_ROOM_UPDATE_ENCODER_H
+
+#include "GarbageLedger.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace room {
+
+class Match;
+
+// most opponents a player receives full boards of
+constexpr size_t MAX_FULL_BOARDS = 8;
+
+// most board summaries per tick, so summary bytes per tick grow linearly
+// with room size and large rooms refresh thumbnails less often instead
+constexpr size_t MAX_SUMMARIES_PER_TICK = 8;
+
+// size of one board summary on the wire
+constexpr size_t BOARD_SUMMARY_SIZE = 3 + game::BOARD_WIDTH;
+
+/**
+ * UpdateEncoder builds the per-player tick updates of a match.
+ * everything every player gets (aggregates, knockouts and board summaries)
+ * is encoded once per tick; each player then adds the garbage events that
+ * concern it and full board deltas of its interest set, which is its
+ * current target and the players targeting it. board deltas are encoded at
+ * most once per board and tick, and shared by every player receiving them.
+ * a paced player skips boards on some ticks; its next update carries one
+ * delta merged from the version it has, encoded for that player alone.
+ *
+ * update payload (little endian):
+ *   u32 tick, u8 alive count, u16 lines queued in the room this tick
+ *   u8 summary count, summaries of [u8 slot, u8 flags (1 = out),
+ *      u8 pending garbage, u8 column heights x BOARD_WIDTH]
+ *   u16 event count, knockouts then own garbage events (4 bytes each)
+ *   u8 board count, boards of [u8 slot, game::BoardEncoder frame]
+ */
+class UpdateEncoder {
+public:
+  /**
+   * constructor
+   * @param slotCount number of players in the match
+   */
+  explicit UpdateEncoder(size_t slotCount);
+
+  /**
+   * destructor
+   */
+  ~UpdateEncoder() = default;
+
+  /**
+   * prepare the shared part of a tick, after Match::tick()
+   * @param match match of the room
+   * @param events garbage events of the tick
+   */
+  void beginTick(const Match &match, const std::vector<GarbageEvent> &events);
+
+  /**
+   * build the update frame of one player
+   * @param slot slot of the player
+   * @param frame output frame, replaced
+   * @param boardsDue whether full boards go out this tick, events and
+   * summaries always do
+   * @return true if there is anything to send
+   */
+  bool encodeFor(size_t slot, std::vector<uint8_t> &frame,
+                 bool boardsDue = true);
+
+  /**
+   * forget which boards a player has, e.g. after its connection dropped;
+   * boards of its interest set go out as keyframes
+   * @param slot slot of the player
+   */
+  void forgetSent(size_t slot);
+
+  /**
+   * set the version of a board a player reports to have, so the next
+   * update is a delta from it
+   * @param slot slot of the player
+   * @param opponent slot of the board
+   * @param version board version held, ignored if newer than the board
+   */
+  void restoreSent(size_t slot, size_t opponent, uint32_t version);
+
+private:
+  // sent version meaning the player has no copy of the board
+  static constexpr uint32_t UNKNOWN_VERSION = UINT32_MAX;
+
+  /**
+   * rebuild the interest set of every player
+   */
+  void updateInterest();
+
+  /**
+   * append a board frame for a player; deltas from the previous tick and
+   * keyframes are encoded once per tick, older bases once per player
+   * @param opponent slot of the board
+   * @param sent board version the player has
+   * @param out output buffer
+   */
+  void appendBoard(size_t opponent, uint32_t sent, std::vector<uint8_t> &out);
+
+  const Match *match_ = nullptr;
+  const std::vector<GarbageEvent> *events_ = nullptr;
+  size_t slotCount_;
+
+  // shared part of the current tick
+  std::vector<uint8_t> shared_;
+  size_t countOffset_ = 0;  // offset of the event count in shared_
+  size_t knockouts_ = 0;    // knockout events in shared_
+  size_t summaryCount_ = 0; // board summaries in shared_
+
+  // own events by slot: indices into events_, grouped by counting sort
+  std::vector<uint32_t> eventStart_; // slotCount_ + 1 offsets into eventOrder_
+  std::vector<uint32_t> eventOrder_;
+  std::vector<uint32_t> eventFill_;
+
+  // interest sets by slot, at most MAX_FULL_BOARDS each
+  std::vector<std::vector<size_t>> interest_;
+  std::vector<std::vector<size_t>> previousInterest_;
+
+  // board versions: at the previous tick, at this tick, and sent per
+  // player as sentVersions_[player * slotCount_ + opponent]
+  std::vector<uint32_t> previousVersions_;
+  std::vector<uint32_t> currentVersions_;
+  std::vector<uint32_t> sentVersions_;
+
+  // boards encoded this tick, offsets into boardPool_, length 0 if not yet
+  std::vector<uint8_t> boardPool_;
+  std::vector<size_t> deltaOffsets_;
+  std::vector<size_t> deltaLengths_;
+  std::vector<size_t> keyframeOffsets_;
+  std::vector<size_t> keyframeLengths_;
+
+  // state last put into a summary by slot
+  std::vector<uint32_t> summaryVersions_;
+  std::vector<int> summaryPending_;
+  std::vector<bool> summaryOut_;
+  size_t summaryCursor_ = 0; // slot the next summary scan starts at
+};
+
+} // namespace room
+
+#endif // TETORIO_ROOM_UPDATE_ENCODER_H
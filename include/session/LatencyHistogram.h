@@ -0,0 +1,67 @@
+#ifndef TETORIO_SESSION_LATENCY_HISTOGRAM_H
+#define TETORIO_SESSION_LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace session {
+
+/**
+ * LatencyHistogram aggregates rtt samples of all sessions in log-linear
+ * buckets: every power of two of microseconds is split into 8 buckets, so
+ * any recorded value is off by at most 12.5%. recording is O(1) into a
+ * fixed array and values above about 30 seconds share the last bucket.
+ */
+class LatencyHistogram {
+public:
+  // sub-buckets per power of two, as bits
+  static constexpr int SUB_BUCKET_BITS = 3;
+  static constexpr size_t BUCKET_COUNT = 184;
+
+  /**
+   * record a sample
+   * @param rttNs round trip time in nanoseconds
+   */
+  void record(uint64_t rttNs);
+
+  /**
+   * get a percentile of the recorded samples
+   * @param fraction percentile as a fraction, e.g. 0.99
+   * @return lower bound of the bucket holding it in nanoseconds, 0 if empty
+   */
+  uint64_t getPercentileNs(double fraction) const;
+
+  /**
+   * get the number of recorded samples
+   * @return sample count
+   */
+  uint64_t getCount() const { return count_; }
+
+  /**
+   * forget all samples
+   */
+  void clear();
+
+private:
+  /**
+   * get the bucket of a value
+   * @param micros value in microseconds
+   * @return bucket index
+   */
+  static size_t bucketOf(uint64_t micros);
+
+  /**
+   * get the smallest value of a bucket
+   * @param bucket bucket index
+   * @return value in microseconds
+   */
+  static uint64_t lowerBound(size_t bucket);
+
+  std::array<uint64_t, BUCKET_COUNT> buckets_{};
+  uint64_t count_ = 0;
+};
+
+} // namespace session
+
+#endif // TETORIO_SESSION_LATENCY_HISTOGRAM_H
@@ -0,0 +1,81 @@
+#ifndef TETORIO_SESSION_RATE_CONTROLLER_H
+#define TETORIO_SESSION_RATE_CONTROLLER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace session {
+
+// longest gap between opponent board updates in ticks
+constexpr uint32_t MAX_UPDATE_INTERVAL = 6;
+
+// queued bytes above which a connection counts as congested
+constexpr size_t RATE_QUEUE_HIGH_BYTES = 16384;
+
+// queued bytes below which a connection counts as clear
+constexpr size_t RATE_QUEUE_LOW_BYTES = 2048;
+
+// rtt above which a connection counts as congested, and below which clear
+constexpr uint32_t RATE_RTT_HIGH_MS = 250;
+constexpr uint32_t RATE_RTT_LOW_MS = 150;
+
+// clear samples in a row before the interval steps down
+constexpr uint32_t RATE_RECOVERY_SAMPLES = 5;
+
+/**
+ * RateController picks how often a connection gets opponent boards and
+ * spectator frames. it is fed periodic samples of the send queue and rtt;
+ * a congested sample doubles the update interval at once, and each run of
+ * clear samples shortens it by one tick, so a bad link backs off fast and
+ * recovers without oscillating. own-board acks are never paced.
+ */
+struct RateController {
+  uint32_t interval = 1;     // ticks between opponent board updates
+  uint32_t clearSamples = 0; // clear samples in a row
+  uint32_t retransmits = 0;  // retransmit count at the last sample
+  uint32_t samples = 0;      // samples taken
+
+  /**
+   * take a sample
+   * @param queuedBytes bytes queued for the connection, buffered or in the
+   * kernel
+   * @param rttMs rtt estimate in milliseconds, 0 if unknown
+   * @param totalRetransmits retransmits of the connection so far
+   */
+  void update(size_t queuedBytes, uint32_t rttMs, uint32_t totalRetransmits) {
+    // retransmits count from the first sample on
+    bool lossy = samples++ > 0 && totalRetransmits > retransmits;
+    retransmits = totalRetransmits;
+
+    if (queuedBytes > RATE_QUEUE_HIGH_BYTES || rttMs > RATE_RTT_HIGH_MS ||
+        lossy) {
+      interval = std::min(interval * 2, MAX_UPDATE_INTERVAL);
+      clearSamples = 0;
+      return;
+    }
+    if (queuedBytes >= RATE_QUEUE_LOW_BYTES || rttMs >= RATE_RTT_LOW_MS) {
+      clearSamples = 0; // in between, hold the interval
+      return;
+    }
+    if (++clearSamples >= RATE_RECOVERY_SAMPLES) {
+      interval = std::max<uint32_t>(interval - 1, 1);
+      clearSamples = 0;
+    }
+  }
+
+  /**
+   * check if a paced update is due this tick, staggered by a key so paced
+   * connections do not all send on the same tick
+   * @param tick current tick
+   * @param key stagger key, e.g. the player ID
+   * @return true if due
+   */
+  bool isDue(uint64_t tick, uint32_t key) const {
+    return interval <= 1 || (tick + key) % interval == 0;
+  }
+};
+
+} // namespace session
+
+#endif // TETORIO_SESSION_RATE_CONTROLLER_H
@@ -0,0 +1,112 @@
+#ifndef TETORIO_SESSION_RTT_ESTIMATOR_H
+#define TETORIO_SESSION_RTT_ESTIMATOR_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace session {
+
+// samples kept by the min filter, one per ping interval
+constexpr size_t RTT_MIN_WINDOW = 8;
+
+/**
+ * RttEstimator tracks the round trip time of one connection from
+ * application level pings. smoothed rtt and jitter follow the TCP
+ * estimator (EWMA with gains 1/8 and 1/4); the minimum over the last
+ * RTT_MIN_WINDOW samples approximates the path delay without queueing.
+ * all times are monotonic nanoseconds, storage is fixed.
+ */
+struct RttEstimator {
+  uint64_t smoothedNs = 0; // EWMA of samples
+  uint64_t jitterNs = 0;   // EWMA of deviation from smoothedNs
+  uint64_t lastNs = 0;     // latest sample
+  std::array<uint64_t, RTT_MIN_WINDOW> window{}; // latest samples, ring
+  uint32_t samples = 0;    // samples taken
+  uint32_t lost = 0;       // pings not answered before the next one
+
+  uint32_t pingSequence = 0; // sequence of the outstanding ping
+  uint64_t pingSentNs = 0;   // send time of the outstanding ping, 0 if none
+
+  /**
+   * check if any sample was taken
+   * @return true if the estimates are valid
+   */
+  bool hasSamples() const { return samples > 0; }
+
+  /**
+   * start a ping, an unanswered previous one counts as lost
+   * @param nowNs current monotonic time
+   * @return sequence to send with the ping
+   */
+  uint32_t startPing(uint64_t nowNs) {
+    if (pingSentNs != 0) {
+      ++lost;
+    }
+    pingSentNs = nowNs;
+    return ++pingSequence;
+  }
+
+  /**
+   * take a sample from a pong
+   * @param sequence sequence echoed by the client
+   * @param sentNs send time echoed by the client
+   * @param nowNs current monotonic time
+   * @return true if the pong answers the outstanding ping
+   */
+  bool onPong(uint32_t sequence, uint64_t sentNs, uint64_t nowNs) {
+    // only the server's own send time is trusted
+    if (pingSentNs == 0 || sequence != pingSequence || sentNs != pingSentNs ||
+        nowNs < pingSentNs) {
+      return false;
+    }
+    addSample(nowNs - pingSentNs);
+    pingSentNs = 0;
+    return true;
+  }
+
+  /**
+   * add an rtt sample
+   * @param rttNs measured round trip time
+   */
+  void addSample(uint64_t rttNs) {
+    if (samples == 0) {
+      smoothedNs = rttNs;
+      jitterNs = rttNs / 2;
+    } else {
+      uint64_t deviation =
+          rttNs > smoothedNs ? rttNs - smoothedNs : smoothedNs - rttNs;
+      jitterNs = jitterNs - jitterNs / 4 + deviation / 4;
+      smoothedNs = smoothedNs - smoothedNs / 8 + rttNs / 8;
+    }
+    window[samples % RTT_MIN_WINDOW] = rttNs;
+    lastNs = rttNs;
+    ++samples;
+  }
+
+  /**
+   * get the minimum of the recent samples
+   * @return minimum rtt in nanoseconds, 0 if no samples
+   */
+  uint64_t getMinNs() const {
+    size_t count = std::min<size_t>(samples, RTT_MIN_WINDOW);
+    if (count == 0) {
+      return 0;
+    }
+    return *std::min_element(window.begin(), window.begin() + count);
+  }
+
+  /**
+   * get the smoothed rtt in whole milliseconds, for coarse decisions
+   * @return smoothed rtt rounded up, capped at UINT16_MAX
+   */
+  uint16_t getSmoothedMs() const {
+    uint64_t ms = (smoothedNs + 999999) / 1000000;
+    return static_cast<uint16_t>(std::min<uint64_t>(ms, UINT16_MAX));
+  }
+};
+
+} // namespace session
+
+#endif // TETORIO_SESSION_RTT_ESTIMATOR_H
@@ -1,12 +1,23 @@
 #ifndef TETORIO_SESSION_SESSION_H
 #define TETORIO_SESSION_SESSION_H
 
+#include "RateController.h"
+#include "RttEstimator.h"
+
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <ctime>
 #include <vector>
 
 namespace session {
 
+// matchmaking rating of players without rated games
+constexpr int DEFAULT_RATING = 1500;
+
+// secret a client presents to take its session over to a new connection
+using ResumeToken = std::array<uint8_t, 16>;
+
 /**
  * Session stores player connection and state information.
  */
@@ -17,6 +28,12 @@ struct Session {
   time_t lastHeartbeat = 0;           // last heartbeat timestamp
   std::vector<uint8_t> receiveBuffer; // receive buffer for incomplete messages
   bool isAuthenticated = false;       // authentication status
+  int rating = DEFAULT_RATING;        // matchmaking rating
+  uint32_t queueTicket = UINT32_MAX;  // matchmaking ticket, max if not queued
+  RttEstimator rtt;                   // round trip time from pings
+  RateController rate;                // pacing of opponent and spectator data
+  ResumeToken resumeToken{};          // current resume token
+  time_t detachedAt = 0;              // connection loss time, 0 if connected
 
   /**
    * default constructor
@@ -35,6 +52,12 @@ struct Session {
    */
   bool isInRoom() const { return roomId != 0; }
 
+  /**
+   * check if the session lost its connection and waits to be resumed
+   * @return true if detached
+   */
+  bool isDetached() const { return detachedAt != 0; }
+
   /**
    * update heartbeat timestamp to current time
    */
@@ -84,6 +107,12 @@ struct Session {
     roomId = 0;
     receiveBuffer.clear();
     isAuthenticated = false;
+    rating = DEFAULT_RATING;
+    queueTicket = UINT32_MAX;
+    rtt = RttEstimator();
+    rate = RateController();
+    resumeToken.fill(0);
+    detachedAt = 0;
     lastHeartbeat = std::time(nullptr);
   }
 };
@@ -1,15 +1,23 @@
 #ifndef TETORIO_SESSION_SESSION_MANAGER_H
 #define TETORIO_SESSION_SESSION_MANAGER_H
 
+#include "LatencyHistogram.h"
 #include "Session.h"
+#include "network/Arena.h"
+#include "network/BufferPool.h"
+#include "network/NodePool.h"
 
 #include <cstdint>
 #include <functional>
+#include <random>
 #include <unordered_map>
 #include <vector>
 
 namespace session {
 
+// seconds a detached session waits to be resumed before it is removed
+constexpr int DEFAULT_RESUME_GRACE = 15;
+
 /**
  * SessionManager manages all sessions.
  */
@@ -21,8 +29,10 @@ public:
   /**
    * constructor
    * @param heartbeatTimeout heartbeat timeout in seconds (default: 30)
+   * @param resumeGrace seconds a detached session can be resumed
    */
-  explicit SessionManager(int heartbeatTimeout = 30);
+  explicit SessionManager(int heartbeatTimeout = 30,
+                          int resumeGrace = DEFAULT_RESUME_GRACE);
 
   /**
    * destructor
@@ -54,6 +64,59 @@ public:
    */
   bool removeSessionByFd(int socketFd);
 
+  /**
+   * detach a session from its lost connection, it keeps its state until
+   * resumed or removed by checkDetached()
+   * @param playerId player ID
+   * @return true if detached, false if not found
+   */
+  bool detachSession(uint32_t playerId);
+
+  /**
+   * move a session to the connection of a fresh session presenting its
+   * resume token; the fresh session is removed, its unread bytes carried
+   * over, and the resumed session gets a new token
+   * @param token resume token, RESUME_TOKEN_SIZE bytes
+   * @param freshPlayerId player ID of the session of the new connection
+   * @param previousFd output connection the session still held, -1 if it
+   * was detached; the caller closes it
+   * @return player ID of the resumed session, 0 if the token is unknown
+   */
+  uint32_t resumeSession(const uint8_t *token, uint32_t freshPlayerId,
+                         int &previousFd);
+
+  /**
+   * remove detached sessions past the resume grace period, the timeout
+   * callback runs for each before it is removed
+   * @return number of removed sessions
+   */
+  size_t checkDetached();
+
+  /**
+   * append received data to a session's receive buffer, storage comes
+   * from the receive buffer pool
+   * @param session session
+   * @param data pointer to data
+   * @param len length of data
+   */
+  void appendToReceiveBuffer(Session &session, const uint8_t *data,
+                             size_t len);
+
+  /**
+   * remove processed data from a session's receive buffer, the storage
+   * goes back to the pool once nothing is left
+   * @param session session
+   * @param len number of bytes to remove from front
+   */
+  void consumeReceiveBuffer(Session &session, size_t len);
+
+  /**
+   * free the pooled receive buffers not needed since the last call, meant
+   * to run every few seconds
+   * @return bytes freed
+   */
+  size_t reclaimIdleBuffers() { return receivePool_.trim(); }
+
   /**
    * get session by player ID
    * @param playerId player ID
@@ -109,6 +172,33 @@ public:
    */
   std::vector<uint32_t> checkTimeouts();
 
+  /**
+   * take an rtt sample from a pong and add it to the latency histogram
+   * @param playerId player ID
+   * @param sequence ping sequence echoed by the client
+   * @param sentNs ping send time echoed by the client
+   * @param nowNs current monotonic time in nanoseconds
+   * @return true if the pong answered the outstanding ping
+   */
+  bool recordPong(uint32_t playerId, uint32_t sequence, uint64_t sentNs,
+                  uint64_t nowNs);
+
+  /**
+   * get the rtt samples of all sessions
+   * @return server-wide latency histogram
+   */
+  const LatencyHistogram &getLatencyHistogram() const { return latency_; }
+
+  /**
+   * call a visitor with every session, without collecting them first
+   * @param visit visitor taking a Session reference
+   */
+  template <typename Visit> void forEachSession(Visit &&visit) {
+    for (auto &[playerId, session] : sessions_) {
+      visit(session);
+    }
+  }
+
   /**
    * set player's room ID
    * @param playerId player ID
@@ -130,6 +220,23 @@ public:
    */
   std::vector<uint32_t> getAuthenticatedPlayers() const;
 
+  /**
+   * get all sessions in a room without a heap allocation
+   * @param roomId room ID
+   * @param arena arena holding the result
+   * @return span of player IDs in the room, valid until the arena resets
+   */
+  network::Span<const uint32_t> getPlayersInRoom(uint32_t roomId,
+                                                 network::Arena &arena) const;
+
+  /**
+   * get all authenticated player IDs without a heap allocation
+   * @param arena arena holding the result
+   * @return span of authenticated player IDs, valid until the arena resets
+   */
+  network::Span<const uint32_t>
+  getAuthenticatedPlayers(network::Arena &arena) const;
+
   /**
    * get total session count
    * @return number of sessions
@@ -157,11 +264,40 @@ private:
    */
   uint32_t generatePlayerId();
 
-  std::unordered_map<uint32_t, Session> sessions_; // playerId -> session
-  std::unordered_map<int, uint32_t> fdToPlayerId_; // socketFd -> playerId
-  uint32_t nextPlayerId_ = 1;                      // next player ID to assign
+  /**
+   * give a session a new random resume token, the old one stops working
+   * @param session session
+   */
+  void issueToken(Session &session);
+
+  /**
+   * get the lookup key of a token
+   * @param token resume token
+   * @return first 8 bytes as an integer
+   */
+  static uint64_t tokenKey(const uint8_t *token);
+
+  using SessionMap = std::unordered_map<uint32_t, Session>;
+  using FdMap = std::unordered_map<int, uint32_t>;
+  using TokenMap = std::unordered_map<uint64_t, uint32_t>;
+
+  SessionMap sessions_;       // playerId -> session
+  FdMap fdToPlayerId_;        // socketFd -> playerId
+  TokenMap tokenToPlayerId_;  // token key -> playerId
+
+  // nodes of erased entries, so connect and disconnect do not allocate
+  network::NodePool<SessionMap> sessionNodes_;
+  network::NodePool<FdMap> fdNodes_;
+  network::NodePool<TokenMap> tokenNodes_;
+
+  network::BufferPool receivePool_; // receive buffer storage
+  std::vector<uint32_t> expired_;   // scratch of checkDetached()
+  uint32_t nextPlayerId_ = 1;       // next player ID to assign
   int heartbeatTimeout_;            // heartbeat timeout in seconds
+  int resumeGrace_;                 // resume grace period in seconds
+  std::random_device random_;       // token source
   SessionCallback timeoutCallback_; // callback for timeout events
+  LatencyHistogram latency_;        // rtt samples of all sessions
 };
 
 } // namespace session
@@ -1,11 +1,45 @@
 #include "Tetorio.h"
+#include "audit/AllocationAudit.h"
+#include "protocol/Codec.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <string>
+#include <sys/timerfd.h>
+#include <unistd.h>
 
 namespace tetorio {
 
+namespace {
+
+/**
+ * get monotonic time in milliseconds
+ * @return milliseconds since an arbitrary epoch
+ */
+uint64_t steadyNowMs() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+/**
+ * get monotonic time in nanoseconds
+ * @return nanoseconds since an arbitrary epoch
+ */
+uint64_t steadyNowNs() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+} // namespace
+
 Tetorio::Tetorio(uint16_t port, int maxConnections)
-    : server_(port, maxConnections), sessionManager_(30), roomManager_(100) {
+    : server_(port, maxConnections), sessionManager_(30), roomManager_(100),
+      botEngine_(BOT_SEARCH_THREADS) {
   // set server callbacks
   server_.setClientConnectCallback(
       [this](int clientFd) { onClientConnect(clientFd); });
@@ -22,6 +56,36 @@ Tetorio::Tetorio(uint16_t port, int maxConnections)
   sessionManager_.setTimeoutCallback(
       [this](uint32_t playerId) { onSessionTimeout(playerId); });
 
+  // set room callbacks
+  roomManager_.setGameStartedCallback(
+      [this](uint32_t roomId) { onGameStarted(roomId); });
+
+  roomManager_.setGameFinishedCallback(
+      [this](uint32_t roomId) { onGameFinished(roomId); });
+
+  roomManager_.setPlayerLeftCallback(
+      [this](uint32_t roomId, uint32_t playerId) {
+        onPlayerLeft(roomId, playerId);
+      });
+
+  roomManager_.setRoomRemovedCallback([this](uint32_t roomId) {
+    // room emptied mid-game, keep what was recorded
+    auto it = matches_.find(roomId);
+    if (it != matches_.end()) {
+      it->second.match->finish(getMatchTimeMs(roomId));
+      matches_.erase(it);
+    }
+    // bots leave with the last human, their IDs are never reused
+    for (auto bot = bots_.begin(); bot != bots_.end();) {
+      bot = bot->second.roomId == roomId ? bots_.erase(bot) : std::next(bot);
+    }
+  });
+
+  // replays are served straight from the archive the writer appends to
+  if (!replayArchive_.open(replayWriter_.getDirectory())) {
+    std::cerr << "failed to open replay archive" << std::endl;
+  }
+
   std::cout << "tetorio initialized" << std::endl;
 }
 
@@ -31,17 +95,49 @@ bool Tetorio::start() {
     return false;
   }
 
+  // collect verification results on the event loop
+  server_.addWatch(verifier_.getNotifyFd(),
+                   [this]() { onVerificationResults(); });
+
+  // and bot moves
+  server_.addWatch(botEngine_.getNotifyFd(), [this]() { onBotResults(); });
+
+  // game ticks come from a timer on the same loop
+  tickFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (tickFd_ < 0) {
+    std::cerr << "failed to create tick timer: " << strerror(errno)
+              << std::endl;
+    server_.stop();
+    return false;
+  }
+  struct itimerspec interval = {};
+  interval.it_interval.tv_nsec = 1000000000L / TICK_RATE_HZ;
+  interval.it_value = interval.it_interval;
+  timerfd_settime(tickFd_, 0, &interval, nullptr);
+  server_.addWatch(tickFd_, [this]() { onTick(); });
+
   std::cout << "server started on port " << server_.getPort() << std::endl;
   return true;
 }
 
 void Tetorio::stop() {
   server_.stop();
+  if (tickFd_ >= 0) {
+    server_.removeWatch(tickFd_);
+    close(tickFd_);
+    tickFd_ = -1;
+  }
   std::cout << "server stopped" << std::endl;
 }
 
 void Tetorio::run() { server_.runEventLoop(); }
 
+void Tetorio::setSpectatorRate(int hz) {
+  // frames go out on game ticks, so the rate snaps to a whole interval
+  hz = std::clamp(hz, 1, TICK_RATE_HZ);
+  spectatorInterval_ = TICK_RATE_HZ / hz;
+}
+
 bool Tetorio::sendToPlayer(uint32_t playerId, const uint8_t *data, size_t len) {
   const session::Session *session = sessionManager_.getSession(playerId);
   if (session == nullptr) {
@@ -53,9 +149,13 @@ bool Tetorio::sendToPlayer(uint32_t playerId, const uint8_t *data, size_t len) {
 
 void Tetorio::broadcastToRoom(uint32_t roomId, const uint8_t *data,
                               size_t len) {
-  std::vector<uint32_t> playerIds = sessionManager_.getPlayersInRoom(roomId);
+  // room membership is indexed, no need to scan every session
+  const room::Room *room = roomManager_.getRoom(roomId);
+  if (room == nullptr) {
+    return;
+  }
 
-  for (uint32_t playerId : playerIds) {
+  for (uint32_t playerId : room->playerIds) {
     sendToPlayer(playerId, data, len);
   }
 }
@@ -75,6 +175,7 @@ void Tetorio::onClientConnect(int clientFd) {
 
   std::cout << "session created for client " << clientFd
             << " (playerId: " << playerId << ")" << std::endl;
+  sendSessionInfo(playerId);
 }
 
 void Tetorio::onClientDisconnect(int clientFd) {
@@ -84,17 +185,10 @@ void Tetorio::onClientDisconnect(int clientFd) {
     return;
   }
 
-  // leave room if in one
-  uint32_t roomId = roomManager_.getRoomIdByPlayerId(playerId);
-  if (roomId != 0) {
-    roomManager_.leaveRoom(playerId);
-    std::cout << "player " << playerId << " left room " << roomId
-              << " due to disconnect" << std::endl;
-  }
-
-  // remove session
-  sessionManager_.removeSession(playerId);
-  std::cout << "session removed for player " << playerId << std::endl;
+  // the room and match keep the player's place until the client resumes
+  // or the grace period ends, see onSessionTimeout()
+  leaveQueue(playerId);
+  sessionManager_.detachSession(playerId);
 }
 
 void Tetorio::onClientData(int clientFd, const uint8_t *data, size_t len) {
@@ -109,7 +203,7 @@ void Tetorio::onClientData(int clientFd, const uint8_t *data, size_t len) {
   session->updateHeartbeat();
 
   // append data to session receive buffer
-  session->appendToReceiveBuffer(data, len);
+  sessionManager_.appendToReceiveBuffer(*session, data, len);
 
   // process complete messages
   processSessionBuffer(session->playerId);
@@ -119,12 +213,17 @@ void Tetorio::onSessionTimeout(uint32_t playerId) {
   std::cout << "session timeout for player " << playerId << std::endl;
 
   // leave room if in one
+  leaveQueue(playerId);
   uint32_t roomId = roomManager_.getRoomIdByPlayerId(playerId);
   if (roomId != 0) {
     roomManager_.leaveRoom(playerId);
+    std::cout << "player " << playerId << " left room " << roomId
+              << " due to disconnect" << std::endl;
   }
+  stopSpectating(playerId);
 
-  // NOTE: session will be removed by SessionManager::checkTimeouts()
+  // NOTE: session will be removed by SessionManager::checkTimeouts() or
+  // SessionManager::checkDetached()
 }
 
 void Tetorio::processSessionBuffer(uint32_t playerId) {
@@ -133,7 +232,1052 @@ void Tetorio::processSessionBuffer(uint32_t playerId) {
     return;
   }
 
-  // TODO: implement message parsing based protocol
+  size_t offset = 0;
+  protocol::MessageHeader header;
+  while (protocol::parseHeader(session->receiveBuffer.data() + offset,
+                               session->receiveBuffer.size() - offset,
+                               header)) {
+    // close the connection on a length the client is not allowed to send,
+    // the rest of the payload would be read as headers otherwise
+    if (header.length > protocol::MAX_PAYLOAD_SIZE) {
+      std::cerr << "message too large from player " << playerId << ": "
+                << header.length << " bytes" << std::endl;
+      server_.disconnect(session->socketFd);
+      return;
+    }
+
+    size_t frameSize = protocol::HEADER_SIZE + header.length;
+    if (session->receiveBuffer.size() - offset < frameSize) {
+      break; // wait for the rest of the message
+    }
+
+    // copy payload out, handlers may append to or free the session; the
+    // copy lives until the event loop iteration ends
+    network::Span<uint8_t> payload =
+        server_.getArena().allocateArray<uint8_t>(header.length);
+    std::copy_n(session->receiveBuffer.data() + offset + protocol::HEADER_SIZE,
+                payload.size, payload.data);
+    offset += frameSize;
+
+    int socketFd = session->socketFd;
+    handleMessage(playerId, header.type, payload.data, payload.size);
+
+    // a resume moves the connection and its unread bytes to the old session
+    session = sessionManager_.getSession(playerId);
+    if (session == nullptr) {
+      playerId = sessionManager_.getPlayerIdByFd(socketFd);
+      session = sessionManager_.getSession(playerId);
+      if (session == nullptr) {
+        return;
+      }
+    }
+  }
+
+  sessionManager_.consumeReceiveBuffer(*session, offset);
+
+  // one ack per batch keeps downstream traffic small
+  flushPrediction(playerId);
+}
+
+void Tetorio::handleMessage(uint32_t playerId, protocol::MessageType type,
+                            const uint8_t *payload, size_t len) {
+  using protocol::MessageType;
+  audit::MessageScope audited(type);
+
+  bool ok = true;
+  switch (type) {
+  case MessageType::HEARTBEAT:
+    // heartbeat already updated on receive
+    break;
+
+  case MessageType::CREATE_ROOM: {
+    std::string roomName(reinterpret_cast<const char *>(payload), len);
+    uint32_t roomId = roomManager_.createRoom(roomName, playerId);
+    ok = roomId != 0;
+    if (ok) {
+      leaveQueue(playerId);
+      sessionManager_.setPlayerRoom(playerId, roomId);
+      uint8_t reply[4];
+      for (int i = 0; i < 4; ++i) {
+        reply[i] = static_cast<uint8_t>(roomId >> (8 * i));
+      }
+      sendMessage(playerId, MessageType::ROOM_JOINED, reply, sizeof(reply));
+    }
+    break;
+  }
+
+  case MessageType::JOIN_ROOM: {
+    ok = len == 4;
+    if (ok) {
+      uint32_t roomId = static_cast<uint32_t>(protocol::readLE(payload, 4));
+      ok = roomManager_.joinRoom(roomId, playerId);
+      if (ok) {
+        leaveQueue(playerId);
+        sessionManager_.setPlayerRoom(playerId, roomId);
+        sendMessage(playerId, MessageType::ROOM_JOINED, payload, len);
+      }
+    }
+    break;
+  }
+
+  case MessageType::LEAVE_ROOM:
+    ok = roomManager_.leaveRoom(playerId);
+    if (ok) {
+      sessionManager_.setPlayerRoom(playerId, 0);
+    }
+    break;
+
+  case MessageType::START_GAME:
+    ok = roomManager_.startGame(roomManager_.getRoomIdByPlayerId(playerId),
+                                playerId);
+    break;
+
+  case MessageType::INPUT:
+    ok = handleInput(playerId, payload, len);
+    break;
+
+  case MessageType::PLACE:
+    ok = handlePlacement(playerId, payload, len);
+    break;
+
+  case MessageType::SET_TARGETING: {
+    auto it = matches_.find(roomManager_.getRoomIdByPlayerId(playerId));
+    ok = len == 1 && it != matches_.end() &&
+         it->second.match->setTargeting(
+             playerId, static_cast<room::TargetStrategy>(payload[0]));
+    break;
+  }
+
+  case MessageType::SPECTATE:
+    ok = len == 4 &&
+         handleSpectate(playerId,
+                        static_cast<uint32_t>(protocol::readLE(payload, 4)));
+    break;
+
+  case MessageType::QUEUE_JOIN:
+    ok = len == 2 &&
+         handleQueueJoin(playerId,
+                         static_cast<uint16_t>(protocol::readLE(payload, 2)));
+    break;
+
+  case MessageType::QUEUE_LEAVE:
+    ok = leaveQueue(playerId);
+    break;
+
+  case MessageType::PONG:
+    ok = len == 12 &&
+         sessionManager_.recordPong(
+             playerId, static_cast<uint32_t>(protocol::readLE(payload, 4)),
+             protocol::readLE(payload + 4, 8), steadyNowNs());
+    break;
+
+  case MessageType::RESUME:
+    ok = handleResume(playerId, payload, len);
+    break;
+
+  case MessageType::REPLAY_REQUEST:
+    ok = len == 8 && handleReplayRequest(playerId, protocol::readLE(payload, 8));
+    break;
+
+  case MessageType::ADD_BOT:
+    ok = len == 1 && handleAddBot(playerId, payload[0]);
+    break;
+
+  case MessageType::PRACTICE:
+    ok = len == 1 && handlePractice(playerId, payload[0]);
+    break;
+
+  default:
+    ok = false;
+    break;
+  }
+
+  if (!ok) {
+    uint8_t failed = static_cast<uint8_t>(type);
+    sendMessage(playerId, MessageType::ERROR, &failed, 1);
+  }
+}
+
+bool Tetorio::handleInput(uint32_t playerId, const uint8_t *payload,
+                          size_t len) {
+  bool tagged = len == 1 + protocol::PREDICTION_TAG_SIZE;
+  if (len != 1 && !tagged) {
+    return false;
+  }
+  uint32_t roomId = roomManager_.getRoomIdByPlayerId(playerId);
+  auto it = matches_.find(roomId);
+  if (it == matches_.end()) {
+    return true; // inputs racing the game end are dropped quietly
+  }
+
+  RunningMatch &running = it->second;
+  room::Match &match = *running.match;
+  int slot = match.getSlot(playerId);
+  protocol::PredictionTag tag;
+  if (tagged) {
+    protocol::parsePredictionTag(payload + 1, tag);
+    if (slot < 0 ||
+        tag.sequence <= running.predictions[static_cast<size_t>(slot)]
+                            .lastSequence) {
+      return false;
+    }
+  }
+
+  match.applyInput(playerId, static_cast<game::Input>(payload[0]),
+                   getMatchTimeMs(roomId));
+  if (tagged) {
+    checkPrediction(running, static_cast<size_t>(slot), tag);
+  }
+  if (match.isOver()) {
+    roomManager_.finishGame(roomId);
+  }
+  return true;
+}
+
+bool Tetorio::handlePlacement(uint32_t playerId, const uint8_t *payload,
+                              size_t len) {
+  bool tagged = len == 7 + protocol::PREDICTION_TAG_SIZE;
+  if (len != 7 && !tagged) {
+    return false;
+  }
+  uint32_t roomId = roomManager_.getRoomIdByPlayerId(playerId);
+  auto it = matches_.find(roomId);
+  if (it == matches_.end()) {
+    return false;
+  }
+
+  RunningMatch &running = it->second;
+  room::Match &match = *running.match;
+  int slot = match.getSlot(playerId);
+  protocol::PredictionTag tag;
+  if (tagged) {
+    protocol::parsePredictionTag(payload + 7, tag);
+    if (slot < 0 ||
+        tag.sequence <= running.predictions[static_cast<size_t>(slot)]
+                            .lastSequence) {
+      return false;
+    }
+  }
+
+  game::PlacementClaim claim;
+  claim.pieceIndex = static_cast<uint32_t>(protocol::readLE(payload, 4));
+  claim.x = static_cast<int8_t>(payload[4]);
+  claim.y = static_cast<int8_t>(payload[5]);
+  claim.rotation =
+      static_cast<game::Rotation>(payload[6] & protocol::PLACE_ROTATION_MASK);
+  claim.spin = (payload[6] & protocol::PLACE_FLAG_SPIN) != 0;
+  claim.hold = (payload[6] & protocol::PLACE_FLAG_HOLD) != 0;
+
+  game::InputResult result =
+      match.applyPlacement(playerId, claim, getMatchTimeMs(roomId));
+  // a rejected placement still gets an ack, the hash shows the client is off
+  if (tagged) {
+    checkPrediction(running, static_cast<size_t>(slot), tag);
+  }
+  if (match.isOver()) {
+    roomManager_.finishGame(roomId);
+  }
+  return result.accepted || tagged;
+}
+
+void Tetorio::checkPrediction(RunningMatch &running, size_t slot,
+                              const protocol::PredictionTag &tag) {
+  Prediction &prediction = running.predictions[slot];
+  const game::Game &game = running.match->getGame(slot);
+
+  prediction.lastSequence = tag.sequence;
+  prediction.pending = true;
+  prediction.matched = tag.stateHash == game.getStateHash();
+  if (prediction.matched) {
+    prediction.confirmedVersion = game.getBoard().getVersion();
+    prediction.diverged = false;
+  } else if (tag.epoch == prediction.epoch) {
+    // moves predicted before the last correction arrived are not judged
+    prediction.diverged = true;
+  }
+}
+
+void Tetorio::flushPrediction(uint32_t playerId) {
+  auto it = matches_.find(roomManager_.getRoomIdByPlayerId(playerId));
+  if (it == matches_.end()) {
+    return;
+  }
+  RunningMatch &running = it->second;
+  int slot = running.match->getSlot(playerId);
+  if (slot < 0) {
+    return;
+  }
+  Prediction &prediction = running.predictions[static_cast<size_t>(slot)];
+  if (!prediction.pending) {
+    return;
+  }
+  prediction.pending = false;
+
+  const game::Game &game = running.match->getGame(static_cast<size_t>(slot));
+  std::vector<uint8_t> &payload = predictionPayload_;
+  payload.clear();
+  protocol::writeLE(payload, prediction.lastSequence, 4);
+
+  if (!prediction.diverged) {
+    protocol::writeLE(payload, game.getStateHash(), 8);
+    protocol::writeLE(
+        payload, prediction.matched ? prediction.confirmedVersion : 0, 4);
+    sendMessage(playerId, protocol::MessageType::STATE_ACK, payload.data(),
+                payload.size());
+    return;
+  }
+
+  // client rolls back to its confirmed board and applies the delta
+  ++prediction.epoch;
+  prediction.diverged = false;
+  payload.push_back(prediction.epoch);
+  protocol::writeLE(payload, game.getStateHash(), 8);
+  game.encodeSnapshot(payload, prediction.confirmedVersion);
+  prediction.confirmedVersion = game.getBoard().getVersion();
+  sendMessage(playerId, protocol::MessageType::STATE_CORRECTION,
+              payload.data(), payload.size());
+}
+
+void Tetorio::sendSessionInfo(uint32_t playerId) {
+  const session::Session *session = sessionManager_.getSession(playerId);
+  if (session == nullptr) {
+    return;
+  }
+
+  uint8_t payload[12 + protocol::RESUME_TOKEN_SIZE];
+  static_assert(sizeof(session::ResumeToken) == protocol::RESUME_TOKEN_SIZE,
+                "resume token size mismatch");
+  uint32_t roomId = roomManager_.getRoomIdByPlayerId(playerId);
+  uint32_t watchedId = roomManager_.getSpectatedRoomId(playerId);
+  uint8_t *out = payload;
+  for (int i = 0; i < 4; ++i) {
+    *out++ = static_cast<uint8_t>(playerId >> (8 * i));
+  }
+  out = std::copy(session->resumeToken.begin(), session->resumeToken.end(),
+                  out);
+  for (int i = 0; i < 4; ++i) {
+    *out++ = static_cast<uint8_t>(roomId >> (8 * i));
+  }
+  for (int i = 0; i < 4; ++i) {
+    *out++ = static_cast<uint8_t>(watchedId >> (8 * i));
+  }
+  sendMessage(playerId, protocol::MessageType::SESSION_INFO, payload,
+              sizeof(payload));
+}
+
+bool Tetorio::handleResume(uint32_t playerId, const uint8_t *payload,
+                           size_t len) {
+  if (len < protocol::RESUME_BASE_SIZE ||
+      len != protocol::RESUME_BASE_SIZE +
+                 5 * static_cast<size_t>(
+                         payload[protocol::RESUME_BASE_SIZE - 1])) {
+    return false;
+  }
+
+  // only a connection that has not joined anything yet may take over
+  if (roomManager_.getRoomIdByPlayerId(playerId) != 0 ||
+      roomManager_.getSpectatedRoomId(playerId) != 0) {
+    return false;
+  }
+  leaveQueue(playerId);
+  int previousFd = -1;
+  uint32_t resumedId =
+      sessionManager_.resumeSession(payload, playerId, previousFd);
+  if (resumedId == 0) {
+    return false;
+  }
+  if (previousFd >= 0) {
+    server_.disconnect(previousFd);
+  }
+  sendSessionInfo(resumedId);
+
+  const uint8_t *versions = payload + protocol::RESUME_TOKEN_SIZE;
+  uint32_t ownVersion = static_cast<uint32_t>(protocol::readLE(versions, 4));
+  uint32_t frameVersion =
+      static_cast<uint32_t>(protocol::readLE(versions + 4, 4));
+  size_t boardCount = versions[8];
+  const uint8_t *boards = versions + 9;
+  const session::Session *session = sessionManager_.getSession(resumedId);
+
+  // a player gets its own board as a correction from the version it has,
+  // opponents as tick update deltas from theirs
+  auto played = matches_.find(roomManager_.getRoomIdByPlayerId(resumedId));
+  int slot = played == matches_.end()
+                 ? -1
+                 : played->second.match->getSlot(resumedId);
+  if (slot >= 0) {
+    RunningMatch &running = played->second;
+    if (ownVersion == 0) {
+      server_.send(session->socketFd, running.gameStart->data(),
+                   running.gameStart->size());
+    }
+
+    size_t index = static_cast<size_t>(slot);
+    running.updates->forgetSent(index);
+    for (size_t i = 0; i < boardCount; ++i) {
+      running.updates->restoreSent(
+          index, boards[5 * i],
+          static_cast<uint32_t>(protocol::readLE(boards + 5 * i + 1, 4)));
+    }
+
+    Prediction &prediction = running.predictions[index];
+    uint32_t current =
+        running.match->getGame(index).getBoard().getVersion();
+    prediction.confirmedVersion = ownVersion <= current ? ownVersion : 0;
+    prediction.pending = true;
+    prediction.diverged = true;
+  }
+
+  // a spectator continues from the frame it has, a keyframe if too old
+  auto watched = matches_.find(roomManager_.getSpectatedRoomId(resumedId));
+  if (watched != matches_.end()) {
+    RunningMatch &running = watched->second;
+    if (frameVersion == 0) {
+      server_.sendShared(session->socketFd, running.gameStart);
+    }
+    running.spectatorVersions[resumedId] =
+        frameVersion <= running.spectatorFeed->getVersion() ? frameVersion
+                                                            : 0;
+  }
+  return true;
+}
+
+bool Tetorio::handleSpectate(uint32_t playerId, uint32_t roomId) {
+  if (roomId == 0) {
+    return stopSpectating(playerId);
+  }
+  if (roomManager_.getSpectatedRoomId(playerId) == roomId) {
+    return true;
+  }
+
+  // bring current spectators up to date first, so the keyframe the new one
+  // gets is the frame everyone else continues from
+  auto it = matches_.find(roomId);
+  if (it != matches_.end()) {
+    RunningMatch &running = it->second;
+    if (running.spectatorFeed->getVersion() != 0 &&
+        running.spectatorFeed->hasChanges(*running.match)) {
+      publishSpectatorFrame(roomId, running);
+    }
+  }
+
+  stopSpectating(playerId);
+  if (!roomManager_.spectateRoom(roomId, playerId)) {
+    return false;
+  }
+  if (it == matches_.end()) {
+    return true; // frames start with the next game
+  }
+
+  RunningMatch &running = it->second;
+  const session::Session *session = sessionManager_.getSession(playerId);
+  if (session == nullptr) {
+    return true;
+  }
+  server_.sendShared(session->socketFd, running.gameStart);
+
+  // before the first frame there is no keyframe, the first frame is one
+  room::SpectatorFeed::Frame keyframe =
+      running.spectatorFeed->getKeyframe(*running.match);
+  if (keyframe) {
+    server_.sendShared(session->socketFd, keyframe);
+    running.spectatorVersions[playerId] = running.spectatorFeed->getVersion();
+  }
+  return true;
+}
+
+bool Tetorio::stopSpectating(uint32_t playerId) {
+  auto it = matches_.find(roomManager_.getSpectatedRoomId(playerId));
+  if (it != matches_.end()) {
+    it->second.spectatorVersions.erase(playerId);
+  }
+  return roomManager_.stopSpectating(playerId);
+}
+
+void Tetorio::publishSpectatorFrame(uint32_t roomId, RunningMatch &running,
+                                    bool final) {
+  const room::Room *room = roomManager_.getRoom(roomId);
+  if (room == nullptr || room->spectatorIds.empty()) {
+    return;
+  }
+
+  room::SpectatorFeed &feed = *running.spectatorFeed;
+  feed.publish(*running.match);
+  for (uint32_t spectatorId : room->spectatorIds) {
+    const session::Session *session = sessionManager_.getSession(spectatorId);
+    if (session == nullptr || session->isDetached()) {
+      continue;
+    }
+
+    // a slow spectator skips frames instead of growing its queue, a paced
+    // one waits out its interval; either gets one delta over the gap
+    if (!final &&
+        server_.getSharedBacklog(session->socketFd) >= MAX_SPECTATOR_BACKLOG) {
+      continue;
+    }
+    uint32_t &version = running.spectatorVersions[spectatorId];
+    uint32_t frames = std::max<uint32_t>(
+        session->rate.interval / static_cast<uint32_t>(spectatorInterval_), 1);
+    if (!final && version != 0 && feed.getVersion() - version < frames) {
+      continue;
+    }
+    server_.sendShared(session->socketFd,
+                       feed.getFrame(*running.match, version));
+    version = feed.getVersion();
+  }
+}
+
+void Tetorio::sendToSpectators(const room::Room &room,
+                               const room::SpectatorFeed::Frame &frame) {
+  for (uint32_t spectatorId : room.spectatorIds) {
+    const session::Session *session = sessionManager_.getSession(spectatorId);
+    if (session != nullptr) {
+      server_.sendShared(session->socketFd, frame);
+    }
+  }
+}
+
+bool Tetorio::handleReplayRequest(uint32_t playerId, uint64_t gameId) {
+  const session::Session *session = sessionManager_.getSession(playerId);
+  replay::ArchiveIndexEntry entry;
+  if (session == nullptr || !replayArchive_.refresh() ||
+      !replayArchive_.findGame(gameId, entry)) {
+    return false;
+  }
+
+  std::vector<uint8_t> info;
+  protocol::writeLE(info, gameId, 8);
+  protocol::writeLE(info, entry.replayLength, 4);
+  sendMessage(playerId, protocol::MessageType::REPLAY_INFO, info.data(),
+              info.size());
+
+  // each chunk is a REPLAY_DATA message whose payload comes from the file
+  auto framer = [gameId](size_t chunkLen, uint8_t *header) -> size_t {
+    size_t payloadLen = 8 + chunkLen;
+    header[0] = static_cast<uint8_t>(payloadLen);
+    header[1] = static_cast<uint8_t>(payloadLen >> 8);
+    header[2] = static_cast<uint8_t>(protocol::MessageType::REPLAY_DATA);
+    for (int i = 0; i < 8; ++i) {
+      header[3 + i] = static_cast<uint8_t>(gameId >> (8 * i));
+    }
+    return protocol::HEADER_SIZE + 8;
+  };
+  return server_.sendFile(session->socketFd, replayArchive_.getSegmentFd(),
+                          entry.offset, entry.replayLength, framer);
+}
+
+void Tetorio::sendMessage(uint32_t playerId, protocol::MessageType type,
+                          const uint8_t *payload, size_t len) {
+  // the server copies the frame, so one buffer serves every message
+  messageFrame_.clear();
+  protocol::writeMessage(messageFrame_, type, payload, len);
+  sendToPlayer(playerId, messageFrame_.data(), messageFrame_.size());
+}
+
+void Tetorio::onGameStarted(uint32_t roomId) {
+  const room::Room *room = roomManager_.getRoom(roomId);
+  if (room == nullptr) {
+    return;
+  }
+
+  uint64_t startedAtMs = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count());
+
+  RunningMatch running;
+  running.match =
+      std::make_unique<room::Match>(*room, &replayWriter_, startedAtMs);
+  running.startedAt = std::chrono::steady_clock::now();
+  running.predictions.resize(room->playerIds.size());
+  running.updates =
+      std::make_unique<room::UpdateEncoder>(room->playerIds.size());
+  running.spectatorFeed =
+      std::make_unique<room::SpectatorFeed>(room->playerIds.size());
+
+  // seed and slot order let clients generate the same sequence locally
+  std::vector<uint8_t> payload;
+  protocol::writeLE(payload, room->getSequenceSeed(), 8);
+  payload.push_back(static_cast<uint8_t>(room->playerIds.size()));
+  for (uint32_t id : room->playerIds) {
+    protocol::writeLE(payload, id, 4);
+  }
+  for (uint32_t id : room->playerIds) {
+    sendMessage(id, protocol::MessageType::GAME_START, payload.data(),
+                payload.size());
+  }
+
+  // spectators get it on the bulk lane, ahead of the frames that follow
+  // and behind those of a room they watched before
+  auto gameStart = std::make_shared<std::vector<uint8_t>>();
+  protocol::writeMessage(*gameStart, protocol::MessageType::GAME_START,
+                         payload.data(), payload.size());
+  running.gameStart = gameStart;
+  sendToSpectators(*room, running.gameStart);
+
+  // a result still in flight from the last game is dropped on arrival
+  for (size_t slot = 0; slot < room->playerIds.size(); ++slot) {
+    auto bot = bots_.find(room->playerIds[slot]);
+    if (bot != bots_.end()) {
+      running.botSlots.push_back(slot);
+      bot->second.path.clear();
+      bot->second.searching = false;
+      bot->second.nextInputTick = tickCount_ + bot->second.inputInterval;
+    }
+  }
+  matches_[roomId] = std::move(running);
+}
+
+void Tetorio::onGameFinished(uint32_t roomId) {
+  room::Room *room = roomManager_.getRoom(roomId);
+  auto it = matches_.find(roomId);
+  if (room == nullptr || it == matches_.end()) {
+    return;
+  }
+
+  room::Match &match = *it->second.match;
+  match.finish(getMatchTimeMs(roomId));
+  submitVerification(*room, match);
+
+  // spectators see the final boards before the result, paced or not
+  if (it->second.spectatorFeed->hasChanges(match)) {
+    publishSpectatorFrame(roomId, it->second, true);
+  }
+
+  uint8_t payload[4];
+  uint32_t winner = match.getWinner();
+  for (int i = 0; i < 4; ++i) {
+    payload[i] = static_cast<uint8_t>(winner >> (8 * i));
+  }
+  for (uint32_t id : room->playerIds) {
+    sendMessage(id, protocol::MessageType::GAME_OVER, payload,
+                sizeof(payload));
+  }
+  // behind the final frame on the spectators' lane
+  auto gameOver = std::make_shared<std::vector<uint8_t>>();
+  protocol::writeMessage(*gameOver, protocol::MessageType::GAME_OVER, payload,
+                         sizeof(payload));
+  sendToSpectators(*room, gameOver);
+
+  matches_.erase(it);
+
+  // back to waiting so the host can start a rematch
+  room->reset();
+}
+
+void Tetorio::onPlayerLeft(uint32_t roomId, uint32_t playerId) {
+  // bots of a room nobody plays in are removed on the next tick, leaving
+  // from inside this callback would free the room under the caller
+  const room::Room *room = roomManager_.getRoom(roomId);
+  if (room::isBotId(playerId)) {
+    bots_.erase(playerId);
+  } else if (room != nullptr && !room->isEmpty() && !room->hasHumanPlayer()) {
+    abandonedRooms_.push_back(roomId);
+  }
+
+  auto it = matches_.find(roomId);
+  if (it == matches_.end()) {
+    return;
+  }
+
+  room::Match &match = *it->second.match;
+  if (match.forfeit(playerId, getMatchTimeMs(roomId)) && match.isOver()) {
+    roomManager_.finishGame(roomId);
+  }
+}
+
+void Tetorio::onTick() {
+  uint64_t expirations = 0;
+  if (read(tickFd_, &expirations, sizeof(expirations)) < 0) {
+    return;
+  }
+  closeAbandonedRooms();
+
+  // a late wakeup runs one tick, garbage delay is counted in ticks
+  network::Span<uint32_t> finished =
+      server_.getArena().allocateArray<uint32_t>(matches_.size());
+  size_t finishedCount = 0;
+  std::vector<uint8_t> &frame = tickFrame_;
+  for (auto &[roomId, running] : matches_) {
+    room::Match &match = *running.match;
+    driveBots(roomId, running);
+    const std::vector<room::GarbageEvent> &events =
+        match.tick(getMatchTimeMs(roomId));
+
+    // shared parts are encoded once, then each player adds its own
+    // paced players get opponent boards every few ticks only, and the
+    // final boards like everyone else
+    running.updates->beginTick(match, events);
+    for (size_t slot = 0; slot < match.getPlayerIds().size(); ++slot) {
+      uint32_t playerId = match.getPlayerIds()[slot];
+      if (room::isBotId(playerId)) {
+        continue;
+      }
+      const session::Session *session = sessionManager_.getSession(playerId);
+      bool boardsDue = session == nullptr || match.isOver() ||
+                       session->rate.isDue(tickCount_, playerId);
+      if (running.updates->encodeFor(slot, frame, boardsDue)) {
+        sendToPlayer(playerId, frame.data(), frame.size());
+      }
+    }
+
+    if (match.isOver()) {
+      finished[finishedCount++] = roomId;
+    }
+  }
+
+  // spectators are served after every player of every room
+  if (++tickCount_ % static_cast<uint64_t>(spectatorInterval_) == 0) {
+    for (auto &[roomId, running] : matches_) {
+      publishSpectatorFrame(roomId, running);
+    }
+  }
+
+  // finishing erases the match, so do it after the loop
+  for (size_t i = 0; i < finishedCount; ++i) {
+    roomManager_.finishGame(finished[i]);
+  }
+
+  if (tickCount_ % PING_INTERVAL_TICKS == 0) {
+    sendPings();
+  }
+
+  // detached sessions past their grace period give up their place
+  if (tickCount_ % DETACHED_CHECK_TICKS == 0) {
+    sessionManager_.checkDetached();
+  }
+
+  if (tickCount_ % RATE_SAMPLE_TICKS == 0) {
+    updateRates();
+  }
+
+  // only the audit build has anything to report
+  if (audit::ENABLED && tickCount_ % AUDIT_REPORT_TICKS == 0) {
+    audit::report(std::cout);
+  }
+
+  if (tickCount_ % BUFFER_RECLAIM_TICKS == 0) {
+    server_.reclaimIdleBuffers();
+    sessionManager_.reclaimIdleBuffers();
+  }
+
+  // rooms freed above are available to the pass
+  if (tickCount_ % MATCHMAKING_INTERVAL_TICKS == 0) {
+    runMatchmaking();
+  }
+}
+
+void Tetorio::sendPings() {
+  // frames are built on the stack, a ping allocates nothing of its own
+  uint64_t nowNs = steadyNowNs();
+  sessionManager_.forEachSession([&](session::Session &session) {
+    if (session.isDetached()) {
+      return;
+    }
+    uint8_t frame[protocol::HEADER_SIZE + 12];
+    uint32_t sequence = session.rtt.startPing(nowNs);
+    frame[0] = 12;
+    frame[1] = 0;
+    frame[2] = static_cast<uint8_t>(protocol::MessageType::PING);
+    for (int i = 0; i < 4; ++i) {
+      frame[3 + i] = static_cast<uint8_t>(sequence >> (8 * i));
+    }
+    for (int i = 0; i < 8; ++i) {
+      frame[7 + i] = static_cast<uint8_t>(nowNs >> (8 * i));
+    }
+    server_.send(session.socketFd, frame, sizeof(frame));
+  });
+}
+
+void Tetorio::updateRates() {
+  for (const auto &[roomId, running] : matches_) {
+    for (uint32_t playerId : running.match->getPlayerIds()) {
+      updateRate(playerId);
+    }
+    const room::Room *room = roomManager_.getRoom(roomId);
+    if (room != nullptr) {
+      for (uint32_t spectatorId : room->spectatorIds) {
+        updateRate(spectatorId);
+      }
+    }
+  }
+}
+
+void Tetorio::updateRate(uint32_t playerId) {
+  session::Session *session = sessionManager_.getSession(playerId);
+  network::SendQueueInfo info;
+  if (session == nullptr ||
+      !server_.getSendQueueInfo(session->socketFd, info)) {
+    return;
+  }
+
+  // the kernel rtt reacts within a few segments, pings once a second
+  uint32_t rttMs = info.kernelRttUs != 0 ? (info.kernelRttUs + 999) / 1000
+                                         : session->rtt.getSmoothedMs();
+  session->rate.update(info.bufferedBytes + info.kernelUnsent, rttMs,
+                       info.retransmits);
+}
+
+bool Tetorio::handleQueueJoin(uint32_t playerId, uint16_t latencyMs) {
+  session::Session *session = sessionManager_.getSession(playerId);
+  if (session == nullptr || roomManager_.getRoomIdByPlayerId(playerId) != 0) {
+    return false;
+  }
+
+  // measured rtt beats the client's own estimate once there is one
+  if (session->rtt.hasSamples()) {
+    latencyMs = session->rtt.getSmoothedMs();
+  }
+
+  // joining again refreshes the latency and restarts the wait
+  matchmaker_.leave(session->queueTicket, playerId);
+  session->queueTicket =
+      matchmaker_.join(playerId, session->rating, latencyMs, steadyNowMs());
+  return session->queueTicket != room::Matchmaker::NO_TICKET;
+}
+
+bool Tetorio::leaveQueue(uint32_t playerId) {
+  session::Session *session = sessionManager_.getSession(playerId);
+  if (session == nullptr) {
+    return false;
+  }
+  bool left = matchmaker_.leave(session->queueTicket, playerId);
+  session->queueTicket = room::Matchmaker::NO_TICKET;
+  return left;
+}
+
+void Tetorio::runMatchmaking() {
+  if (matchmaker_.getQueuedCount() < matchmaker_.getMatchSize()) {
+    return;
+  }
+
+  std::vector<uint32_t> &matched = matchedPlayers_;
+  matched.clear();
+  size_t size = matchmaker_.getMatchSize();
+  size_t formed = matchmaker_.formMatches(
+      steadyNowMs(), roomManager_.getFreeRoomCount(), matched);
+
+  for (size_t i = 0; i < formed; ++i) {
+    const uint32_t *players = matched.data() + i * size;
+    for (size_t k = 0; k < size; ++k) {
+      session::Session *session = sessionManager_.getSession(players[k]);
+      if (session != nullptr) {
+        session->queueTicket = room::Matchmaker::NO_TICKET;
+      }
+    }
+
+    uint32_t roomId = roomManager_.createMatchRoom(players, size);
+    if (roomId == 0) {
+      continue;
+    }
+
+    uint8_t reply[4];
+    for (int b = 0; b < 4; ++b) {
+      reply[b] = static_cast<uint8_t>(roomId >> (8 * b));
+    }
+    for (size_t k = 0; k < size; ++k) {
+      sessionManager_.setPlayerRoom(players[k], roomId);
+      sendMessage(players[k], protocol::MessageType::ROOM_JOINED, reply,
+                  sizeof(reply));
+    }
+    roomManager_.startGame(roomId, players[0]);
+  }
+}
+
+void Tetorio::submitVerification(const room::Room &room,
+                                 room::Match &match) {
+  replay::VerificationJob job;
+  job.roomId = room.roomId;
+  job.ranked = room.ranked;
+  job.replay = match.takeReplay();
+  if (job.replay.empty()) {
+    return;
+  }
+
+  job.reports.resize(match.getPlayerIds().size());
+  for (size_t slot = 0; slot < job.reports.size(); ++slot) {
+    const game::Game &game = match.getGame(slot);
+    replay::SlotReport &report = job.reports[slot];
+    report.playerId = match.getPlayerIds()[slot];
+    report.piecesPlaced = game.getPiecesPlaced();
+    report.linesCleared = game.getLinesCleared();
+    report.attackSent = game.getAttackSent();
+    report.toppedOut = match.isOut(slot);
+    report.toppedOutAtMs = match.getOutTimeMs(slot);
+    report.stateHash = game.getStateHash();
+  }
+
+  replay::SubmitStatus status = verifier_.submit(std::move(job));
+  if (status == replay::SubmitStatus::DROPPED) {
+    std::cerr << "verification queue full, room " << room.roomId
+              << " not verified" << std::endl;
+  }
+}
+
+void Tetorio::onVerificationResults() {
+  std::vector<replay::VerificationResult> results;
+  verifier_.pollResults(results);
+
+  for (const replay::VerificationResult &result : results) {
+    if (result.passed()) {
+      continue;
+    }
+    if (!result.decoded) {
+      std::cerr << "verification failed for room " << result.roomId
+                << ": replay did not decode" << std::endl;
+      continue;
+    }
+    for (size_t slot = 0; slot < result.mismatches.size(); ++slot) {
+      if (result.mismatches[slot] != replay::MISMATCH_NONE) {
+        std::cerr << "verification mismatch in room " << result.roomId
+                  << " for player " << result.playerIds[slot] << " (flags "
+                  << static_cast<int>(result.mismatches[slot]) << ")"
+                  << std::endl;
+      }
+    }
+  }
+}
+
+bool Tetorio::handleAddBot(uint32_t playerId, uint8_t level) {
+  const room::Room *room = roomManager_.getRoomByPlayerId(playerId);
+  if (room == nullptr || !room->isHost(playerId) || !room->isWaiting()) {
+    return false;
+  }
+  return addBot(room->roomId, level) != 0;
+}
+
+bool Tetorio::handlePractice(uint32_t playerId, uint8_t level) {
+  if (level >= protocol::BOT_LEVEL_COUNT) {
+    return false;
+  }
+  uint32_t roomId = roomManager_.createRoom("practice", playerId);
+  if (roomId == 0) {
+    return false;
+  }
+
+  leaveQueue(playerId);
+  sessionManager_.setPlayerRoom(playerId, roomId);
+  uint8_t reply[4];
+  for (int i = 0; i < 4; ++i) {
+    reply[i] = static_cast<uint8_t>(roomId >> (8 * i));
+  }
+  sendMessage(playerId, protocol::MessageType::ROOM_JOINED, reply,
+              sizeof(reply));
+
+  // the room stays open for a rematch once the game is over
+  return addBot(roomId, level) != 0 &&
+         roomManager_.startGame(roomId, playerId);
+}
+
+uint32_t Tetorio::addBot(uint32_t roomId, uint8_t level) {
+  if (level >= protocol::BOT_LEVEL_COUNT) {
+    return 0;
+  }
+  uint32_t botId = nextBotId_;
+  if (!roomManager_.joinRoom(roomId, botId)) {
+    return 0;
+  }
+  ++nextBotId_;
+
+  BotPlayer &bot = bots_[botId];
+  bot.roomId = roomId;
+  bot.difficulty = BOT_DIFFICULTIES[level];
+  bot.inputInterval = BOT_INPUT_INTERVAL_TICKS[level];
+  return botId;
+}
+
+void Tetorio::driveBots(uint32_t roomId, RunningMatch &running) {
+  room::Match &match = *running.match;
+  for (size_t slot : running.botSlots) {
+    uint32_t botId = match.getPlayerIds()[slot];
+    auto it = bots_.find(botId);
+    if (it == bots_.end() || match.isOut(slot) || match.isOver()) {
+      continue;
+    }
+
+    // a piece locked by gravity while searching makes the path stale
+    BotPlayer &bot = it->second;
+    const game::Game &game = match.getGame(slot);
+    if (bot.nextInput < bot.path.size() &&
+        bot.pathPiece != game.getPiecesPlaced()) {
+      bot.path.clear();
+    }
+
+    // inputs go through the match like a player's, so replays and
+    // verification cover bots too
+    if (bot.nextInput < bot.path.size()) {
+      if (tickCount_ >= bot.nextInputTick) {
+        match.applyInput(botId, bot.path[bot.nextInput++],
+                         getMatchTimeMs(roomId));
+        bot.nextInputTick = tickCount_ + bot.inputInterval;
+      }
+      continue;
+    }
+    if (bot.searching) {
+      continue;
+    }
+
+    bot::BotRequest request;
+    request.botId = botId;
+    request.board = game.getBoard();
+    request.current = game.getActivePiece().getType();
+    request.hold = game.getHold();
+    request.holdAvailable = game.isHoldAvailable();
+    request.preview = game.getBag().getPreview();
+    request.difficulty = bot.difficulty;
+    bot.searching = botEngine_.requestMove(request);
+    bot.pathPiece = game.getPiecesPlaced();
+  }
+}
+
+void Tetorio::onBotResults() {
+  std::vector<bot::BotMove> &moves = botMoves_;
+  moves.clear();
+  botEngine_.pollResults(moves);
+
+  for (bot::BotMove &move : moves) {
+    // bots that left or started a new game since asking drop the result
+    auto it = bots_.find(move.botId);
+    if (it == bots_.end() || !it->second.searching) {
+      continue;
+    }
+    BotPlayer &bot = it->second;
+    bot.searching = false;
+    bot.nextInput = 0;
+    if (move.found) {
+      bot.path = std::move(move.path);
+    } else {
+      // every placement tops out, end it quickly
+      bot.path.assign(1, game::Input::HARD_DROP);
+    }
+  }
+}
+
+void Tetorio::closeAbandonedRooms() {
+  std::vector<uint32_t> botIds;
+  for (uint32_t roomId : abandonedRooms_) {
+    const room::Room *room = roomManager_.getRoom(roomId);
+    if (room == nullptr || room->hasHumanPlayer()) {
+      continue;
+    }
+    // the last bot to leave removes the room
+    botIds = room->playerIds;
+    for (uint32_t botId : botIds) {
+      roomManager_.leaveRoom(botId);
+    }
+  }
+  abandonedRooms_.clear();
+}
+
+uint64_t Tetorio::getMatchTimeMs(uint32_t roomId) const {
+  auto it = matches_.find(roomId);
+  if (it == matches_.end()) {
+    return 0;
+  }
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - it->second.startedAt)
+          .count());
 }
 
 } // namespace tetorio
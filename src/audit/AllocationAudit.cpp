@@ -0,0 +1,268 @@
+#include "audit/AllocationAudit.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace audit {
+
+namespace {
+
+/**
+ * ThreadState stores the counters of one thread. it is constant
+ * initialized, so operator new can use it before any constructor ran.
+ */
+struct ThreadState {
+  Phase phase = Phase::IDLE;
+  int messageType = -1;        // type being dispatched, -1 if none
+  bool suspended = false;      // true while report() writes
+  uint64_t allocations = 0;    // thread total
+  uint64_t bytes = 0;          // thread total
+  uint64_t iterationStart = 0; // thread total when the iteration began
+  AllocationCounters phases[PHASE_COUNT];
+  AllocationCounters messages[MESSAGE_TYPE_COUNT];
+  IterationCounters iterations;
+};
+
+thread_local ThreadState state;
+
+const char *const PHASE_NAMES[PHASE_COUNT] = {
+    "idle", "accept", "read", "dispatch", "write", "timers"};
+
+void countAllocation(size_t size) {
+  if (state.suspended) {
+    return;
+  }
+  ++state.allocations;
+  state.bytes += size;
+  AllocationCounters &phase = state.phases[static_cast<size_t>(state.phase)];
+  ++phase.allocations;
+  phase.bytes += size;
+}
+
+void countFree() {
+  if (!state.suspended) {
+    ++state.phases[static_cast<size_t>(state.phase)].frees;
+  }
+}
+
+void *allocate(size_t size) {
+  countAllocation(size);
+  void *ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void *allocateAligned(size_t size, std::align_val_t alignment) {
+  countAllocation(size);
+  size_t align = static_cast<size_t>(alignment);
+  if (align < sizeof(void *)) {
+    align = sizeof(void *);
+  }
+  void *ptr = nullptr;
+  if (posix_memalign(&ptr, align, size == 0 ? 1 : size) != 0) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void release(void *ptr) {
+  if (ptr != nullptr) {
+    countFree();
+    std::free(ptr);
+  }
+}
+
+} // namespace
+
+PhaseScope::PhaseScope(Phase phase) : previous_(state.phase) {
+  state.phase = phase;
+}
+
+PhaseScope::~PhaseScope() { state.phase = previous_; }
+
+MessageScope::MessageScope(protocol::MessageType type)
+    : previousPhase_(state.phase), previousType_(state.messageType),
+      startAllocations_(state.allocations), startBytes_(state.bytes) {
+  state.phase = Phase::DISPATCH;
+  state.messageType = static_cast<int>(type);
+}
+
+MessageScope::~MessageScope() {
+  AllocationCounters &message =
+      state.messages[static_cast<size_t>(state.messageType)];
+  ++message.messages;
+  message.allocations += state.allocations - startAllocations_;
+  message.bytes += state.bytes - startBytes_;
+  state.phase = previousPhase_;
+  state.messageType = previousType_;
+}
+
+NoAllocationGuard::NoAllocationGuard(const char *what)
+    : what_(what), startAllocations_(state.allocations) {}
+
+NoAllocationGuard::~NoAllocationGuard() {
+  uint64_t allocated = state.allocations - startAllocations_;
+  if (allocated > 0) {
+    // stdio, so the failure report does not allocate itself
+    std::fprintf(stderr, "allocation audit: %s allocated %llu times\n",
+                 what_, static_cast<unsigned long long>(allocated));
+    std::abort();
+  }
+}
+
+void endIteration() {
+  uint64_t allocated = state.allocations - state.iterationStart;
+  state.iterationStart = state.allocations;
+  IterationCounters &iterations = state.iterations;
+  ++iterations.iterations;
+  if (allocated > 0) {
+    ++iterations.allocatingIterations;
+    if (allocated > iterations.maxAllocations) {
+      iterations.maxAllocations = allocated;
+    }
+  }
+}
+
+uint64_t getThreadAllocations() { return state.allocations; }
+
+AllocationCounters getPhaseCounters(Phase phase) {
+  return state.phases[static_cast<size_t>(phase)];
+}
+
+AllocationCounters getMessageCounters(protocol::MessageType type) {
+  return state.messages[static_cast<size_t>(type)];
+}
+
+IterationCounters getIterationCounters() { return state.iterations; }
+
+void report(std::ostream &out) {
+  state.suspended = true;
+
+  const IterationCounters &iterations = state.iterations;
+  out << "allocation audit: " << iterations.iterations << " iterations, "
+      << iterations.allocatingIterations << " allocating, max "
+      << iterations.maxAllocations << " per iteration" << std::endl;
+  for (size_t phase = 0; phase < PHASE_COUNT; ++phase) {
+    const AllocationCounters &counters = state.phases[phase];
+    out << "  " << PHASE_NAMES[phase] << ": " << counters.allocations
+        << " allocations, " << counters.bytes << " bytes, " << counters.frees
+        << " frees" << std::endl;
+  }
+  for (size_t type = 0; type < MESSAGE_TYPE_COUNT; ++type) {
+    const AllocationCounters &counters = state.messages[type];
+    if (counters.messages > 0) {
+      out << "  message " << type << ": " << counters.allocations
+          << " allocations, " << counters.bytes << " bytes in "
+          << counters.messages << " messages" << std::endl;
+    }
+  }
+
+  state.suspended = false;
+}
+
+void reset() {
+  for (AllocationCounters &counters : state.phases) {
+    counters = AllocationCounters();
+  }
+  for (AllocationCounters &counters : state.messages) {
+    counters = AllocationCounters();
+  }
+  state.iterations = IterationCounters();
+  state.iterationStart = state.allocations;
+}
+
+} // namespace audit
+
+// replacements of the global allocation functions, every form is replaced
+// so no path bypasses the counters
+
+void *operator new(size_t size) { return audit::allocate(size); }
+
+void *operator new[](size_t size) { return audit::allocate(size); }
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  try {
+    return audit::allocate(size);
+  } catch (const std::bad_alloc &) {
+    return nullptr;
+  }
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  try {
+    return audit::allocate(size);
+  } catch (const std::bad_alloc &) {
+    return nullptr;
+  }
+}
+
+void *operator new(size_t size, std::align_val_t alignment) {
+  return audit::allocateAligned(size, alignment);
+}
+
+void *operator new[](size_t size, std::align_val_t alignment) {
+  return audit::allocateAligned(size, alignment);
+}
+
+void *operator new(size_t size, std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept {
+  try {
+    return audit::allocateAligned(size, alignment);
+  } catch (const std::bad_alloc &) {
+    return nullptr;
+  }
+}
+
+void *operator new[](size_t size, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept {
+  try {
+    return audit::allocateAligned(size, alignment);
+  } catch (const std::bad_alloc &) {
+    return nullptr;
+  }
+}
+
+void operator delete(void *ptr) noexcept { audit::release(ptr); }
+
+void operator delete[](void *ptr) noexcept { audit::release(ptr); }
+
+void operator delete(void *ptr, size_t) noexcept { audit::release(ptr); }
+
+void operator delete[](void *ptr, size_t) noexcept { audit::release(ptr); }
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+  audit::release(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+  audit::release(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept {
+  audit::release(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t) noexcept {
+  audit::release(ptr);
+}
+
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept {
+  audit::release(ptr);
+}
+
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept {
+  audit::release(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+  audit::release(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+  audit::release(ptr);
+}
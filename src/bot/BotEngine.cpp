@@ -0,0 +1,272 @@
+#include "bot/BotEngine.h"
+#include "game/Piece.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace bot {
+
+namespace {
+
+/**
+ * Node stores one beam search state.
+ */
+struct Node {
+  game::Board board;
+  game::CellType hold = game::CellType::EMPTY;
+  int queueIndex = 0;  // index of the next piece in the piece list
+  int totalLines = 0;  // lines cleared along the line
+  double score = 0.0;  // evaluation of the board
+  bool rootHold = false;
+  game::CellType rootPiece = game::CellType::EMPTY;
+  game::Placement rootPlacement;
+};
+
+/**
+ * place a piece and clear lines
+ * @param board board to modify
+ * @param type piece type
+ * @param placement lock position
+ * @return number of lines cleared
+ */
+int applyPlacement(game::Board &board, game::CellType type,
+                   const game::Placement &placement) {
+  game::Piece piece(type);
+  piece.setPosition(placement.x, placement.y);
+  piece.setRotation(placement.rotation);
+  piece.lock(board);
+  return board.clearFullRows();
+}
+
+/**
+ * score up to BATCH_LANES nodes with one batch evaluation
+ * @param nodes nodes to score
+ * @param first index of the first node
+ * @param evaluator board evaluator
+ * @param batch scratch batch
+ */
+void scoreNodes(std::vector<Node> &nodes, size_t first,
+                const Evaluator &evaluator, game::BoardBatch &batch) {
+  int count = static_cast<int>(
+      std::min<size_t>(game::BATCH_LANES, nodes.size() - first));
+  std::array<int, game::BATCH_LANES> lines{};
+  std::array<double, game::BATCH_LANES> scores{};
+  for (int lane = 0; lane < count; ++lane) {
+    batch.load(lane, nodes[first + lane].board);
+    lines[lane] = nodes[first + lane].totalLines;
+  }
+
+  evaluator.evaluateBatch(batch, count, lines.data(), scores.data());
+  for (int lane = 0; lane < count; ++lane) {
+    nodes[first + lane].score = scores[lane];
+  }
+}
+
+} // namespace
+
+BotEngine::BotEngine(size_t threadCount, const EvaluatorWeights &weights)
+    : evaluator_(weights), pool_(threadCount) {
+  notifyFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (notifyFd_ < 0) {
+    std::cerr << "failed to create bot notify eventfd: " << strerror(errno)
+              << std::endl;
+  }
+}
+
+BotEngine::~BotEngine() {
+  // finish running searches before results are destroyed
+  pool_.stop();
+
+  if (notifyFd_ >= 0) {
+    close(notifyFd_);
+  }
+}
+
+bool BotEngine::requestMove(const BotRequest &request) {
+  if (!inFlight_.insert(request.botId).second) {
+    return false;
+  }
+
+  pool_.submit([this, request] {
+    BotMove move = search(request, evaluator_);
+    {
+      std::lock_guard<std::mutex> lock(resultMutex_);
+      results_.push_back(std::move(move));
+    }
+
+    // wake the event loop
+    if (notifyFd_ >= 0) {
+      uint64_t one = 1;
+      ssize_t n = write(notifyFd_, &one, sizeof(one));
+      (void)n;
+    }
+  });
+  return true;
+}
+
+size_t BotEngine::pollResults(std::vector<BotMove> &out) {
+  // drain eventfd counter
+  if (notifyFd_ >= 0) {
+    uint64_t count = 0;
+    ssize_t n = read(notifyFd_, &count, sizeof(count));
+    (void)n;
+  }
+
+  size_t start = out.size();
+  {
+    std::lock_guard<std::mutex> lock(resultMutex_);
+    for (BotMove &move : results_) {
+      out.push_back(std::move(move));
+    }
+    results_.clear();
+  }
+
+  for (size_t i = start; i < out.size(); ++i) {
+    inFlight_.erase(out[i].botId);
+  }
+  return out.size() - start;
+}
+
+BotMove BotEngine::search(const BotRequest &request,
+                          const Evaluator &evaluator) {
+  // move generator buffers are per thread
+  thread_local game::MoveGenerator generator;
+  thread_local std::vector<game::Placement> placements;
+  thread_local game::BoardBatch batch;
+
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(request.difficulty.timeBudgetMs);
+
+  BotMove result;
+  result.botId = request.botId;
+
+  // piece list: current piece followed by preview
+  std::array<game::CellType, game::PREVIEW_SIZE + 1> pieces{};
+  pieces[0] = request.current;
+  for (int i = 0; i < game::PREVIEW_SIZE; ++i) {
+    pieces[i + 1] = static_cast<game::CellType>(request.preview[i]);
+  }
+
+  int depth = std::clamp(request.difficulty.depth, 1,
+                         static_cast<int>(pieces.size()));
+  size_t width = static_cast<size_t>(std::max(1, request.difficulty.width));
+
+  std::vector<Node> beam(1);
+  beam[0].board = request.board;
+  beam[0].hold = request.hold;
+
+  std::vector<Node> next;
+  bool timedOut = false;
+
+  for (int ply = 0; ply < depth && !timedOut; ++ply) {
+    next.clear();
+
+    for (const Node &node : beam) {
+      if (std::chrono::steady_clock::now() >= deadline && ply > 0) {
+        timedOut = true;
+        break;
+      }
+      if (node.queueIndex >= static_cast<int>(pieces.size())) {
+        continue;
+      }
+
+      // candidate pieces: place current, or hold and place the other one
+      game::CellType current = pieces[node.queueIndex];
+      bool canHold = (ply > 0 || request.holdAvailable);
+      for (int option = 0; option < (canHold ? 2 : 1); ++option) {
+        game::CellType type = current;
+        game::CellType hold = node.hold;
+        int queueIndex = node.queueIndex + 1;
+
+        if (option == 1) {
+          if (node.hold == game::CellType::EMPTY) {
+            if (queueIndex >= static_cast<int>(pieces.size())) {
+              continue;
+            }
+            type = pieces[queueIndex];
+            ++queueIndex;
+          } else if (node.hold == current) {
+            continue; // swapping equal pieces changes nothing
+          } else {
+            type = node.hold;
+          }
+          hold = current;
+        }
+
+        generator.generate(node.board, type, placements);
+        for (const game::Placement &placement : placements) {
+          Node child;
+          child.board = node.board;
+          child.hold = hold;
+          child.queueIndex = queueIndex;
+          child.totalLines =
+              node.totalLines + applyPlacement(child.board, type, placement);
+          child.rootHold = (ply == 0) ? (option == 1) : node.rootHold;
+          child.rootPiece = (ply == 0) ? type : node.rootPiece;
+          child.rootPlacement = (ply == 0) ? placement : node.rootPlacement;
+          next.push_back(std::move(child));
+          ++result.nodes;
+        }
+      }
+    }
+
+    if (next.empty()) {
+      break;
+    }
+
+    // score the children a batch at a time
+    for (size_t first = 0; first < next.size(); first += game::BATCH_LANES) {
+      scoreNodes(next, first, evaluator, batch);
+    }
+
+    // keep the best width nodes
+    size_t keep = std::min(width, next.size());
+    std::partial_sort(next.begin(), next.begin() + keep, next.end(),
+                      [](const Node &a, const Node &b) {
+                        return a.score > b.score;
+                      });
+    next.resize(keep);
+    beam.swap(next);
+    result.depthReached = ply + 1;
+  }
+
+  if (result.depthReached == 0) {
+    return result;
+  }
+
+  const Node &best = beam.front();
+  result.found = true;
+  result.useHold = best.rootHold;
+  result.piece = best.rootPiece;
+  result.placement = best.rootPlacement;
+  result.score = best.score;
+
+  // rebuild the input path on the root board, the search is deterministic so
+  // the same placement is found again
+  generator.generate(request.board, best.rootPiece, placements);
+  for (const game::Placement &placement : placements) {
+    if (placement.x == best.rootPlacement.x &&
+        placement.y == best.rootPlacement.y &&
+        placement.rotation == best.rootPlacement.rotation &&
+        placement.spin == best.rootPlacement.spin) {
+      generator.buildPath(placement, result.path);
+      // the hard drop covers the soft drops straight down before it
+      while (result.path.size() >= 2 &&
+             result.path[result.path.size() - 2] == game::Input::SOFT_DROP) {
+        result.path.erase(result.path.end() - 2);
+      }
+      break;
+    }
+  }
+  if (result.useHold) {
+    result.path.insert(result.path.begin(), game::Input::HOLD);
+  }
+
+  return result;
+}
+
+} // namespace bot
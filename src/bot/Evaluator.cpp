@@ -0,0 +1,94 @@
+#include "bot/Evaluator.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+
+namespace bot {
+
+BoardFeatures Evaluator::computeFeatures(const game::Board &board) {
+  BoardFeatures features;
+  std::array<int, game::BOARD_WIDTH> heights{};
+
+  for (int x = 0; x < game::BOARD_WIDTH; ++x) {
+    heights[x] = board.getColumnHeight(x);
+
+    // empty cells under the column top are holes
+    for (int y = 0; y < heights[x]; ++y) {
+      if ((board.getRowMask(y) & (1u << x)) == 0) {
+        ++features.holes;
+      }
+    }
+  }
+
+  addHeightFeatures(heights.data(), features);
+  return features;
+}
+
+double Evaluator::evaluate(const game::Board &board, int linesCleared) const {
+  if (board.hasBlocksAboveVisible()) {
+    return weights_.topOut;
+  }
+  return score(computeFeatures(board), linesCleared);
+}
+
+void Evaluator::evaluateBatch(const game::BoardBatch &batch, int count,
+                              const int *linesCleared, double *scores) const {
+  game::BoardBatch::LaneHeights laneHeights;
+  game::BoardBatch::LaneCounts holes;
+  batch.columnHeights(laneHeights);
+  batch.holeCounts(holes);
+
+  for (int lane = 0; lane < count; ++lane) {
+    // same top out rule as Board::hasBlocksAboveVisible()
+    bool toppedOut = false;
+    for (int y = game::BOARD_HEIGHT;
+         y < game::BOARD_HEIGHT + game::BOARD_BUFFER; ++y) {
+      toppedOut |= batch.getRowMask(lane, y) != 0;
+    }
+    if (toppedOut) {
+      scores[lane] = weights_.topOut;
+      continue;
+    }
+
+    BoardFeatures features;
+    std::array<int, game::BOARD_WIDTH> heights{};
+    for (int x = 0; x < game::BOARD_WIDTH; ++x) {
+      heights[x] = laneHeights[lane][x];
+    }
+    features.holes = holes[lane];
+    addHeightFeatures(heights.data(), features);
+    scores[lane] = score(features, linesCleared[lane]);
+  }
+}
+
+void Evaluator::addHeightFeatures(const int *heights,
+                                  BoardFeatures &features) {
+  for (int x = 0; x < game::BOARD_WIDTH; ++x) {
+    features.aggregateHeight += heights[x];
+    features.maxHeight = std::max(features.maxHeight, heights[x]);
+
+    if (x + 1 < game::BOARD_WIDTH) {
+      features.bumpiness += std::abs(heights[x] - heights[x + 1]);
+    }
+
+    // walls count as infinitely high neighbors
+    int left = (x > 0) ? heights[x - 1] : game::BOARD_HEIGHT;
+    int right = (x + 1 < game::BOARD_WIDTH) ? heights[x + 1]
+                                            : game::BOARD_HEIGHT;
+    int depth = std::min(left, right) - heights[x];
+    features.wellDepth = std::max(features.wellDepth, depth);
+  }
+}
+
+double Evaluator::score(const BoardFeatures &features,
+                        int linesCleared) const {
+  return weights_.aggregateHeight * features.aggregateHeight +
+         weights_.maxHeight * features.maxHeight +
+         weights_.holes * features.holes +
+         weights_.bumpiness * features.bumpiness +
+         weights_.wellDepth * features.wellDepth +
+         weights_.linesCleared * linesCleared;
+}
+
+} // namespace bot
@@ -0,0 +1,127 @@
+#include "bot/ThreadPool.h"
+
+#include <algorithm>
+
+namespace bot {
+
+namespace {
+
+// pool and worker index owning the current thread, nullptr outside a pool
+thread_local const void *currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threadCount) {
+  if (threadCount == 0) {
+    threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+  }
+
+  workers_.reserve(threadCount);
+  for (size_t i = 0; i < threadCount; ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+
+  threads_.reserve(threadCount);
+  for (size_t i = 0; i < threadCount; ++i) {
+    threads_.emplace_back([this, i] { run(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() { stop(); }
+
+void ThreadPool::submit(Task task) {
+  if (!running_) {
+    return;
+  }
+
+  // keep tasks spawned by a worker local, spread external tasks round robin
+  size_t index = (currentPool == this)
+                     ? currentWorker
+                     : nextWorker_.fetch_add(1) % workers_.size();
+  {
+    // counted under the lock a thief takes the task under, so the count
+    // never drops below the tasks actually queued
+    std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+    workers_[index]->tasks.push_back(std::move(task));
+    ++pending_;
+  }
+
+  // pass through the sleep lock so a worker between its check and its wait
+  // does not miss the notification
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+  }
+  wakeup_.notify_one();
+}
+
+void ThreadPool::stop() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+  }
+  wakeup_.notify_all();
+
+  for (std::thread &thread : threads_) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+
+  // workers only finish the task they are running, drop the queued ones
+  for (std::unique_ptr<Worker> &worker : workers_) {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    pending_ -= worker->tasks.size();
+    worker->tasks.clear();
+  }
+}
+
+void ThreadPool::run(size_t index) {
+  currentPool = this;
+  currentWorker = index;
+
+  while (running_) {
+    Task task;
+    if (take(index, task)) {
+      task();
+      continue;
+    }
+
+    // sleep until a task is submitted or the pool stops
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    wakeup_.wait(lock, [this] { return pending_ > 0 || !running_; });
+  }
+}
+
+bool ThreadPool::take(size_t index, Task &task) {
+  // newest task from own deque first
+  {
+    Worker &own = *workers_[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      --pending_;
+      return true;
+    }
+  }
+
+  // steal oldest task from other workers
+  for (size_t i = 1; i < workers_.size(); ++i) {
+    Worker &victim = *workers_[(index + i) % workers_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      --pending_;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+} // namespace bot
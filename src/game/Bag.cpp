@@ -1,82 +1,67 @@
 #include "game/Bag.h"
-#include "game/Board.h"
 
-#include <algorithm>
-#include <chrono>
+#include <utility>
 
 namespace game {
 
-Bag::Bag(uint64_t seed) : pieceCount_(0) {
-  if (seed == 0) {
-    // generate random seed from high-resolution clock
-    seed = static_cast<uint64_t>(
-        std::chrono::high_resolution_clock::now().time_since_epoch().count());
-  }
-  reset(seed);
+Bag::Bag(uint64_t seed) : pieceCount_(0) { reset(seed); }
+
+Bag::Bag(std::shared_ptr<PieceSequence> sequence) : pieceCount_(0) {
+  reset(std::move(sequence));
 }
 
 void Bag::reset(uint64_t seed) {
-  seed_ = seed;
-  rng_.seed(seed_);
-  queue_.clear();
+  // own a private sequence (seed 0 lets the sequence pick a random seed)
+  reset(std::make_shared<PieceSequence>(seed));
+}
+
+void Bag::reset(std::shared_ptr<PieceSequence> sequence) {
+  sequence_ = std::move(sequence);
   pieceCount_ = 0;
 
-  // prefill queue with enough pieces for preview
+  // prefill sequence with enough pieces for preview
   ensureQueue();
 }
 
-uint64_t Bag::getSeed() const { return seed_; }
+uint64_t Bag::getSeed() const { return sequence_->getSeed(); }
 
 uint8_t Bag::next() {
-  ensureQueue();
-
-  uint8_t piece = queue_.front();
-  queue_.pop_front();
+  uint8_t piece = sequence_->data()[pieceCount_];
   ++pieceCount_;
 
+  // keep preview readable without generating on peek
+  ensureQueue();
+
   return piece;
 }
 
 uint8_t Bag::peek(int index) const {
-  if (index < 0 || static_cast<size_t>(index) >= queue_.size()) {
+  if (index < 0 || pieceCount_ + static_cast<uint32_t>(index) >=
+                       sequence_->size()) {
     return 0;
   }
-  return queue_[static_cast<size_t>(index)];
+  return sequence_->data()[pieceCount_ + static_cast<uint32_t>(index)];
 }
 
 std::array<uint8_t, PREVIEW_SIZE> Bag::getPreview() const {
   std::array<uint8_t, PREVIEW_SIZE> preview{};
+  const uint8_t *pieces = sequence_->data() + pieceCount_;
   for (int i = 0; i < PREVIEW_SIZE; ++i) {
-    preview[static_cast<size_t>(i)] = peek(i);
+    preview[static_cast<size_t>(i)] = pieces[i];
   }
   return preview;
 }
 
 uint32_t Bag::getPieceCount() const { return pieceCount_; }
 
-void Bag::generateBag() {
-  // create a bag with all 7 pieces
-  std::array<uint8_t, PIECE_COUNT> bag = {CELL_I, CELL_O, CELL_T, CELL_S,
-                                          CELL_Z, CELL_J, CELL_L};
-
-  // shuffle the bag
-  for (int i = PIECE_COUNT - 1; i > 0; --i) {
-    std::uniform_int_distribution<int> dist(0, i);
-    int j = dist(rng_);
-    std::swap(bag[static_cast<size_t>(i)], bag[static_cast<size_t>(j)]);
-  }
-
-  // add shuffled pieces to queue
-  for (uint8_t piece : bag) {
-    queue_.push_back(piece);
-  }
+void Bag::setPieceCount(uint32_t count) {
+  pieceCount_ = count;
+  ensureQueue();
 }
 
 void Bag::ensureQueue() {
   // ensure enough pieces for preview + current piece
-  while (queue_.size() < static_cast<size_t>(PREVIEW_SIZE + 1)) {
-    generateBag();
-  }
+  sequence_->ensure(pieceCount_ + static_cast<uint32_t>(PREVIEW_SIZE + 1));
 }
 
 } // namespace game
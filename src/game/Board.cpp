@@ -1,4 +1,5 @@
 #include "game/Board.h"
+#include "game/Zobrist.h"
 
 #include <algorithm>
 
@@ -7,9 +8,14 @@ namespace game {
 Board::Board() { clear(); }
 
 void Board::clear() {
-  for (auto &row : grid_) {
-    row.fill(CELL_EMPTY);
+  ++version_;
+  for (int y = 0; y < BOARD_HEIGHT + BOARD_BUFFER; ++y) {
+    grid_[y].fill(CELL_EMPTY);
+    markRowDirty(y);
+    rowMask_[y] = 0;
+    rowHash_[y] = 0;
   }
+  hash_ = 0;
 }
 
 uint8_t Board::getCell(int x, int y) const {
@@ -23,7 +29,18 @@ bool Board::setCell(int x, int y, uint8_t value) {
   if (!isInBounds(x, y)) {
     return false;
   }
-  grid_[y][x] = value;
+  if (grid_[y][x] != value) {
+    ++version_;
+    setRowHash(y, rowHash_[y] ^ zobrist::cellKey(x, grid_[y][x]) ^
+                      zobrist::cellKey(x, value));
+    grid_[y][x] = value;
+    if (value == CELL_EMPTY) {
+      rowMask_[y] &= static_cast<uint16_t>(~(1u << x));
+    } else {
+      rowMask_[y] |= static_cast<uint16_t>(1u << x);
+    }
+    markRowDirty(y);
+  }
   return true;
 }
 
@@ -37,26 +54,14 @@ bool Board::isRowFull(int y) const {
   if (y < 0 || y >= BOARD_HEIGHT + BOARD_BUFFER) {
     return false;
   }
-
-  for (int x = 0; x < BOARD_WIDTH; ++x) {
-    if (grid_[y][x] == CELL_EMPTY) {
-      return false;
-    }
-  }
-  return true;
+  return rowMask_[y] == FULL_ROW_MASK;
 }
 
 bool Board::isRowEmpty(int y) const {
   if (y < 0 || y >= BOARD_HEIGHT + BOARD_BUFFER) {
     return true;
   }
-
-  for (int x = 0; x < BOARD_WIDTH; ++x) {
-    if (grid_[y][x] != CELL_EMPTY) {
-      return false;
-    }
-  }
-  return true;
+  return rowMask_[y] == 0;
 }
 
 void Board::clearRow(int y) {
@@ -64,13 +69,26 @@ void Board::clearRow(int y) {
     return;
   }
 
-  // shift all rows above down by one
+  ++version_;
+
+  // shift all rows above down by one, only rows whose content changes are
+  // marked dirty so empty rows above the stack stay clean
   for (int row = y; row < BOARD_HEIGHT + BOARD_BUFFER - 1; ++row) {
-    grid_[row] = grid_[row + 1];
+    if (grid_[row] != grid_[row + 1]) {
+      grid_[row] = grid_[row + 1];
+      rowMask_[row] = rowMask_[row + 1];
+      setRowHash(row, rowHash_[row + 1]);
+      markRowDirty(row);
+    }
   }
 
   // clear the top row
-  grid_[BOARD_HEIGHT + BOARD_BUFFER - 1].fill(CELL_EMPTY);
+  if (!isRowEmpty(BOARD_HEIGHT + BOARD_BUFFER - 1)) {
+    grid_[BOARD_HEIGHT + BOARD_BUFFER - 1].fill(CELL_EMPTY);
+    rowMask_[BOARD_HEIGHT + BOARD_BUFFER - 1] = 0;
+    setRowHash(BOARD_HEIGHT + BOARD_BUFFER - 1, 0);
+    markRowDirty(BOARD_HEIGHT + BOARD_BUFFER - 1);
+  }
 }
 
 int Board::clearFullRows() {
@@ -89,7 +107,25 @@ int Board::clearFullRows() {
 }
 
 bool Board::addGarbageLines(int lines, int holeColumn) {
-  if (lines <= 0 || holeColumn < 0 || holeColumn >= BOARD_WIDTH) {
+  if (lines <= 0 || lines > UINT8_MAX || holeColumn < 0 ||
+      holeColumn >= BOARD_WIDTH) {
+    return false;
+  }
+  GarbageSegment segment;
+  segment.lines = static_cast<uint8_t>(lines);
+  segment.holeColumn = static_cast<uint8_t>(holeColumn);
+  return addGarbage(&segment, 1);
+}
+
+bool Board::addGarbage(const GarbageSegment *segments, int count) {
+  int lines = 0;
+  for (int i = 0; i < count; ++i) {
+    if (segments[i].lines == 0 || segments[i].holeColumn >= BOARD_WIDTH) {
+      return false;
+    }
+    lines += segments[i].lines;
+  }
+  if (lines <= 0 || lines > BOARD_HEIGHT + BOARD_BUFFER) {
     return false;
   }
 
@@ -101,15 +137,40 @@ bool Board::addGarbageLines(int lines, int holeColumn) {
     }
   }
 
-  // shift all rows up by lines
+  ++version_;
+
+  // shift all rows up by the total once
   for (int y = BOARD_HEIGHT + BOARD_BUFFER - 1; y >= lines; --y) {
-    grid_[y] = grid_[y - lines];
+    if (grid_[y] != grid_[y - lines]) {
+      grid_[y] = grid_[y - lines];
+      rowMask_[y] = rowMask_[y - lines];
+      setRowHash(y, rowHash_[y - lines]);
+      markRowDirty(y);
+    }
   }
 
-  // add garbage lines at the bottom
-  for (int y = 0; y < lines; ++y) {
+  // fill from the top of the new garbage down, first segment highest
+  int y = lines;
+  for (int i = 0; i < count; ++i) {
+    int holeColumn = segments[i].holeColumn;
+
+    // every line of a segment has the same row hash
+    uint64_t garbageHash = 0;
     for (int x = 0; x < BOARD_WIDTH; ++x) {
-      grid_[y][x] = (x == holeColumn) ? CELL_EMPTY : CELL_GARBAGE;
+      if (x != holeColumn) {
+        garbageHash ^= zobrist::cellKey(x, CELL_GARBAGE);
+      }
+    }
+
+    for (int line = 0; line < segments[i].lines; ++line) {
+      --y;
+      for (int x = 0; x < BOARD_WIDTH; ++x) {
+        grid_[y][x] = (x == holeColumn) ? CELL_EMPTY : CELL_GARBAGE;
+      }
+      rowMask_[y] =
+          static_cast<uint16_t>(FULL_ROW_MASK & ~(1u << holeColumn));
+      setRowHash(y, garbageHash);
+      markRowDirty(y);
     }
   }
 
@@ -131,13 +192,52 @@ int Board::getColumnHeight(int x) const {
   }
 
   for (int y = BOARD_HEIGHT + BOARD_BUFFER - 1; y >= 0; --y) {
-    if (grid_[y][x] != CELL_EMPTY) {
+    if (rowMask_[y] & (1u << x)) {
       return y + 1;
     }
   }
   return 0;
 }
 
+uint32_t Board::getRowVersion(int y) const {
+  if (y < 0 || y >= BOARD_HEIGHT + BOARD_BUFFER) {
+    return 0;
+  }
+  return rowVersion_[y];
+}
+
+uint32_t Board::getRowsChangedSince(uint32_t version) const {
+  // dirty mask already holds the answer for the last flushed version
+  if (version == dirtyBaseVersion_) {
+    return dirtyRows_;
+  }
+
+  uint32_t mask = 0;
+  for (int y = 0; y < BOARD_HEIGHT + BOARD_BUFFER; ++y) {
+    if (rowVersion_[y] > version) {
+      mask |= 1u << y;
+    }
+  }
+  return mask;
+}
+
+uint64_t Board::computeHash() const {
+  uint64_t hash = 0;
+  for (int y = 0; y < BOARD_HEIGHT + BOARD_BUFFER; ++y) {
+    uint64_t rowHash = 0;
+    for (int x = 0; x < BOARD_WIDTH; ++x) {
+      rowHash ^= zobrist::cellKey(x, grid_[y][x]);
+    }
+    hash ^= zobrist::rowKey(y, rowHash);
+  }
+  return hash;
+}
+
+void Board::setRowHash(int y, uint64_t rowHash) {
+  hash_ ^= zobrist::rowKey(y, rowHash_[y]) ^ zobrist::rowKey(y, rowHash);
+  rowHash_[y] = rowHash;
+}
+
 int Board::getBoardHeight() const {
   int maxHeight = 0;
   for (int x = 0; x < BOARD_WIDTH; ++x) {
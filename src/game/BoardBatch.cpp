@@ -0,0 +1,579 @@
+#include "game/BoardBatch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TETORIO_BATCH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace game {
+
+namespace {
+
+constexpr int ROWS = BOARD_HEIGHT + BOARD_BUFFER;
+
+/**
+ * PieceRows stores piece rows shifted into board columns for collision.
+ */
+struct PieceRows {
+  int count = 0;            // number of rows to test
+  int y[4] = {0, 0, 0, 0};  // board rows
+  uint16_t mask[4] = {0, 0, 0, 0};
+  bool outside = false;     // piece leaves the board, collides everywhere
+};
+
+/**
+ * shift piece rows into board columns, same bounds rules as Piece::collides
+ */
+PieceRows preparePiece(CellType type, Rotation rotation, int x, int y) {
+  PieceRows piece;
+  const Piece::RowMasks &rows = Piece::getRowMasks(type, rotation);
+
+  for (int row = 0; row < 4; ++row) {
+    uint32_t mask = rows[row];
+    if (mask == 0) {
+      continue;
+    }
+
+    int by = y - row;
+    if (by < 0 || by >= ROWS || x >= BOARD_WIDTH || x <= -4) {
+      piece.outside = true;
+      return piece;
+    }
+    if (x >= 0) {
+      mask <<= x;
+    } else {
+      if (mask & ((1u << -x) - 1)) {
+        piece.outside = true;
+        return piece;
+      }
+      mask >>= -x;
+    }
+    if (mask & ~static_cast<uint32_t>(FULL_ROW_MASK)) {
+      piece.outside = true;
+      return piece;
+    }
+
+    piece.y[piece.count] = by;
+    piece.mask[piece.count] = static_cast<uint16_t>(mask);
+    ++piece.count;
+  }
+  return piece;
+}
+
+/**
+ * Kernels stores one implementation of every batch kernel.
+ */
+struct Kernels {
+  uint32_t (*collides)(const uint16_t *rows, const PieceRows &piece);
+  void (*fullRows)(const uint16_t *rows, uint32_t *out);
+  void (*columnHeights)(const uint16_t *rows, uint8_t *out);
+  void (*holeCounts)(const uint16_t *rows, uint8_t *out);
+  void (*clearFullRows)(uint16_t *rows, uint8_t *cleared);
+};
+
+// scalar kernels
+
+uint32_t collidesScalar(const uint16_t *rows, const PieceRows &piece) {
+  uint32_t result = 0;
+  for (int lane = 0; lane < BATCH_LANES; ++lane) {
+    for (int i = 0; i < piece.count; ++i) {
+      if (rows[piece.y[i] * BATCH_LANES + lane] & piece.mask[i]) {
+        result |= 1u << lane;
+        break;
+      }
+    }
+  }
+  return result;
+}
+
+void fullRowsScalar(const uint16_t *rows, uint32_t *out) {
+  for (int lane = 0; lane < BATCH_LANES; ++lane) {
+    uint32_t mask = 0;
+    for (int y = 0; y < ROWS; ++y) {
+      if (rows[y * BATCH_LANES + lane] == FULL_ROW_MASK) {
+        mask |= 1u << y;
+      }
+    }
+    out[lane] = mask;
+  }
+}
+
+void columnHeightsScalar(const uint16_t *rows, uint8_t *out) {
+  for (int lane = 0; lane < BATCH_LANES; ++lane) {
+    for (int x = 0; x < BOARD_WIDTH; ++x) {
+      uint8_t height = 0;
+      for (int y = ROWS - 1; y >= 0; --y) {
+        if (rows[y * BATCH_LANES + lane] & (1u << x)) {
+          height = static_cast<uint8_t>(y + 1);
+          break;
+        }
+      }
+      out[lane * BOARD_WIDTH + x] = height;
+    }
+  }
+}
+
+void holeCountsScalar(const uint16_t *rows, uint8_t *out) {
+  for (int lane = 0; lane < BATCH_LANES; ++lane) {
+    uint32_t covered = 0;
+    int holes = 0;
+    for (int y = ROWS - 1; y >= 0; --y) {
+      uint32_t row = rows[y * BATCH_LANES + lane];
+      holes += __builtin_popcount(covered & ~row & FULL_ROW_MASK);
+      covered |= row;
+    }
+    out[lane] = static_cast<uint8_t>(holes);
+  }
+}
+
+void clearFullRowsScalar(uint16_t *rows, uint8_t *cleared) {
+  for (int lane = 0; lane < BATCH_LANES; ++lane) {
+    int write = 0;
+    for (int y = 0; y < ROWS; ++y) {
+      uint16_t row = rows[y * BATCH_LANES + lane];
+      if (row != FULL_ROW_MASK) {
+        rows[write * BATCH_LANES + lane] = row;
+        ++write;
+      }
+    }
+    cleared[lane] = static_cast<uint8_t>(ROWS - write);
+    for (; write < ROWS; ++write) {
+      rows[write * BATCH_LANES + lane] = 0;
+    }
+  }
+}
+
+constexpr Kernels SCALAR_KERNELS = {collidesScalar, fullRowsScalar,
+                                    columnHeightsScalar, holeCountsScalar,
+                                    clearFullRowsScalar};
+
+#ifdef TETORIO_BATCH_X86
+
+// SSE2 kernels, each row is two registers of 8 lanes
+
+/**
+ * popcount of each 16-bit lane
+ */
+__attribute__((target("sse2"))) inline __m128i popcount16Sse2(__m128i v) {
+  const __m128i m1 = _mm_set1_epi16(0x5555);
+  const __m128i m2 = _mm_set1_epi16(0x3333);
+  const __m128i m4 = _mm_set1_epi16(0x0F0F);
+  v = _mm_sub_epi16(v, _mm_and_si128(_mm_srli_epi16(v, 1), m1));
+  v = _mm_add_epi16(_mm_and_si128(v, m2),
+                    _mm_and_si128(_mm_srli_epi16(v, 2), m2));
+  v = _mm_and_si128(_mm_add_epi16(v, _mm_srli_epi16(v, 4)), m4);
+  v = _mm_add_epi16(v, _mm_srli_epi16(v, 8));
+  return _mm_and_si128(v, _mm_set1_epi16(0x001F));
+}
+
+/**
+ * lane mask of 16-bit lanes that are all ones in lo (0-7) and hi (8-15)
+ */
+__attribute__((target("sse2"))) inline uint32_t laneMaskSse2(__m128i lo,
+                                                             __m128i hi) {
+  return static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(lo, hi)));
+}
+
+__attribute__((target("sse2"))) uint32_t
+collidesSse2(const uint16_t *rows, const PieceRows &piece) {
+  __m128i lo = _mm_setzero_si128();
+  __m128i hi = _mm_setzero_si128();
+  for (int i = 0; i < piece.count; ++i) {
+    const uint16_t *row = rows + piece.y[i] * BATCH_LANES;
+    __m128i mask = _mm_set1_epi16(static_cast<short>(piece.mask[i]));
+    lo = _mm_or_si128(lo, _mm_and_si128(
+                              _mm_load_si128(reinterpret_cast<const __m128i *>(
+                                  row)),
+                              mask));
+    hi = _mm_or_si128(hi, _mm_and_si128(
+                              _mm_load_si128(reinterpret_cast<const __m128i *>(
+                                  row + 8)),
+                              mask));
+  }
+  const __m128i zero = _mm_setzero_si128();
+  return ~laneMaskSse2(_mm_cmpeq_epi16(lo, zero), _mm_cmpeq_epi16(hi, zero)) &
+         0xFFFFu;
+}
+
+__attribute__((target("sse2"))) void fullRowsSse2(const uint16_t *rows,
+                                                  uint32_t *out) {
+  const __m128i full = _mm_set1_epi16(static_cast<short>(FULL_ROW_MASK));
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc[4] = {zero, zero, zero, zero}; // 32-bit lanes 0-3, ..., 12-15
+
+  for (int y = 0; y < ROWS; ++y) {
+    const uint16_t *row = rows + y * BATCH_LANES;
+    __m128i bit = _mm_set1_epi32(static_cast<int>(1u << y));
+    __m128i lo = _mm_cmpeq_epi16(
+        _mm_load_si128(reinterpret_cast<const __m128i *>(row)), full);
+    __m128i hi = _mm_cmpeq_epi16(
+        _mm_load_si128(reinterpret_cast<const __m128i *>(row + 8)), full);
+    // widen 16-bit all-ones lanes to 32-bit all-ones lanes
+    acc[0] = _mm_or_si128(acc[0],
+                          _mm_and_si128(_mm_unpacklo_epi16(lo, lo), bit));
+    acc[1] = _mm_or_si128(acc[1],
+                          _mm_and_si128(_mm_unpackhi_epi16(lo, lo), bit));
+    acc[2] = _mm_or_si128(acc[2],
+                          _mm_and_si128(_mm_unpacklo_epi16(hi, hi), bit));
+    acc[3] = _mm_or_si128(acc[3],
+                          _mm_and_si128(_mm_unpackhi_epi16(hi, hi), bit));
+  }
+
+  for (int i = 0; i < 4; ++i) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 4), acc[i]);
+  }
+}
+
+__attribute__((target("sse2"))) void columnHeightsSse2(const uint16_t *rows,
+                                                       uint8_t *out) {
+  const __m128i zero = _mm_setzero_si128();
+  alignas(16) uint16_t heights[BATCH_LANES];
+
+  for (int x = 0; x < BOARD_WIDTH; ++x) {
+    const __m128i bit = _mm_set1_epi16(static_cast<short>(1u << x));
+    __m128i lo = zero;
+    __m128i hi = zero;
+    for (int y = 0; y < ROWS; ++y) {
+      const uint16_t *row = rows + y * BATCH_LANES;
+      __m128i height = _mm_set1_epi16(static_cast<short>(y + 1));
+      // occupied lanes take y + 1, the highest occupied row wins
+      __m128i occLo = _mm_cmpeq_epi16(
+          _mm_and_si128(_mm_load_si128(reinterpret_cast<const __m128i *>(row)),
+                        bit),
+          bit);
+      __m128i occHi = _mm_cmpeq_epi16(
+          _mm_and_si128(
+              _mm_load_si128(reinterpret_cast<const __m128i *>(row + 8)), bit),
+          bit);
+      lo = _mm_or_si128(_mm_and_si128(occLo, height),
+                        _mm_andnot_si128(occLo, lo));
+      hi = _mm_or_si128(_mm_and_si128(occHi, height),
+                        _mm_andnot_si128(occHi, hi));
+    }
+    _mm_store_si128(reinterpret_cast<__m128i *>(heights), lo);
+    _mm_store_si128(reinterpret_cast<__m128i *>(heights + 8), hi);
+    for (int lane = 0; lane < BATCH_LANES; ++lane) {
+      out[lane * BOARD_WIDTH + x] = static_cast<uint8_t>(heights[lane]);
+    }
+  }
+}
+
+__attribute__((target("sse2"))) void holeCountsSse2(const uint16_t *rows,
+                                                    uint8_t *out) {
+  const __m128i full = _mm_set1_epi16(static_cast<short>(FULL_ROW_MASK));
+  __m128i coveredLo = _mm_setzero_si128();
+  __m128i coveredHi = _mm_setzero_si128();
+  __m128i holesLo = _mm_setzero_si128();
+  __m128i holesHi = _mm_setzero_si128();
+
+  for (int y = ROWS - 1; y >= 0; --y) {
+    const uint16_t *row = rows + y * BATCH_LANES;
+    __m128i lo = _mm_load_si128(reinterpret_cast<const __m128i *>(row));
+    __m128i hi = _mm_load_si128(reinterpret_cast<const __m128i *>(row + 8));
+    holesLo = _mm_add_epi16(
+        holesLo, popcount16Sse2(_mm_and_si128(_mm_andnot_si128(lo, coveredLo),
+                                              full)));
+    holesHi = _mm_add_epi16(
+        holesHi, popcount16Sse2(_mm_and_si128(_mm_andnot_si128(hi, coveredHi),
+                                              full)));
+    coveredLo = _mm_or_si128(coveredLo, lo);
+    coveredHi = _mm_or_si128(coveredHi, hi);
+  }
+
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                   _mm_packus_epi16(holesLo, holesHi));
+}
+
+__attribute__((target("sse2"))) void clearFullRowsSse2(uint16_t *rows,
+                                                       uint8_t *cleared) {
+  const __m128i full = _mm_set1_epi16(static_cast<short>(FULL_ROW_MASK));
+  const __m128i zero = _mm_setzero_si128();
+  __m128i countLo = zero;
+  __m128i countHi = zero;
+
+  // every pass removes the lowest full row of each lane
+  while (true) {
+    __m128i seenLo = zero;
+    __m128i seenHi = zero;
+    for (int y = 0; y < ROWS; ++y) {
+      uint16_t *row = rows + y * BATCH_LANES;
+      __m128i lo = _mm_load_si128(reinterpret_cast<const __m128i *>(row));
+      __m128i hi = _mm_load_si128(reinterpret_cast<const __m128i *>(row + 8));
+      seenLo = _mm_or_si128(seenLo, _mm_cmpeq_epi16(lo, full));
+      seenHi = _mm_or_si128(seenHi, _mm_cmpeq_epi16(hi, full));
+
+      __m128i aboveLo = zero;
+      __m128i aboveHi = zero;
+      if (y + 1 < ROWS) {
+        aboveLo = _mm_load_si128(reinterpret_cast<const __m128i *>(
+            row + BATCH_LANES));
+        aboveHi = _mm_load_si128(reinterpret_cast<const __m128i *>(
+            row + BATCH_LANES + 8));
+      }
+      _mm_store_si128(reinterpret_cast<__m128i *>(row),
+                      _mm_or_si128(_mm_and_si128(seenLo, aboveLo),
+                                   _mm_andnot_si128(seenLo, lo)));
+      _mm_store_si128(reinterpret_cast<__m128i *>(row + 8),
+                      _mm_or_si128(_mm_and_si128(seenHi, aboveHi),
+                                   _mm_andnot_si128(seenHi, hi)));
+    }
+
+    if (laneMaskSse2(seenLo, seenHi) == 0) {
+      break;
+    }
+    countLo = _mm_sub_epi16(countLo, seenLo);
+    countHi = _mm_sub_epi16(countHi, seenHi);
+  }
+
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(cleared),
+                   _mm_packus_epi16(countLo, countHi));
+}
+
+constexpr Kernels SSE2_KERNELS = {collidesSse2, fullRowsSse2,
+                                  columnHeightsSse2, holeCountsSse2,
+                                  clearFullRowsSse2};
+
+// AVX2 kernels, each row is one register of 16 lanes
+
+__attribute__((target("avx2"))) inline __m256i popcount16Avx2(__m256i v) {
+  const __m256i m1 = _mm256_set1_epi16(0x5555);
+  const __m256i m2 = _mm256_set1_epi16(0x3333);
+  const __m256i m4 = _mm256_set1_epi16(0x0F0F);
+  v = _mm256_sub_epi16(v, _mm256_and_si256(_mm256_srli_epi16(v, 1), m1));
+  v = _mm256_add_epi16(_mm256_and_si256(v, m2),
+                       _mm256_and_si256(_mm256_srli_epi16(v, 2), m2));
+  v = _mm256_and_si256(_mm256_add_epi16(v, _mm256_srli_epi16(v, 4)), m4);
+  v = _mm256_add_epi16(v, _mm256_srli_epi16(v, 8));
+  return _mm256_and_si256(v, _mm256_set1_epi16(0x001F));
+}
+
+/**
+ * lane mask of 16-bit lanes that are all ones
+ */
+__attribute__((target("avx2"))) inline uint32_t laneMaskAvx2(__m256i v) {
+  // pack to bytes, in-lane pack leaves lanes 0-7 in byte 0-7 and 8-15 in
+  // bytes 16-23
+  uint32_t bits = static_cast<uint32_t>(
+      _mm256_movemask_epi8(_mm256_packs_epi16(v, v)));
+  return (bits & 0xFFu) | ((bits >> 8) & 0xFF00u);
+}
+
+/**
+ * store 16-bit lanes as 16 bytes
+ */
+__attribute__((target("avx2"))) inline void storeBytesAvx2(uint8_t *out,
+                                                           __m256i v) {
+  __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(v),
+                                    _mm256_extracti128_si256(v, 1));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(out), packed);
+}
+
+__attribute__((target("avx2"))) uint32_t
+collidesAvx2(const uint16_t *rows, const PieceRows &piece) {
+  __m256i acc = _mm256_setzero_si256();
+  for (int i = 0; i < piece.count; ++i) {
+    __m256i row = _mm256_load_si256(
+        reinterpret_cast<const __m256i *>(rows + piece.y[i] * BATCH_LANES));
+    acc = _mm256_or_si256(
+        acc, _mm256_and_si256(
+                 row, _mm256_set1_epi16(static_cast<short>(piece.mask[i]))));
+  }
+  return ~laneMaskAvx2(_mm256_cmpeq_epi16(acc, _mm256_setzero_si256())) &
+         0xFFFFu;
+}
+
+__attribute__((target("avx2"))) void fullRowsAvx2(const uint16_t *rows,
+                                                  uint32_t *out) {
+  const __m256i full = _mm256_set1_epi16(static_cast<short>(FULL_ROW_MASK));
+  __m256i accLo = _mm256_setzero_si256(); // 32-bit lanes 0-7
+  __m256i accHi = _mm256_setzero_si256(); // 32-bit lanes 8-15
+
+  for (int y = 0; y < ROWS; ++y) {
+    __m256i eq = _mm256_cmpeq_epi16(
+        _mm256_load_si256(
+            reinterpret_cast<const __m256i *>(rows + y * BATCH_LANES)),
+        full);
+    __m256i bit = _mm256_set1_epi32(static_cast<int>(1u << y));
+    // sign extension turns all-ones 16-bit lanes into all-ones 32-bit lanes
+    accLo = _mm256_or_si256(
+        accLo,
+        _mm256_and_si256(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(eq)),
+                         bit));
+    accHi = _mm256_or_si256(
+        accHi,
+        _mm256_and_si256(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(eq, 1)),
+                         bit));
+  }
+
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), accLo);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 8), accHi);
+}
+
+__attribute__((target("avx2"))) void columnHeightsAvx2(const uint16_t *rows,
+                                                       uint8_t *out) {
+  alignas(16) uint8_t heights[BATCH_LANES];
+
+  for (int x = 0; x < BOARD_WIDTH; ++x) {
+    const __m256i bit = _mm256_set1_epi16(static_cast<short>(1u << x));
+    __m256i acc = _mm256_setzero_si256();
+    for (int y = 0; y < ROWS; ++y) {
+      __m256i row = _mm256_load_si256(
+          reinterpret_cast<const __m256i *>(rows + y * BATCH_LANES));
+      __m256i occ = _mm256_cmpeq_epi16(_mm256_and_si256(row, bit), bit);
+      acc = _mm256_blendv_epi8(
+          acc, _mm256_set1_epi16(static_cast<short>(y + 1)), occ);
+    }
+    storeBytesAvx2(heights, acc);
+    for (int lane = 0; lane < BATCH_LANES; ++lane) {
+      out[lane * BOARD_WIDTH + x] = heights[lane];
+    }
+  }
+}
+
+__attribute__((target("avx2"))) void holeCountsAvx2(const uint16_t *rows,
+                                                    uint8_t *out) {
+  const __m256i full = _mm256_set1_epi16(static_cast<short>(FULL_ROW_MASK));
+  __m256i covered = _mm256_setzero_si256();
+  __m256i holes = _mm256_setzero_si256();
+
+  for (int y = ROWS - 1; y >= 0; --y) {
+    __m256i row = _mm256_load_si256(
+        reinterpret_cast<const __m256i *>(rows + y * BATCH_LANES));
+    holes = _mm256_add_epi16(
+        holes,
+        popcount16Avx2(_mm256_and_si256(_mm256_andnot_si256(row, covered),
+                                        full)));
+    covered = _mm256_or_si256(covered, row);
+  }
+
+  storeBytesAvx2(out, holes);
+}
+
+__attribute__((target("avx2"))) void clearFullRowsAvx2(uint16_t *rows,
+                                                       uint8_t *cleared) {
+  const __m256i full = _mm256_set1_epi16(static_cast<short>(FULL_ROW_MASK));
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i count = zero;
+
+  // every pass removes the lowest full row of each lane
+  while (true) {
+    __m256i seen = zero;
+    for (int y = 0; y < ROWS; ++y) {
+      __m256i *row = reinterpret_cast<__m256i *>(rows + y * BATCH_LANES);
+      __m256i current = _mm256_load_si256(row);
+      seen = _mm256_or_si256(seen, _mm256_cmpeq_epi16(current, full));
+      __m256i above = (y + 1 < ROWS) ? _mm256_load_si256(row + 1) : zero;
+      _mm256_store_si256(row, _mm256_blendv_epi8(current, above, seen));
+    }
+
+    if (_mm256_testz_si256(seen, seen)) {
+      break;
+    }
+    count = _mm256_sub_epi16(count, seen);
+  }
+
+  storeBytesAvx2(cleared, count);
+}
+
+constexpr Kernels AVX2_KERNELS = {collidesAvx2, fullRowsAvx2,
+                                  columnHeightsAvx2, holeCountsAvx2,
+                                  clearFullRowsAvx2};
+
+#endif // TETORIO_BATCH_X86
+
+/**
+ * get kernels for a simd level
+ */
+const Kernels &kernelsFor(SimdLevel level) {
+#ifdef TETORIO_BATCH_X86
+  if (level == SimdLevel::AVX2) {
+    return AVX2_KERNELS;
+  }
+  if (level == SimdLevel::SSE2) {
+    return SSE2_KERNELS;
+  }
+#else
+  (void)level;
+#endif
+  return SCALAR_KERNELS;
+}
+
+// active simd level, selected on first use
+SimdLevel &activeLevel() {
+  static SimdLevel level = BoardBatch::detectSimdLevel();
+  return level;
+}
+
+} // namespace
+
+BoardBatch::BoardBatch() { clear(); }
+
+void BoardBatch::clear() {
+  for (auto &row : rows_) {
+    row.fill(0);
+  }
+}
+
+void BoardBatch::load(int lane, const Board &board) {
+  if (lane < 0 || lane >= BATCH_LANES) {
+    return;
+  }
+  for (int y = 0; y < ROWS; ++y) {
+    rows_[y][lane] = board.getRowMask(y);
+  }
+}
+
+uint16_t BoardBatch::getRowMask(int lane, int y) const {
+  if (lane < 0 || lane >= BATCH_LANES || y < 0 || y >= ROWS) {
+    return 0;
+  }
+  return rows_[y][lane];
+}
+
+uint32_t BoardBatch::collides(CellType type, Rotation rotation, int x,
+                              int y) const {
+  PieceRows piece = preparePiece(type, rotation, x, y);
+  if (piece.outside) {
+    return (1u << BATCH_LANES) - 1;
+  }
+  return kernelsFor(activeLevel()).collides(rows_[0].data(), piece);
+}
+
+void BoardBatch::fullRows(LaneMasks &out) const {
+  kernelsFor(activeLevel()).fullRows(rows_[0].data(), out.data());
+}
+
+void BoardBatch::columnHeights(LaneHeights &out) const {
+  kernelsFor(activeLevel()).columnHeights(rows_[0].data(), out[0].data());
+}
+
+void BoardBatch::holeCounts(LaneCounts &out) const {
+  kernelsFor(activeLevel()).holeCounts(rows_[0].data(), out.data());
+}
+
+void BoardBatch::clearFullRows(LaneCounts &cleared) {
+  kernelsFor(activeLevel()).clearFullRows(rows_[0].data(), cleared.data());
+}
+
+SimdLevel BoardBatch::getSimdLevel() { return activeLevel(); }
+
+SimdLevel BoardBatch::setSimdLevel(SimdLevel level) {
+  SimdLevel best = detectSimdLevel();
+  activeLevel() = (level > best) ? best : level;
+  return activeLevel();
+}
+
+SimdLevel BoardBatch::detectSimdLevel() {
+#ifdef TETORIO_BATCH_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return SimdLevel::AVX2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return SimdLevel::SSE2;
+  }
+#endif
+  return SimdLevel::SCALAR;
+}
+
+} // namespace game
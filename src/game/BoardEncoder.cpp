@@ -0,0 +1,197 @@
+#include "game/BoardEncoder.h"
+
+#include <array>
+
+namespace game {
+
+namespace {
+
+// size of the fixed frame header before the row runs
+constexpr size_t KEYFRAME_HEADER_SIZE = 1 + 4 + 3;
+constexpr size_t DELTA_HEADER_SIZE = 1 + 4 + 4 + 3;
+
+using PackedRow = std::array<uint8_t, PACKED_ROW_SIZE>;
+
+void writeU32(std::vector<uint8_t> &out, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+uint32_t readU32(const uint8_t *data) {
+  return static_cast<uint32_t>(data[0]) |
+         (static_cast<uint32_t>(data[1]) << 8) |
+         (static_cast<uint32_t>(data[2]) << 16) |
+         (static_cast<uint32_t>(data[3]) << 24);
+}
+
+PackedRow packRow(const std::array<uint8_t, BOARD_WIDTH> &row) {
+  PackedRow packed{};
+  for (size_t i = 0; i < PACKED_ROW_SIZE; ++i) {
+    packed[i] = static_cast<uint8_t>((row[2 * i] & 0x0F) |
+                                     ((row[2 * i + 1] & 0x0F) << 4));
+  }
+  return packed;
+}
+
+/**
+ * walk the row runs of a frame and write them to a board
+ * @param data pointer to frame data
+ * @param len length of frame data
+ * @param pos offset of the first run
+ * @param rowMask rows present in the frame
+ * @param board board to write, nullptr to only validate
+ * @return offset after the last run, 0 if the runs are malformed
+ */
+size_t applyRows(const uint8_t *data, size_t len, size_t pos,
+                 uint32_t rowMask, Board *board) {
+  int y = 0;
+  while (rowMask >> y != 0 && y < BOARD_HEIGHT + BOARD_BUFFER) {
+    if (pos + 1 + PACKED_ROW_SIZE > len) {
+      return 0;
+    }
+
+    uint8_t count = data[pos];
+    const uint8_t *packed = data + pos + 1;
+    pos += 1 + PACKED_ROW_SIZE;
+    if (count == 0) {
+      return 0;
+    }
+    for (size_t i = 0; i < PACKED_ROW_SIZE; ++i) {
+      // nibbles above garbage are not cell types
+      if ((packed[i] & 0x0F) > CELL_GARBAGE ||
+          (packed[i] >> 4) > CELL_GARBAGE) {
+        return 0;
+      }
+    }
+
+    // apply the run to the next count present rows
+    for (; count > 0 && y < BOARD_HEIGHT + BOARD_BUFFER; ++y) {
+      if ((rowMask & (1u << y)) == 0) {
+        continue;
+      }
+      if (board != nullptr) {
+        for (int x = 0; x < BOARD_WIDTH; ++x) {
+          uint8_t cell = packed[x / 2];
+          board->setCell(x, y, (x % 2 == 0) ? (cell & 0x0F) : (cell >> 4));
+        }
+      }
+      --count;
+    }
+    if (count != 0) {
+      return 0;
+    }
+  }
+  return pos;
+}
+
+} // namespace
+
+size_t BoardEncoder::encodeKeyframe(const Board &board,
+                                    std::vector<uint8_t> &out) {
+  // only non-empty rows are listed, the decoder clears the rest
+  uint32_t rowMask = 0;
+  for (int y = 0; y < BOARD_HEIGHT + BOARD_BUFFER; ++y) {
+    if (!board.isRowEmpty(y)) {
+      rowMask |= 1u << y;
+    }
+  }
+  return encodeRows(board, BoardFrameType::KEYFRAME, 0, rowMask, out);
+}
+
+size_t BoardEncoder::encodeDelta(const Board &board, uint32_t baseVersion,
+                                 std::vector<uint8_t> &out) {
+  // client has nothing usable, send full board
+  if (baseVersion == 0 || baseVersion > board.getVersion()) {
+    return encodeKeyframe(board, out);
+  }
+
+  uint32_t rowMask = board.getRowsChangedSince(baseVersion);
+  return encodeRows(board, BoardFrameType::DELTA, baseVersion, rowMask, out);
+}
+
+size_t BoardEncoder::encodeRows(const Board &board, BoardFrameType type,
+                                uint32_t baseVersion, uint32_t rowMask,
+                                std::vector<uint8_t> &out) {
+  size_t start = out.size();
+  const auto &grid = board.getGrid();
+
+  // header
+  out.push_back(static_cast<uint8_t>(type));
+  writeU32(out, board.getVersion());
+  if (type == BoardFrameType::DELTA) {
+    writeU32(out, baseVersion);
+  }
+  out.push_back(static_cast<uint8_t>(rowMask));
+  out.push_back(static_cast<uint8_t>(rowMask >> 8));
+  out.push_back(static_cast<uint8_t>(rowMask >> 16));
+
+  // run-length encode identical consecutive rows
+  size_t countPos = 0;
+  PackedRow runRow{};
+  bool inRun = false;
+  for (int y = 0; y < BOARD_HEIGHT + BOARD_BUFFER; ++y) {
+    if ((rowMask & (1u << y)) == 0) {
+      continue;
+    }
+
+    PackedRow packed = packRow(grid[y]);
+    if (inRun && packed == runRow) {
+      ++out[countPos];
+      continue;
+    }
+
+    countPos = out.size();
+    out.push_back(1);
+    out.insert(out.end(), packed.begin(), packed.end());
+    runRow = packed;
+    inRun = true;
+  }
+
+  return out.size() - start;
+}
+
+size_t BoardEncoder::decode(const uint8_t *data, size_t len, Board &board,
+                            uint32_t &version) {
+  if (len < KEYFRAME_HEADER_SIZE) {
+    return 0;
+  }
+
+  auto type = static_cast<BoardFrameType>(data[0]);
+  uint32_t frameVersion = readU32(data + 1);
+  size_t pos = 5;
+
+  if (type == BoardFrameType::DELTA) {
+    if (len < DELTA_HEADER_SIZE) {
+      return 0;
+    }
+    // delta only applies on top of the version it was built against
+    if (readU32(data + pos) != version) {
+      return 0;
+    }
+    pos += 4;
+  } else if (type != BoardFrameType::KEYFRAME) {
+    return 0;
+  }
+
+  uint32_t rowMask = static_cast<uint32_t>(data[pos]) |
+                     (static_cast<uint32_t>(data[pos + 1]) << 8) |
+                     (static_cast<uint32_t>(data[pos + 2]) << 16);
+  pos += 3;
+
+  // check the whole frame first, a malformed one leaves the board untouched
+  size_t end = applyRows(data, len, pos, rowMask, nullptr);
+  if (end == 0) {
+    return 0;
+  }
+
+  if (type == BoardFrameType::KEYFRAME) {
+    board.clear();
+  }
+  applyRows(data, len, pos, rowMask, &board);
+
+  version = frameVersion;
+  return end;
+}
+
+} // namespace game
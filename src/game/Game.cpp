@@ -0,0 +1,375 @@
+#include "game/Game.h"
+#include "game/BoardEncoder.h"
+#include "game/MoveGenerator.h"
+#include "game/Zobrist.h"
+#include "protocol/Codec.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace game {
+
+Game::Game(std::shared_ptr<PieceSequence> sequence)
+    : bag_(std::move(sequence)) {
+  spawnNext();
+}
+
+Game::Game(uint64_t seed) : bag_(seed) { spawnNext(); }
+
+InputResult Game::applyInput(Input input) {
+  InputResult result;
+  if (toppedOut_) {
+    return result;
+  }
+
+  switch (input) {
+  case Input::MOVE_LEFT:
+  case Input::MOVE_RIGHT: {
+    int dx = (input == Input::MOVE_LEFT) ? -1 : 1;
+    if (!Piece::collides(board_, active_.getType(), active_.getRotation(),
+                         active_.getX() + dx, active_.getY())) {
+      active_.move(dx, 0);
+      lastMoveRotation_ = false;
+      result.accepted = true;
+    }
+    break;
+  }
+  case Input::SOFT_DROP:
+    if (!Piece::collides(board_, active_.getType(), active_.getRotation(),
+                         active_.getX(), active_.getY() - 1)) {
+      active_.move(0, -1);
+      lastMoveRotation_ = false;
+      result.accepted = true;
+    }
+    break;
+  case Input::ROTATE_CW:
+    result.accepted = tryRotate(active_.rotateCW(), false);
+    break;
+  case Input::ROTATE_CCW:
+    result.accepted = tryRotate(active_.rotateCCW(), false);
+    break;
+  case Input::ROTATE_180:
+    result.accepted = tryRotate(active_.rotate180(), true);
+    break;
+  case Input::HARD_DROP:
+    while (!Piece::collides(board_, active_.getType(), active_.getRotation(),
+                            active_.getX(), active_.getY() - 1)) {
+      active_.move(0, -1);
+      lastMoveRotation_ = false;
+    }
+    result.accepted = true;
+    lockActive(result);
+    break;
+  case Input::HOLD:
+    if (!holdUsed_) {
+      CellType current = active_.getType();
+      if (hold_ == CellType::EMPTY) {
+        hold_ = current;
+        spawnNext();
+      } else {
+        CellType held = hold_;
+        hold_ = current;
+        spawn(held);
+      }
+      holdUsed_ = true;
+      result.accepted = true;
+      result.toppedOut = toppedOut_;
+    }
+    break;
+  case Input::NONE:
+    break;
+  }
+
+  return result;
+}
+
+InputResult Game::applyPlacement(const PlacementClaim &claim) {
+  InputResult result;
+  if (toppedOut_ || claim.pieceIndex != piecesPlaced_ ||
+      (claim.hold && holdUsed_)) {
+    return result;
+  }
+
+  // piece that will be active once the optional hold is done
+  CellType type = active_.getType();
+  if (claim.hold) {
+    type = (hold_ == CellType::EMPTY) ? static_cast<CellType>(bag_.peek(0))
+                                      : hold_;
+  }
+
+  // claimed position must be free and resting
+  if (Piece::collides(board_, type, claim.rotation, claim.x, claim.y) ||
+      !Piece::collides(board_, type, claim.rotation, claim.x, claim.y - 1)) {
+    return result;
+  }
+
+  // most placements are drops, tucks or one-kick spins; search the rest
+  bool reachable = false;
+  if (claim.spin) {
+    reachable = MoveGenerator::isImmobile(board_, type, claim.rotation,
+                                          claim.x, claim.y) &&
+                MoveGenerator::isSpinReachable(board_, type, claim.x, claim.y,
+                                               claim.rotation);
+  } else {
+    reachable = MoveGenerator::isDropReachable(board_, type, claim.x,
+                                               claim.y, claim.rotation) ||
+                MoveGenerator::isTuckReachable(board_, type, claim.x,
+                                               claim.y, claim.rotation);
+  }
+  if (!reachable) {
+    // search buffers are large, share them per thread instead of per game
+    thread_local MoveGenerator generator;
+    Placement placement;
+    reachable = generator.findPlacement(board_, type, claim.x, claim.y,
+                                        claim.rotation, claim.spin, placement);
+  }
+  if (!reachable) {
+    return result;
+  }
+
+  if (claim.hold) {
+    InputResult held = applyInput(Input::HOLD);
+    if (held.toppedOut) {
+      return held;
+    }
+  }
+
+  active_.setPosition(claim.x, claim.y);
+  active_.setRotation(claim.rotation);
+  lastMoveRotation_ = claim.spin;
+  result.accepted = true;
+  lockActive(result);
+  return result;
+}
+
+bool Game::receiveGarbage(int lines, int holeColumn) {
+  // out of range values make an invalid segment, which tops out as before
+  GarbageSegment segment;
+  segment.lines =
+      static_cast<uint8_t>(lines > 0 && lines <= UINT8_MAX ? lines : 0);
+  segment.holeColumn = static_cast<uint8_t>(
+      holeColumn >= 0 && holeColumn < BOARD_WIDTH ? holeColumn : BOARD_WIDTH);
+  return receiveGarbage(&segment, 1);
+}
+
+bool Game::receiveGarbage(const GarbageSegment *segments, int count) {
+  if (toppedOut_) {
+    return false;
+  }
+
+  if (!board_.addGarbage(segments, count)) {
+    toppedOut_ = true;
+    return false;
+  }
+
+  // push active piece up out of the new garbage
+  while (active_.collides(board_)) {
+    active_.move(0, 1);
+    if (active_.getY() >= BOARD_HEIGHT + BOARD_BUFFER + 3) {
+      toppedOut_ = true;
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t Game::getStateHash() const {
+  return hashGameState(board_, active_, hold_, bag_);
+}
+
+void Game::encodeSnapshot(std::vector<uint8_t> &out,
+                          uint32_t baseVersion) const {
+  BoardEncoder::encodeDelta(board_, baseVersion, out);
+
+  // x and y are offset so they stay non-negative near the walls
+  out.push_back(static_cast<uint8_t>(active_.getType()));
+  out.push_back(static_cast<uint8_t>(active_.getX() + SNAPSHOT_XY_OFFSET));
+  out.push_back(static_cast<uint8_t>(active_.getY() + SNAPSHOT_XY_OFFSET));
+  out.push_back(static_cast<uint8_t>(active_.getRotation()));
+  out.push_back(static_cast<uint8_t>(hold_));
+  out.push_back(static_cast<uint8_t>(
+      (holdUsed_ ? 1 : 0) | (lastMoveRotation_ ? 2 : 0) |
+      (toppedOut_ ? 4 : 0) | (backToBack_ ? 8 : 0)));
+  protocol::writeVarint(out, static_cast<uint64_t>(combo_));
+  protocol::writeVarint(out, piecesPlaced_);
+  protocol::writeVarint(out, linesCleared_);
+  protocol::writeVarint(out, attackSent_);
+  protocol::writeVarint(out, bag_.getPieceCount());
+}
+
+size_t Game::decodeSnapshot(const uint8_t *data, size_t len,
+                            uint32_t &boardVersion) {
+  // everything is parsed into locals, a malformed snapshot changes nothing
+  Board board = board_;
+  uint32_t version = boardVersion;
+  size_t pos = BoardEncoder::decode(data, len, board, version);
+  if (pos == 0 || pos + 6 > len) {
+    return 0;
+  }
+
+  uint8_t type = data[pos];
+  int x = static_cast<int>(data[pos + 1]) - SNAPSHOT_XY_OFFSET;
+  int y = static_cast<int>(data[pos + 2]) - SNAPSHOT_XY_OFFSET;
+  auto rotation = static_cast<Rotation>(data[pos + 3] & 3);
+  uint8_t hold = data[pos + 4];
+  uint8_t flags = data[pos + 5];
+  pos += 6;
+  if (type < CELL_I || type > CELL_L || hold > CELL_L) {
+    return 0;
+  }
+
+  uint64_t combo = 0;
+  uint64_t pieces = 0;
+  uint64_t lines = 0;
+  uint64_t attack = 0;
+  uint64_t bagCount = 0;
+  if (!protocol::readVarint(data, len, pos, combo) ||
+      !protocol::readVarint(data, len, pos, pieces) ||
+      !protocol::readVarint(data, len, pos, lines) ||
+      !protocol::readVarint(data, len, pos, attack) ||
+      !protocol::readVarint(data, len, pos, bagCount)) {
+    return 0;
+  }
+
+  // the bag generates bagCount pieces on restore, so it must stay close to
+  // the pieces placed: the active piece and the first hold are drawn early
+  if (pieces > MAX_SNAPSHOT_PIECES || bagCount > pieces + 2 ||
+      combo > pieces || lines > 4 * pieces || attack > UINT32_MAX) {
+    return 0;
+  }
+
+  board_ = board;
+  boardVersion = version;
+  active_.reset(static_cast<CellType>(type));
+  active_.setPosition(x, y);
+  active_.setRotation(rotation);
+  hold_ = static_cast<CellType>(hold);
+  holdUsed_ = (flags & 1) != 0;
+  lastMoveRotation_ = (flags & 2) != 0;
+  toppedOut_ = (flags & 4) != 0;
+  backToBack_ = (flags & 8) != 0;
+  combo_ = static_cast<int>(combo);
+  piecesPlaced_ = static_cast<uint32_t>(pieces);
+  linesCleared_ = static_cast<uint32_t>(lines);
+  attackSent_ = static_cast<uint32_t>(attack);
+  bag_.setPieceCount(static_cast<uint32_t>(bagCount));
+  return pos;
+}
+
+int Game::computeAttack(int lines, bool spin, int combo, bool backToBack,
+                        bool perfectClear) {
+  // base attack for 0-4 lines, normal and spin clears
+  static const int CLEAR_ATTACK[5] = {0, 0, 1, 2, 4};
+  static const int SPIN_ATTACK[5] = {0, 2, 4, 6, 8};
+  // bonus for consecutive clears
+  static const int COMBO_ATTACK[12] = {0, 0, 1, 1, 1, 2, 2, 3, 3, 4, 4, 4};
+
+  if (lines <= 0) {
+    return 0;
+  }
+  lines = std::min(lines, 4);
+
+  int attack = spin ? SPIN_ATTACK[lines] : CLEAR_ATTACK[lines];
+  if (backToBack && (spin || lines == 4)) {
+    attack += 1;
+  }
+  attack += COMBO_ATTACK[std::min(combo, 11)];
+  if (perfectClear) {
+    attack += 10;
+  }
+  return attack;
+}
+
+void Game::spawnNext() { spawn(static_cast<CellType>(bag_.next())); }
+
+void Game::spawn(CellType type) {
+  active_.reset(type);
+  lastMoveRotation_ = false;
+  if (active_.collides(board_)) {
+    toppedOut_ = true;
+  }
+}
+
+bool Game::tryRotate(Rotation to, bool half180) {
+  CellType type = active_.getType();
+  int x = active_.getX();
+  int y = active_.getY();
+
+  // O piece keeps its cells, so rotating it never kicks or spins
+  if (type == CellType::O) {
+    active_.setRotation(to);
+    return true;
+  }
+
+  if (half180) {
+    for (const KickOffset &kick :
+         Piece::getWallKicks180(type, active_.getRotation())) {
+      if (!Piece::collides(board_, type, to, x + kick.dx, y + kick.dy)) {
+        active_.setPosition(x + kick.dx, y + kick.dy);
+        active_.setRotation(to);
+        lastMoveRotation_ = true;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  for (const KickOffset &kick :
+       Piece::getWallKicks(type, active_.getRotation(), to)) {
+    if (!Piece::collides(board_, type, to, x + kick.dx, y + kick.dy)) {
+      active_.setPosition(x + kick.dx, y + kick.dy);
+      active_.setRotation(to);
+      lastMoveRotation_ = true;
+      return true;
+    }
+  }
+  return false;
+}
+
+void Game::lockActive(InputResult &result) {
+  // spin uses the same immobility rule as the move generator
+  result.spin = lastMoveRotation_ &&
+                MoveGenerator::isImmobile(board_, active_.getType(),
+                                          active_.getRotation(),
+                                          active_.getX(), active_.getY());
+
+  // lock out if the whole piece is above the visible area
+  const Piece::RowMasks &rows =
+      Piece::getRowMasks(active_.getType(), active_.getRotation());
+  int bottomRow = 3;
+  while (bottomRow > 0 && rows[bottomRow] == 0) {
+    --bottomRow;
+  }
+  bool lockOut = active_.getY() - bottomRow >= BOARD_HEIGHT;
+
+  active_.lock(board_);
+  result.locked = true;
+  ++piecesPlaced_;
+
+  result.linesCleared = board_.clearFullRows();
+  linesCleared_ += static_cast<uint32_t>(result.linesCleared);
+
+  if (result.linesCleared > 0) {
+    bool difficult = result.spin || result.linesCleared >= 4;
+    bool perfectClear = board_.getBoardHeight() == 0;
+    result.attack = computeAttack(result.linesCleared, result.spin, combo_,
+                                  backToBack_, perfectClear);
+    attackSent_ += static_cast<uint32_t>(result.attack);
+    backToBack_ = difficult;
+    ++combo_;
+  } else {
+    combo_ = 0;
+  }
+
+  if (lockOut) {
+    toppedOut_ = true;
+  }
+
+  holdUsed_ = false;
+  if (!toppedOut_) {
+    spawnNext();
+  }
+  result.toppedOut = toppedOut_;
+}
+
+} // namespace game
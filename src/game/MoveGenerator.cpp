@@ -0,0 +1,302 @@
+#include "game/MoveGenerator.h"
+
+#include <algorithm>
+
+namespace game {
+
+namespace {
+
+/**
+ * pack search state into index
+ */
+inline uint16_t stateIndex(int x, int y, int rotation, bool rotated,
+                           int xOffset, int stateX, int stateY) {
+  return static_cast<uint16_t>(
+      (((rotation * 2 + (rotated ? 1 : 0)) * stateY + y) * stateX) + x +
+      xOffset);
+}
+
+} // namespace
+
+size_t MoveGenerator::generate(const Board &board, CellType type,
+                               std::vector<Placement> &out) {
+  out.clear();
+  visited_.fill(0);
+  queueTail_ = 0;
+
+  // stamps of a wrapped generation could match stale slots
+  if (++generation_ == 0) {
+    footprintStamps_.fill(0);
+    generation_ = 1;
+  }
+
+  if (type == CellType::EMPTY) {
+    return 0;
+  }
+
+  int spawnX = 0;
+  int spawnY = 0;
+  Piece::getSpawnPosition(type, spawnX, spawnY);
+  if (Piece::collides(board, type, Rotation::R0, spawnX, spawnY)) {
+    return 0;
+  }
+
+  visit(spawnX, spawnY, Rotation::R0, false, NO_PARENT, Input::NONE);
+
+  for (size_t head = 0; head < queueTail_; ++head) {
+    uint16_t state = queue_[head];
+    int x = state % STATE_X - X_OFFSET;
+    int y = (state / STATE_X) % STATE_Y;
+    int combined = state / (STATE_X * STATE_Y);
+    auto rotation = static_cast<Rotation>(combined / 2);
+    bool rotated = (combined % 2) != 0;
+
+    // shifts
+    if (!Piece::collides(board, type, rotation, x - 1, y)) {
+      visit(x - 1, y, rotation, false, state, Input::MOVE_LEFT);
+    }
+    if (!Piece::collides(board, type, rotation, x + 1, y)) {
+      visit(x + 1, y, rotation, false, state, Input::MOVE_RIGHT);
+    }
+
+    // soft drop one row, or lock here if resting
+    if (!Piece::collides(board, type, rotation, x, y - 1)) {
+      visit(x, y - 1, rotation, false, state, Input::SOFT_DROP);
+    } else {
+      bool spin = rotated && isImmobile(board, type, rotation, x, y);
+      uint64_t key = (footprint(type, rotation, x, y) << 1) | (spin ? 1 : 0);
+      if (insertFootprint(key)) {
+        out.push_back(Placement{x, y, rotation, spin, state});
+      }
+    }
+
+    // O piece rotations never change its cells
+    if (type == CellType::O) {
+      continue;
+    }
+
+    // rotations with SRS kicks, first free kick wins
+    const Input rotateInputs[2] = {Input::ROTATE_CW, Input::ROTATE_CCW};
+    const int rotateSteps[2] = {1, 3};
+    for (int i = 0; i < 2; ++i) {
+      auto to = static_cast<Rotation>((static_cast<int>(rotation) +
+                                       rotateSteps[i]) %
+                                      4);
+      for (const KickOffset &kick : Piece::getWallKicks(type, rotation, to)) {
+        if (!Piece::collides(board, type, to, x + kick.dx, y + kick.dy)) {
+          visit(x + kick.dx, y + kick.dy, to, true, state, rotateInputs[i]);
+          break;
+        }
+      }
+    }
+
+    auto to180 = static_cast<Rotation>((static_cast<int>(rotation) + 2) % 4);
+    for (const KickOffset &kick : Piece::getWallKicks180(type, rotation)) {
+      if (!Piece::collides(board, type, to180, x + kick.dx, y + kick.dy)) {
+        visit(x + kick.dx, y + kick.dy, to180, true, state, Input::ROTATE_180);
+        break;
+      }
+    }
+  }
+
+  return out.size();
+}
+
+bool MoveGenerator::buildPath(const Placement &placement,
+                              std::vector<Input> &path) const {
+  path.clear();
+
+  uint16_t state = placement.state;
+  if (state >= STATE_COUNT || (visited_[state / 64] >> (state % 64) & 1) == 0) {
+    return false;
+  }
+
+  // walk parents back to spawn
+  while (parent_[state] != NO_PARENT) {
+    path.push_back(parentInput_[state]);
+    state = parent_[state];
+  }
+  std::reverse(path.begin(), path.end());
+  path.push_back(Input::HARD_DROP);
+  return true;
+}
+
+bool MoveGenerator::findPlacement(const Board &board, CellType type, int x,
+                                  int y, Rotation rotation, bool spin,
+                                  Placement &out) {
+  // claimed position must itself be a resting position
+  if (Piece::collides(board, type, rotation, x, y) ||
+      !Piece::collides(board, type, rotation, x, y - 1)) {
+    return false;
+  }
+
+  generate(board, type, scratch_);
+
+  uint64_t key = footprint(type, rotation, x, y);
+  for (const Placement &placement : scratch_) {
+    if (placement.spin == spin &&
+        footprint(type, placement.rotation, placement.x, placement.y) == key) {
+      out = placement;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool MoveGenerator::isDropReachable(const Board &board, CellType type, int x,
+                                    int y, Rotation rotation) {
+  int spawnX = 0;
+  int spawnY = 0;
+  Piece::getSpawnPosition(type, spawnX, spawnY);
+  if (y > spawnY) {
+    return false;
+  }
+
+  // every SRS kick table tries (0, 0) first, so rotating in place at spawn
+  // only needs the rotated cells to be free
+  if (Piece::collides(board, type, Rotation::R0, spawnX, spawnY) ||
+      Piece::collides(board, type, rotation, spawnX, spawnY)) {
+    return false;
+  }
+
+  // shift along the spawn row
+  int step = (x < spawnX) ? -1 : 1;
+  for (int cx = spawnX; cx != x; cx += step) {
+    if (Piece::collides(board, type, rotation, cx + step, spawnY)) {
+      return false;
+    }
+  }
+
+  // drop straight down
+  for (int cy = spawnY - 1; cy >= y; --cy) {
+    if (Piece::collides(board, type, rotation, x, cy)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool MoveGenerator::isTuckReachable(const Board &board, CellType type, int x,
+                                    int y, Rotation rotation) {
+  // walk the row both ways from x looking for a column dropped into
+  for (int step = -1; step <= 1; step += 2) {
+    for (int cx = x; !Piece::collides(board, type, rotation, cx, y);
+         cx += step) {
+      if (isDropReachable(board, type, cx, y, rotation)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool MoveGenerator::isSpinReachable(const Board &board, CellType type, int x,
+                                    int y, Rotation rotation) {
+  if (type == CellType::O) {
+    return false;
+  }
+
+  // try each rotation into the target: from is where the piece rotated
+  // from, and the kick used must be the first free one from there
+  const int fromSteps[3] = {3, 1, 2}; // CW, CCW and 180 into rotation
+  for (int i = 0; i < 3; ++i) {
+    auto from = static_cast<Rotation>((static_cast<int>(rotation) +
+                                       fromSteps[i]) %
+                                      4);
+    const KickOffset *kicks = nullptr;
+    size_t kickCount = 0;
+    std::array<KickOffset, 5> kicks90{};
+    std::array<KickOffset, KICK_180_COUNT> kicks180{};
+    if (i < 2) {
+      kicks90 = Piece::getWallKicks(type, from, rotation);
+      kicks = kicks90.data();
+      kickCount = kicks90.size();
+    } else {
+      kicks180 = Piece::getWallKicks180(type, from);
+      kicks = kicks180.data();
+      kickCount = kicks180.size();
+    }
+
+    for (size_t k = 0; k < kickCount; ++k) {
+      int fromX = x - kicks[k].dx;
+      int fromY = y - kicks[k].dy;
+      if (Piece::collides(board, type, from, fromX, fromY)) {
+        continue;
+      }
+
+      // earlier kicks must be blocked for this one to be taken
+      bool earlierFree = false;
+      for (size_t e = 0; e < k && !earlierFree; ++e) {
+        earlierFree = !Piece::collides(board, type, rotation,
+                                       fromX + kicks[e].dx,
+                                       fromY + kicks[e].dy);
+      }
+      if (!earlierFree &&
+          isTuckReachable(board, type, fromX, fromY, from)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool MoveGenerator::isImmobile(const Board &board, CellType type,
+                               Rotation rotation, int x, int y) {
+  return Piece::collides(board, type, rotation, x - 1, y) &&
+         Piece::collides(board, type, rotation, x + 1, y) &&
+         Piece::collides(board, type, rotation, x, y + 1);
+}
+
+uint64_t MoveGenerator::footprint(CellType type, Rotation rotation, int x,
+                                  int y) {
+  const Piece::RowMasks &rows = Piece::getRowMasks(type, rotation);
+
+  // skip empty top rows so equal cell sets produce equal keys
+  int first = 0;
+  while (first < 4 && rows[first] == 0) {
+    ++first;
+  }
+
+  // [top row y: 6 bits][4 rows x 10 column bits]
+  uint64_t key = static_cast<uint64_t>((y - first) & 0x3F);
+  for (int row = first; row < 4; ++row) {
+    uint64_t mask = rows[row];
+    mask = (x >= 0) ? (mask << x) : (mask >> -x);
+    key |= (mask & FULL_ROW_MASK) << (6 + (row - first) * BOARD_WIDTH);
+  }
+  return key;
+}
+
+void MoveGenerator::visit(int x, int y, Rotation rotation, bool rotated,
+                          uint16_t parent, Input input) {
+  uint16_t state = stateIndex(x, y, static_cast<int>(rotation), rotated,
+                              X_OFFSET, STATE_X, STATE_Y);
+  uint64_t bit = 1ULL << (state % 64);
+  if (visited_[state / 64] & bit) {
+    return;
+  }
+
+  visited_[state / 64] |= bit;
+  parent_[state] = parent;
+  parentInput_[state] = input;
+  queue_[queueTail_++] = state;
+}
+
+bool MoveGenerator::insertFootprint(uint64_t key) {
+  // linear probing, slots from older generations count as empty. the table
+  // has more slots than there are states, so a free slot always exists
+  size_t slot = static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >>
+                                    (64 - FOOTPRINT_TABLE_BITS));
+  while (footprintStamps_[slot] == generation_) {
+    if (footprintKeys_[slot] == key) {
+      return false;
+    }
+    slot = (slot + 1) & (FOOTPRINT_TABLE_SIZE - 1);
+  }
+
+  footprintStamps_[slot] = generation_;
+  footprintKeys_[slot] = key;
+  return true;
+}
+
+} // namespace game
@@ -229,6 +229,87 @@ const Piece::Shape &Piece::getShape(CellType type, Rotation rotation) {
   return SHAPES[typeIdx][rotIdx];
 }
 
+const Piece::RowMasks &Piece::getRowMasks(CellType type, Rotation rotation) {
+  // build masks once from the shape table
+  static const auto MASKS = [] {
+    std::array<std::array<RowMasks, 4>, 8> masks{};
+    for (int t = 1; t <= 7; ++t) {
+      for (int r = 0; r < 4; ++r) {
+        const Shape &shape =
+            getShape(static_cast<CellType>(t), static_cast<Rotation>(r));
+        for (int row = 0; row < 4; ++row) {
+          for (int col = 0; col < 4; ++col) {
+            if (shape[row][col]) {
+              masks[t][r][row] |= static_cast<uint16_t>(1u << col);
+            }
+          }
+        }
+      }
+    }
+    return masks;
+  }();
+
+  int typeIdx = static_cast<int>(type);
+  if (typeIdx < 0 || typeIdx > 7) {
+    typeIdx = 0;
+  }
+  return MASKS[typeIdx][static_cast<int>(rotation)];
+}
+
+bool Piece::collides(const Board &board, CellType type, Rotation rotation,
+                     int x, int y) {
+  const RowMasks &rows = getRowMasks(type, rotation);
+
+  for (int row = 0; row < 4; ++row) {
+    uint32_t mask = rows[row];
+    if (mask == 0) {
+      continue;
+    }
+
+    // out of the board vertically
+    int by = y - row;
+    if (by < 0 || by >= BOARD_HEIGHT + BOARD_BUFFER) {
+      return true;
+    }
+
+    // shift into board columns, bits falling off either side hit a wall
+    if (x >= 0) {
+      if (x >= BOARD_WIDTH) {
+        return true;
+      }
+      mask <<= x;
+      if (mask & ~static_cast<uint32_t>(FULL_ROW_MASK)) {
+        return true;
+      }
+    } else {
+      if (x <= -4 || (mask & ((1u << -x) - 1))) {
+        return true;
+      }
+      mask >>= -x;
+    }
+
+    if (board.getRowMask(by) & mask) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Piece::lock(Board &board) const {
+  const Shape &shape = getShape();
+  bool inBounds = true;
+
+  for (int row = 0; row < 4; ++row) {
+    for (int col = 0; col < 4; ++col) {
+      if (shape[row][col] &&
+          !board.setCell(x_ + col, y_ - row, static_cast<uint8_t>(type_))) {
+        inBounds = false;
+      }
+    }
+  }
+  return inBounds;
+}
+
 void Piece::getSpawnPosition(CellType type, int &x, int &y) {
   x = 3;
   y = 20;
@@ -0,0 +1,47 @@
+#include "game/PieceSequence.h"
+#include "game/Bag.h"
+#include "game/Board.h"
+
+#include <array>
+#include <chrono>
+
+namespace game {
+
+PieceSequence::PieceSequence(uint64_t seed) {
+  if (seed == 0) {
+    // generate random seed from high-resolution clock
+    seed = static_cast<uint64_t>(
+        std::chrono::high_resolution_clock::now().time_since_epoch().count());
+  }
+  seed_ = seed;
+  rng_.seed(seed_);
+}
+
+void PieceSequence::ensure(uint32_t count) {
+  while (pieces_.size() < static_cast<size_t>(count)) {
+    generateBlock();
+  }
+}
+
+uint8_t PieceSequence::at(uint32_t index) {
+  ensure(index + 1);
+  return pieces_[index];
+}
+
+void PieceSequence::generateBlock() {
+  // create a block with all 7 pieces
+  std::array<uint8_t, PIECE_COUNT> block = {CELL_I, CELL_O, CELL_T, CELL_S,
+                                            CELL_Z, CELL_J, CELL_L};
+
+  // shuffle the block
+  for (int i = PIECE_COUNT - 1; i > 0; --i) {
+    std::uniform_int_distribution<int> dist(0, i);
+    int j = dist(rng_);
+    std::swap(block[static_cast<size_t>(i)], block[static_cast<size_t>(j)]);
+  }
+
+  // append shuffled pieces to sequence
+  pieces_.insert(pieces_.end(), block.begin(), block.end());
+}
+
+} // namespace game
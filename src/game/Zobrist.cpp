@@ -0,0 +1,38 @@
+#include "game/Zobrist.h"
+#include "game/Bag.h"
+#include "game/Piece.h"
+
+namespace game {
+
+namespace {
+
+// salts separating the components folded into the game state hash
+constexpr uint64_t ACTIVE_SALT = zobrist::key(1000);
+constexpr uint64_t HOLD_SALT = zobrist::key(1001);
+constexpr uint64_t QUEUE_SALT = zobrist::key(1002);
+
+} // namespace
+
+uint64_t hashGameState(const Board &board, const Piece &active, CellType hold,
+                       const Bag &bag) {
+  uint64_t hash = board.getHash();
+
+  // active piece: type, rotation and position packed into one word
+  uint64_t activeWord =
+      static_cast<uint64_t>(active.getType()) |
+      (static_cast<uint64_t>(active.getRotation()) << 8) |
+      (static_cast<uint64_t>(static_cast<uint16_t>(active.getX())) << 16) |
+      (static_cast<uint64_t>(static_cast<uint16_t>(active.getY())) << 32);
+  hash ^= zobrist::mix(ACTIVE_SALT ^ activeWord);
+
+  // hold slot
+  hash ^= zobrist::mix(HOLD_SALT ^ static_cast<uint64_t>(hold));
+
+  // queue is fully determined by sequence seed and position in it
+  hash ^= zobrist::mix(QUEUE_SALT ^ bag.getSeed() ^
+                       (static_cast<uint64_t>(bag.getPieceCount()) << 1));
+
+  return hash;
+}
+
+} // namespace game
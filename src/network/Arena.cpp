@@ -0,0 +1,34 @@
+#include "network/Arena.h"
+
+namespace network {
+
+Arena::Arena(size_t blockSize)
+    : block_(new uint8_t[blockSize]), capacity_(blockSize) {}
+
+void *Arena::allocate(size_t bytes, size_t alignment) {
+  uintptr_t base = reinterpret_cast<uintptr_t>(block_.get());
+  uintptr_t start = (base + used_ + alignment - 1) & ~(alignment - 1);
+  if (start + bytes <= base + capacity_) {
+    used_ = start + bytes - base;
+    return reinterpret_cast<void *>(start);
+  }
+
+  // the main block is full, this iteration gets an extra block per request
+  // and the main block grows to fit all of them on reset
+  overflow_.emplace_back(new uint8_t[bytes + alignment]);
+  overflowUsed_ += bytes + alignment;
+  uintptr_t extra = reinterpret_cast<uintptr_t>(overflow_.back().get());
+  return reinterpret_cast<void *>((extra + alignment - 1) & ~(alignment - 1));
+}
+
+void Arena::reset() {
+  if (!overflow_.empty()) {
+    capacity_ += overflowUsed_;
+    block_.reset(new uint8_t[capacity_]);
+    overflow_.clear();
+    overflowUsed_ = 0;
+  }
+  used_ = 0;
+}
+
+} // namespace network
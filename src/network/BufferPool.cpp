@@ -0,0 +1,78 @@
+#include "network/BufferPool.h"
+
+#include <algorithm>
+
+namespace network {
+
+void BufferPool::reserve(std::vector<uint8_t> &buffer, size_t capacity) {
+  if (buffer.capacity() >= capacity) {
+    return;
+  }
+
+  // at least double, so appending stays amortized constant
+  std::vector<uint8_t> grown =
+      acquire(std::max(capacity, buffer.capacity() * 2));
+  grown.assign(buffer.begin(), buffer.end());
+  release(buffer);
+  buffer.swap(grown);
+}
+
+void BufferPool::release(std::vector<uint8_t> &buffer) {
+  size_t capacity = buffer.capacity();
+  if (capacity >= MIN_BUFFER_CLASS_SIZE &&
+      capacity <= MAX_BUFFER_CLASS_SIZE &&
+      pooledBytes_ + capacity <= maxPooledBytes_) {
+    // filed under the largest class it can hold
+    size_t sizeClass = BUFFER_CLASS_COUNT - 1;
+    while (classSize(sizeClass) > capacity) {
+      --sizeClass;
+    }
+    buffer.clear();
+    free_[sizeClass].push_back(std::move(buffer));
+    pooledBytes_ += capacity;
+  }
+
+  // a moved-from vector is empty but may keep storage on some libraries
+  std::vector<uint8_t>().swap(buffer);
+}
+
+std::vector<uint8_t> BufferPool::acquire(size_t capacity) {
+  std::vector<uint8_t> buffer;
+  if (capacity > MAX_BUFFER_CLASS_SIZE) {
+    buffer.reserve(capacity);
+    return buffer;
+  }
+
+  size_t sizeClass = 0;
+  while (classSize(sizeClass) < capacity) {
+    ++sizeClass;
+  }
+  std::vector<std::vector<uint8_t>> &list = free_[sizeClass];
+  if (list.empty()) {
+    buffer.reserve(classSize(sizeClass));
+    return buffer;
+  }
+
+  buffer = std::move(list.back());
+  list.pop_back();
+  pooledBytes_ -= buffer.capacity();
+  lowWater_[sizeClass] = std::min(lowWater_[sizeClass], list.size());
+  return buffer;
+}
+
+size_t BufferPool::trim() {
+  size_t freed = 0;
+  for (size_t sizeClass = 0; sizeClass < BUFFER_CLASS_COUNT; ++sizeClass) {
+    // buffers below the low water mark sat unused the whole period
+    std::vector<std::vector<uint8_t>> &list = free_[sizeClass];
+    for (size_t i = 0; i < lowWater_[sizeClass]; ++i) {
+      freed += list.back().capacity();
+      list.pop_back();
+    }
+    lowWater_[sizeClass] = list.size();
+  }
+  pooledBytes_ -= freed;
+  return freed;
+}
+
+} // namespace network
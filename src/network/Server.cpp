@@ -1,13 +1,18 @@
 #include "network/Server.h"
+#include "audit/AllocationAudit.h"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <cerrno>
 #include <cstring>
 #include <fcntl.h>
 #include <iostream>
+#include <linux/sockios.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
@@ -55,12 +60,13 @@ void Server::stop() {
     return;
   }
 
-  // close all client connections
-  for (auto it = clients_.begin(); it != clients_.end();) {
-    closeClient(it->first);
-    it = clients_.erase(it);
+  // close all client connections, each removes itself from the map
+  while (!clients_.empty()) {
+    closeClient(clients_.begin()->first);
   }
 
+  watches_.clear();
+
   // close epoll file descriptor
   if (state_.epollFd >= 0) {
     close(state_.epollFd);
@@ -242,8 +248,8 @@ bool Server::addClient(int clientFd) {
     return false;
   }
 
-  // initialize client buffer
-  clients_[clientFd] = ClientBuffer{};
+  // initialize client buffer, reusing the node of a closed client
+  clientNodes_.insert(clients_, clientFd).first->second.reset();
 
   return true;
 }
@@ -302,6 +308,16 @@ bool Server::setClientSocketOptions(int clientFd) {
     return false;
   }
 
+  // keep unsent bytes here instead of in the kernel, where lanes can not
+  // reorder them
+  int lowat = static_cast<int>(SEND_LOWAT_BYTES);
+  if (setsockopt(clientFd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat,
+                 sizeof(lowat)) < 0) {
+    std::cerr << "failed to set TCP_NOTSENT_LOWAT: " << strerror(errno)
+              << std::endl;
+    return false;
+  }
+
   return true;
 }
 
@@ -309,8 +325,21 @@ void Server::removeClient(int clientFd) {
   // remove client socket from epoll
   epoll_ctl(state_.epollFd, EPOLL_CTL_DEL, clientFd, nullptr);
 
-  // remove client from clients map
-  clients_.erase(clientFd);
+  auto it = clients_.find(clientFd);
+  if (it == clients_.end()) {
+    return;
+  }
+
+  // release files of unfinished streams
+  ClientBuffer &buf = it->second;
+  for (FileStream &stream : buf.files) {
+    close(stream.fd);
+  }
+
+  // remove client from clients map, its storage is kept for the next one
+  bufferPool_.release(buf.data);
+  buf.reset();
+  clientNodes_.erase(clients_, it);
 }
 
 void Server::handleAccept() {
@@ -394,6 +423,11 @@ void Server::handleRead(int clientFd) {
     if (clientDataCallback_) {
       clientDataCallback_(clientFd, buffer, static_cast<size_t>(n));
     }
+
+    // the callback may have closed the client
+    if (clients_.find(clientFd) == clients_.end()) {
+      return;
+    }
   }
 }
 
@@ -404,15 +438,49 @@ void Server::handleWrite(int clientFd) {
   }
 
   ClientBuffer &buf = it->second;
-  if (buf.empty()) {
+  if (buf.empty() && buf.files.empty() && buf.shared.empty()) {
     disableWriteEvent(clientFd);
     return;
   }
 
-  // send all buffered data using offset-based approach
-  while (!buf.empty()) {
-    ssize_t n = ::send(clientFd, buf.current(), buf.remaining(), MSG_NOSIGNAL);
+  // control data goes first, bulk gets a turn at message boundaries once
+  // control has sent CONTROL_SHARE bytes per bulk byte; a started write,
+  // frame or chunk is always finished so messages stay contiguous
+  while (true) {
+    bool bulkTurn = false;
+    if (buf.controlPending > 0) {
+      bulkTurn = false;
+    } else if (buf.inBulk()) {
+      bulkTurn = true;
+    } else if (buf.empty() || !buf.hasBulk()) {
+      // a lane that has nothing queued builds up no claim
+      buf.bulkCredit = 0;
+      if (buf.empty() && !buf.hasBulk()) {
+        break;
+      }
+      bulkTurn = buf.empty();
+    } else {
+      bulkTurn = buf.bulkCredit > 0;
+    }
+
+    if (bulkTurn) {
+      int result = sendBulk(clientFd, buf);
+      if (result < 0) {
+        closeClient(clientFd);
+        return;
+      }
+      if (result == 0) {
+        break;
+      }
+      continue;
+    }
 
+    // everything queued so far is one write, its end is a message boundary
+    if (buf.controlPending == 0) {
+      buf.controlPending = buf.remaining();
+    }
+    ssize_t n =
+        ::send(clientFd, buf.current(), buf.controlPending, MSG_NOSIGNAL);
     if (n < 0) {
       if (errno == EAGAIN || errno == EWOULDBLOCK) {
         // would block, wait for next epoll write event
@@ -426,19 +494,118 @@ void Server::handleWrite(int clientFd) {
     }
 
     buf.offset += static_cast<size_t>(n);
+    buf.controlPending -= static_cast<size_t>(n);
+    if (buf.hasBulk()) {
+      buf.bulkCredit += n;
+    }
   }
 
-  // compact buffer if all data sent
+  // give the storage back once all data is sent, idle clients hold none
   if (buf.empty()) {
-    buf.data.clear();
+    bufferPool_.release(buf.data);
     buf.offset = 0;
-    disableWriteEvent(clientFd);
+    if (buf.files.empty() && buf.shared.empty()) {
+      disableWriteEvent(clientFd);
+    }
   } else if (buf.offset > 4096) {
     // compact if offset is too large to prevent memory waste
     buf.compact();
   }
 }
 
+int Server::sendBulk(int clientFd, ClientBuffer &buf) {
+  FileStream *stream = buf.files.empty() ? nullptr : &buf.files.front();
+  if (stream != nullptr && stream->inChunk()) {
+    int result = sendFileChunk(clientFd, *stream);
+    if (result == 1 && stream->remaining == 0) {
+      close(stream->fd);
+      buf.files.pop_front();
+    } else if (result == 1 && buf.files.size() > 1) {
+      // round robin between downloads on the same connection
+      buf.files.push_back(std::move(buf.files.front()));
+      buf.files.pop_front();
+    }
+    return result;
+  }
+
+  // frames go before new chunks, they are small and paced by their sender
+  if (!buf.shared.empty()) {
+    SharedFrame &frame = buf.shared.front();
+    if (frame.offset == 0) {
+      buf.bulkCredit -=
+          static_cast<int64_t>(frame.bytes->size()) * CONTROL_SHARE;
+    }
+    ssize_t n = ::send(clientFd, frame.bytes->data() + frame.offset,
+                       frame.bytes->size() - frame.offset, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return 0;
+      }
+      std::cerr << "error writing to client " << clientFd << ": "
+                << strerror(errno) << std::endl;
+      return -1;
+    }
+
+    frame.offset += static_cast<size_t>(n);
+    if (frame.offset == frame.bytes->size()) {
+      buf.shared.pop_front();
+    }
+    return 1;
+  }
+
+  // start next chunk of the front stream
+  size_t chunkLen = static_cast<size_t>(
+      std::min<uint64_t>(stream->remaining, FILE_CHUNK_SIZE));
+  stream->headerLen = stream->framer(chunkLen, stream->header.data());
+  stream->headerSent = 0;
+  stream->chunkRemaining = chunkLen;
+  stream->remaining -= chunkLen;
+  buf.bulkCredit -=
+      static_cast<int64_t>(stream->headerLen + chunkLen) * CONTROL_SHARE;
+  return 1;
+}
+
+int Server::sendFileChunk(int clientFd, FileStream &stream) {
+  // header first, hinting that file bytes follow
+  while (stream.headerSent < stream.headerLen) {
+    ssize_t n = ::send(clientFd, stream.header.data() + stream.headerSent,
+                       stream.headerLen - stream.headerSent,
+                       MSG_NOSIGNAL | MSG_MORE);
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return 0;
+      }
+      std::cerr << "error writing to client " << clientFd << ": "
+                << strerror(errno) << std::endl;
+      return -1;
+    }
+    stream.headerSent += static_cast<size_t>(n);
+  }
+
+  // file bytes go from page cache to the socket without a user copy
+  while (stream.chunkRemaining > 0) {
+    off_t offset = static_cast<off_t>(stream.offset);
+    ssize_t n = ::sendfile(clientFd, stream.fd, &offset, stream.chunkRemaining);
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return 0;
+      }
+      std::cerr << "error sending file to client " << clientFd << ": "
+                << strerror(errno) << std::endl;
+      return -1;
+    }
+    if (n == 0) {
+      // file shrank under the stream, the chunk can not be completed
+      std::cerr << "file ended early while streaming to client " << clientFd
+                << std::endl;
+      return -1;
+    }
+    stream.offset += static_cast<uint64_t>(n);
+    stream.chunkRemaining -= static_cast<size_t>(n);
+  }
+  return 1;
+}
+
 void Server::closeClient(int clientFd) {
   // call disconnect callback before removing
   if (clientDisconnectCallback_) {
@@ -457,20 +624,150 @@ bool Server::send(int clientFd, const uint8_t *data, size_t len) {
     return false;
   }
 
-  // append data to client buffer
-  it->second.append(data, len);
+  // append data to client buffer, storage comes from the pool
+  ClientBuffer &buf = it->second;
+  bufferPool_.reserve(buf.data, buf.data.size() + len);
+  buf.append(data, len);
 
   // enable write event to trigger EPOLLOUT
   return enableWriteEvent(clientFd);
 }
 
+bool Server::addWatch(int fd, WatchCallback callback) {
+  if (state_.epollFd < 0 || fd < 0) {
+    return false;
+  }
+
+  // level-triggered, callback drains fd
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.fd = fd;
+
+  if (epoll_ctl(state_.epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+    std::cerr << "failed to add watch fd " << fd << ": " << strerror(errno)
+              << std::endl;
+    return false;
+  }
+
+  watches_[fd] = std::move(callback);
+  return true;
+}
+
+void Server::removeWatch(int fd) {
+  if (watches_.erase(fd) > 0 && state_.epollFd >= 0) {
+    epoll_ctl(state_.epollFd, EPOLL_CTL_DEL, fd, nullptr);
+  }
+}
+
+bool Server::sendFile(int clientFd, int fileFd, uint64_t offset,
+                      uint64_t length, FileStream::Framer framer) {
+  auto it = clients_.find(clientFd);
+  if (it == clients_.end() || !framer) {
+    return false;
+  }
+
+  // own a duplicate so the caller may close its descriptor at any time
+  int fd = dup(fileFd);
+  if (fd < 0) {
+    std::cerr << "failed to duplicate file for client " << clientFd << ": "
+              << strerror(errno) << std::endl;
+    return false;
+  }
+
+  FileStream stream;
+  stream.fd = fd;
+  stream.offset = offset;
+  stream.remaining = length;
+  stream.framer = std::move(framer);
+  it->second.files.push_back(std::move(stream));
+  it->second.bulkUsed = true;
+
+  return enableWriteEvent(clientFd);
+}
+
+bool Server::sendShared(int clientFd,
+                        std::shared_ptr<const std::vector<uint8_t>> frame) {
+  auto it = clients_.find(clientFd);
+  if (it == clients_.end() || !frame || frame->empty()) {
+    return false;
+  }
+
+  // bulk lane, in order with other shared frames of the client
+  SharedFrame shared;
+  shared.bytes = std::move(frame);
+  it->second.shared.push_back(std::move(shared));
+  it->second.bulkUsed = true;
+
+  return enableWriteEvent(clientFd);
+}
+
+size_t Server::getSharedBacklog(int clientFd) const {
+  auto it = clients_.find(clientFd);
+  return it == clients_.end() ? 0 : it->second.shared.size();
+}
+
+bool Server::getSendQueueInfo(int clientFd, SendQueueInfo &info) const {
+  auto it = clients_.find(clientFd);
+  if (it == clients_.end()) {
+    return false;
+  }
+
+  const ClientBuffer &buffer = it->second;
+  info.bufferedBytes = buffer.remaining();
+  for (const SharedFrame &frame : buffer.shared) {
+    info.bufferedBytes += frame.bytes->size() - frame.offset;
+  }
+
+  // bytes the kernel holds but has not put on the wire yet
+  int unsent = 0;
+  info.kernelUnsent = ioctl(clientFd, SIOCOUTQNSD, &unsent) == 0
+                          ? static_cast<uint32_t>(std::max(unsent, 0))
+                          : 0;
+
+  struct tcp_info tcpInfo {};
+  socklen_t len = sizeof(tcpInfo);
+  if (getsockopt(clientFd, IPPROTO_TCP, TCP_INFO, &tcpInfo, &len) == 0) {
+    info.kernelRttUs = tcpInfo.tcpi_rtt;
+    info.retransmits = tcpInfo.tcpi_total_retrans;
+  } else {
+    info.kernelRttUs = 0;
+    info.retransmits = 0;
+  }
+  return true;
+}
+
+bool Server::disconnect(int clientFd) {
+  if (clients_.find(clientFd) == clients_.end()) {
+    return false;
+  }
+  closeClient(clientFd);
+  return true;
+}
+
 void Server::broadcast(const uint8_t *data, size_t len) {
   for (auto &[clientFd, buffer] : clients_) {
+    bufferPool_.reserve(buffer.data, buffer.data.size() + len);
     buffer.append(data, len);
     enableWriteEvent(clientFd);
   }
 }
 
+size_t Server::reclaimIdleBuffers() {
+  size_t reclaimed = 0;
+  for (auto &[clientFd, buffer] : clients_) {
+    // spectators use their lane every frame and keep it
+    if (!buffer.bulkUsed && !buffer.hasBulk() &&
+        buffer.shared.capacity() + buffer.files.capacity() > 0) {
+      buffer.shared.release();
+      buffer.files.release();
+      ++reclaimed;
+    }
+    buffer.bulkUsed = false;
+  }
+  bufferPool_.trim();
+  return reclaimed;
+}
+
 std::vector<int> Server::getClientFds() const {
   std::vector<int> fds;
   fds.reserve(clients_.size());
@@ -480,6 +777,15 @@ std::vector<int> Server::getClientFds() const {
   return fds;
 }
 
+Span<const int> Server::getClientFds(Arena &arena) const {
+  Span<int> fds = arena.allocateArray<int>(clients_.size());
+  size_t i = 0;
+  for (const auto &[fd, buffer] : clients_) {
+    fds[i++] = fd;
+  }
+  return {fds.data, fds.size};
+}
+
 void Server::runEventLoop() {
   if (!state_.running) {
     std::cerr << "server is not running" << std::endl;
@@ -524,11 +830,20 @@ void Server::runEventLoop() {
           return;
         }
         if (eventFlags & EPOLLIN) {
+          audit::PhaseScope phase(audit::Phase::ACCEPT);
           handleAccept();
         }
         continue;
       }
 
+      // handle watched fd
+      auto watch = watches_.find(fd);
+      if (watch != watches_.end()) {
+        audit::PhaseScope phase(audit::Phase::TIMERS);
+        watch->second();
+        continue;
+      }
+
       // skip if client already removed (by previous event in same batch)
       if (clients_.find(fd) == clients_.end()) {
         continue;
@@ -536,12 +851,14 @@ void Server::runEventLoop() {
 
       // check for client errors
       if (eventFlags & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+        audit::PhaseScope phase(audit::Phase::READ);
         closeClient(fd);
         continue;
       }
 
       // handle client read event
       if (eventFlags & EPOLLIN) {
+        audit::PhaseScope phase(audit::Phase::READ);
         handleRead(fd);
         // check if client still exists after read
         if (clients_.find(fd) == clients_.end()) {
@@ -551,9 +868,14 @@ void Server::runEventLoop() {
 
       // handle client write event
       if (eventFlags & EPOLLOUT) {
+        audit::PhaseScope phase(audit::Phase::WRITE);
         handleWrite(fd);
       }
     }
+
+    // nothing allocated from the arena outlives the iteration
+    arena_.reset();
+    audit::endIteration();
   }
 
   std::cout << "epoll event loop stopped" << std::endl;
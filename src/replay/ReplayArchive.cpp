@@ -0,0 +1,419 @@
+#include "replay/ReplayArchive.h"
+#include "protocol/Codec.h"
+#include "replay/ReplayReader.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace replay {
+
+namespace {
+
+/**
+ * write a whole buffer, retrying on short writes
+ * @return true if everything was written
+ */
+bool writeAll(int fd, const uint8_t *data, size_t len) {
+  while (len > 0) {
+    ssize_t n = ::write(fd, data, len);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += n;
+    len -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+void encodeEntry(const ArchiveIndexEntry &entry, std::vector<uint8_t> &out) {
+  protocol::writeLE(out, entry.gameId, 8);
+  protocol::writeLE(out, entry.offset, 8);
+  protocol::writeLE(out, entry.replayLength, 4);
+  protocol::writeLE(out, entry.keyframeLength, 4);
+  protocol::writeLE(out, entry.startedAtMs, 8);
+  protocol::writeLE(out, entry.roomId, 4);
+  protocol::writeLE(out, entry.keyframeCount, 4);
+}
+
+void decodeEntry(const uint8_t *data, ArchiveIndexEntry &entry) {
+  entry.gameId = protocol::readLE(data, 8);
+  entry.offset = protocol::readLE(data + 8, 8);
+  entry.replayLength = static_cast<uint32_t>(protocol::readLE(data + 16, 4));
+  entry.keyframeLength = static_cast<uint32_t>(protocol::readLE(data + 20, 4));
+  entry.startedAtMs = protocol::readLE(data + 24, 8);
+  entry.roomId = static_cast<uint32_t>(protocol::readLE(data + 32, 4));
+  entry.keyframeCount = static_cast<uint32_t>(protocol::readLE(data + 36, 4));
+}
+
+} // namespace
+
+ArchiveWriter::ArchiveWriter(const std::string &directory,
+                             uint32_t keyframeInterval)
+    : directory_(directory),
+      keyframeInterval_(keyframeInterval > 0 ? keyframeInterval : 1) {}
+
+ArchiveWriter::~ArchiveWriter() { close(); }
+
+bool ArchiveWriter::open() {
+  if (mkdir(directory_.c_str(), 0755) < 0 && errno != EEXIST) {
+    std::cerr << "failed to create archive directory " << directory_ << ": "
+              << std::strerror(errno) << std::endl;
+    return false;
+  }
+
+  std::string segmentPath = directory_ + "/" + ARCHIVE_SEGMENT_FILE;
+  std::string indexPath = directory_ + "/" + ARCHIVE_INDEX_FILE;
+  segmentFd_ = ::open(segmentPath.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+  indexFd_ = ::open(indexPath.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (segmentFd_ < 0 || indexFd_ < 0) {
+    std::cerr << "failed to open archive " << directory_ << ": "
+              << std::strerror(errno) << std::endl;
+    close();
+    return false;
+  }
+
+  struct stat segmentStat;
+  struct stat indexStat;
+  if (fstat(segmentFd_, &segmentStat) < 0 || fstat(indexFd_, &indexStat) < 0) {
+    close();
+    return false;
+  }
+
+  // keep whole index entries whose data made it into the segment
+  uint64_t count =
+      static_cast<uint64_t>(indexStat.st_size) / ARCHIVE_INDEX_ENTRY_SIZE;
+  uint64_t end = 0;
+  while (count > 0) {
+    uint8_t raw[ARCHIVE_INDEX_ENTRY_SIZE];
+    off_t pos = static_cast<off_t>((count - 1) * ARCHIVE_INDEX_ENTRY_SIZE);
+    if (pread(indexFd_, raw, sizeof(raw), pos) !=
+        static_cast<ssize_t>(sizeof(raw))) {
+      close();
+      return false;
+    }
+    ArchiveIndexEntry entry;
+    decodeEntry(raw, entry);
+    end = entry.offset + entry.replayLength + entry.keyframeLength;
+    if (end <= static_cast<uint64_t>(segmentStat.st_size)) {
+      break;
+    }
+    --count;
+    end = 0;
+  }
+
+  // drop bytes of a torn append
+  if (ftruncate(indexFd_,
+                static_cast<off_t>(count * ARCHIVE_INDEX_ENTRY_SIZE)) < 0 ||
+      ftruncate(segmentFd_, static_cast<off_t>(end)) < 0) {
+    std::cerr << "failed to recover archive " << directory_ << ": "
+              << std::strerror(errno) << std::endl;
+    close();
+    return false;
+  }
+
+  segmentSize_ = end;
+  nextGameId_ = count + 1;
+  return true;
+}
+
+void ArchiveWriter::close() {
+  if (segmentFd_ >= 0) {
+    ::close(segmentFd_);
+    segmentFd_ = -1;
+  }
+  if (indexFd_ >= 0) {
+    ::close(indexFd_);
+    indexFd_ = -1;
+  }
+}
+
+uint64_t ArchiveWriter::append(const uint8_t *data, size_t len) {
+  if (segmentFd_ < 0) {
+    return 0;
+  }
+
+  ReplayReader reader(data, len);
+  ReplayHeader header;
+  if (!reader.readHeader(header)) {
+    std::cerr << "refusing to archive malformed replay" << std::endl;
+    return 0;
+  }
+
+  keyframes_.clear();
+  uint32_t keyframeCount =
+      buildKeyframes(data, len, keyframeInterval_, keyframes_);
+
+  ArchiveIndexEntry entry;
+  entry.gameId = nextGameId_;
+  entry.offset = segmentSize_;
+  entry.replayLength = static_cast<uint32_t>(len);
+  entry.keyframeLength = static_cast<uint32_t>(keyframes_.size());
+  entry.startedAtMs = header.startedAtMs;
+  entry.roomId = header.roomId;
+  entry.keyframeCount = keyframeCount;
+
+  std::vector<uint8_t> rawEntry;
+  rawEntry.reserve(ARCHIVE_INDEX_ENTRY_SIZE);
+  encodeEntry(entry, rawEntry);
+
+  // segment first, so an index entry never points past written data
+  if (!writeAll(segmentFd_, data, len) ||
+      !writeAll(segmentFd_, keyframes_.data(), keyframes_.size()) ||
+      !writeAll(indexFd_, rawEntry.data(), rawEntry.size())) {
+    std::cerr << "failed to append to archive " << directory_ << ": "
+              << std::strerror(errno) << std::endl;
+    return 0;
+  }
+
+  segmentSize_ += len + keyframes_.size();
+  return nextGameId_++;
+}
+
+uint32_t ArchiveWriter::buildKeyframes(const uint8_t *data, size_t len,
+                                       uint32_t interval,
+                                       std::vector<uint8_t> &out) {
+  ReplayReader reader(data, len);
+  ReplayHeader header;
+  if (!reader.readHeader(header)) {
+    protocol::writeLE(out, 0, 4);
+    return 0;
+  }
+
+  ReplaySimulator simulator;
+  simulator.reset(header);
+
+  // table entries and snapshots are built apart, then joined
+  std::vector<uint8_t> table;
+  std::vector<uint8_t> snapshots;
+  uint32_t count = 0;
+  uint64_t nextPieces = interval;
+  ReplayRecord record;
+  while (reader.next(record)) {
+    if (!simulator.apply(record)) {
+      break;
+    }
+
+    uint64_t pieces = 0;
+    for (size_t i = 0; i < simulator.getSlotCount(); ++i) {
+      pieces += simulator.getGame(i).getPiecesPlaced();
+    }
+    if (pieces < nextPieces) {
+      continue;
+    }
+    nextPieces = pieces + interval;
+
+    protocol::writeLE(table, record.timeMs, 8);
+    protocol::writeLE(table, reader.getOffset(), 4);
+    protocol::writeLE(table, snapshots.size(), 4);
+    protocol::writeLE(table, simulator.getFrameCount(), 8);
+    for (uint64_t slotTime : reader.getSlotTimes()) {
+      protocol::writeVarint(snapshots, slotTime);
+    }
+    for (size_t i = 0; i < simulator.getSlotCount(); ++i) {
+      simulator.getGame(i).encodeSnapshot(snapshots);
+    }
+    ++count;
+  }
+
+  // snapshot offsets are relative to the block start
+  size_t snapshotBase = 4 + table.size();
+  for (uint32_t i = 0; i < count; ++i) {
+    uint8_t *field = table.data() + i * KEYFRAME_ENTRY_SIZE + 12;
+    uint64_t offset = protocol::readLE(field, 4) + snapshotBase;
+    for (int b = 0; b < 4; ++b) {
+      field[b] = static_cast<uint8_t>(offset >> (8 * b));
+    }
+  }
+
+  protocol::writeLE(out, count, 4);
+  out.insert(out.end(), table.begin(), table.end());
+  out.insert(out.end(), snapshots.begin(), snapshots.end());
+  return count;
+}
+
+ArchiveReader::~ArchiveReader() { close(); }
+
+bool ArchiveReader::open(const std::string &directory) {
+  close();
+  std::string segmentPath = directory + "/" + ARCHIVE_SEGMENT_FILE;
+  std::string indexPath = directory + "/" + ARCHIVE_INDEX_FILE;
+  segmentFd_ = ::open(segmentPath.c_str(), O_RDONLY);
+  indexFd_ = ::open(indexPath.c_str(), O_RDONLY);
+  if (segmentFd_ < 0 || indexFd_ < 0) {
+    close();
+    return false;
+  }
+  return refresh();
+}
+
+void ArchiveReader::close() {
+  if (segment_ != nullptr) {
+    munmap(const_cast<uint8_t *>(segment_), segmentSize_);
+    segment_ = nullptr;
+  }
+  if (index_ != nullptr) {
+    munmap(const_cast<uint8_t *>(index_), indexSize_);
+    index_ = nullptr;
+  }
+  segmentSize_ = 0;
+  indexSize_ = 0;
+  if (segmentFd_ >= 0) {
+    ::close(segmentFd_);
+    segmentFd_ = -1;
+  }
+  if (indexFd_ >= 0) {
+    ::close(indexFd_);
+    indexFd_ = -1;
+  }
+}
+
+bool ArchiveReader::refresh() {
+  if (segmentFd_ < 0 || indexFd_ < 0) {
+    return false;
+  }
+  // map the segment first, so every mapped index entry has its data
+  return mapFile(segmentFd_, segment_, segmentSize_) &&
+         mapFile(indexFd_, index_, indexSize_);
+}
+
+bool ArchiveReader::getEntry(size_t position, ArchiveIndexEntry &entry) const {
+  if (position >= getGameCount()) {
+    return false;
+  }
+  decodeEntry(index_ + position * ARCHIVE_INDEX_ENTRY_SIZE, entry);
+  return entry.offset + entry.replayLength + entry.keyframeLength <=
+         segmentSize_;
+}
+
+bool ArchiveReader::findGame(uint64_t gameId, ArchiveIndexEntry &entry) const {
+  // IDs are assigned in append order, so the index is sorted by ID
+  size_t lo = 0;
+  size_t hi = getGameCount();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    uint64_t id = protocol::readLE(index_ + mid * ARCHIVE_INDEX_ENTRY_SIZE, 8);
+    if (id < gameId) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo < getGameCount() &&
+      protocol::readLE(index_ + lo * ARCHIVE_INDEX_ENTRY_SIZE, 8) == gameId) {
+    return getEntry(lo, entry);
+  }
+  return false;
+}
+
+const uint8_t *ArchiveReader::getReplay(const ArchiveIndexEntry &entry) const {
+  if (segment_ == nullptr ||
+      entry.offset + entry.replayLength > segmentSize_) {
+    return nullptr;
+  }
+  return segment_ + entry.offset;
+}
+
+bool ArchiveReader::seek(const ArchiveIndexEntry &entry, uint64_t timeMs,
+                         ReplaySimulator &simulator) const {
+  const uint8_t *replayData = getReplay(entry);
+  if (replayData == nullptr) {
+    return false;
+  }
+  const uint8_t *block = replayData + entry.replayLength;
+  size_t blockLen = entry.keyframeLength;
+
+  ReplayReader reader(replayData, entry.replayLength);
+  ReplayHeader header;
+  if (!reader.readHeader(header)) {
+    return false;
+  }
+  simulator.reset(header);
+
+  // last keyframe at or before the requested time
+  uint32_t count = 0;
+  if (blockLen >= 4) {
+    count = static_cast<uint32_t>(protocol::readLE(block, 4));
+  }
+  if (4 + static_cast<size_t>(count) * KEYFRAME_ENTRY_SIZE > blockLen) {
+    return false;
+  }
+  const uint8_t *table = block + 4;
+  uint32_t lo = 0;
+  uint32_t hi = count;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (protocol::readLE(table + mid * KEYFRAME_ENTRY_SIZE, 8) <= timeMs) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  if (lo > 0) {
+    const uint8_t *keyframe = table + (lo - 1) * KEYFRAME_ENTRY_SIZE;
+    size_t recordOffset = protocol::readLE(keyframe + 8, 4);
+    size_t pos = protocol::readLE(keyframe + 12, 4);
+    uint64_t frames = protocol::readLE(keyframe + 16, 8);
+    if (recordOffset > entry.replayLength || pos > blockLen) {
+      return false;
+    }
+
+    std::vector<uint64_t> slotTimes(header.playerIds.size());
+    for (uint64_t &slotTime : slotTimes) {
+      if (!protocol::readVarint(block, blockLen, pos, slotTime)) {
+        return false;
+      }
+    }
+    if (!simulator.restore(block + pos, blockLen - pos, frames)) {
+      return false;
+    }
+    reader.seek(recordOffset, slotTimes);
+  }
+
+  // bounded re-simulation from the keyframe
+  ReplayRecord record;
+  while (reader.next(record) && record.timeMs <= timeMs) {
+    simulator.apply(record);
+  }
+  return !reader.hasError();
+}
+
+bool ArchiveReader::mapFile(int fd, const uint8_t *&data, size_t &size) {
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    return false;
+  }
+  size_t newSize = static_cast<size_t>(st.st_size);
+  if (data != nullptr && newSize == size) {
+    return true;
+  }
+
+  if (data != nullptr) {
+    munmap(const_cast<uint8_t *>(data), size);
+    data = nullptr;
+    size = 0;
+  }
+  if (newSize == 0) {
+    return true;
+  }
+
+  void *mapped = mmap(nullptr, newSize, PROT_READ, MAP_SHARED, fd, 0);
+  if (mapped == MAP_FAILED) {
+    std::cerr << "failed to map archive: " << std::strerror(errno)
+              << std::endl;
+    return false;
+  }
+  data = static_cast<const uint8_t *>(mapped);
+  size = newSize;
+  return true;
+}
+
+} // namespace replay
@@ -0,0 +1,154 @@
+#include "replay/ReplayReader.h"
+#include "protocol/Codec.h"
+#include "protocol/Message.h"
+
+#include <cstring>
+
+namespace replay {
+
+ReplayReader::ReplayReader(const uint8_t *data, size_t len)
+    : data_(data), len_(len) {}
+
+bool ReplayReader::readHeader(ReplayHeader &header) {
+  // magic, version, seed, room ID, start time
+  constexpr size_t FIXED_SIZE = 4 + 1 + 8 + 4 + 8;
+  pos_ = 0;
+  if (len_ < FIXED_SIZE || std::memcmp(data_, REPLAY_MAGIC, 4) != 0 ||
+      data_[4] != REPLAY_VERSION) {
+    error_ = true;
+    return false;
+  }
+  header.seed = protocol::readLE(data_ + 5, 8);
+  header.roomId = static_cast<uint32_t>(protocol::readLE(data_ + 13, 4));
+  header.startedAtMs = protocol::readLE(data_ + 17, 8);
+  pos_ = FIXED_SIZE;
+
+  uint64_t count = 0;
+  if (!protocol::readVarint(data_, len_, pos_, count) || count > 255) {
+    error_ = true;
+    return false;
+  }
+  header.playerIds.resize(count);
+  for (uint32_t &playerId : header.playerIds) {
+    uint64_t id = 0;
+    if (!protocol::readVarint(data_, len_, pos_, id)) {
+      error_ = true;
+      return false;
+    }
+    playerId = static_cast<uint32_t>(id);
+  }
+
+  slotTimesMs_.assign(count, 0);
+  complete_ = false;
+  error_ = false;
+  return true;
+}
+
+bool ReplayReader::next(ReplayRecord &record) {
+  if (complete_ || error_) {
+    return false;
+  }
+
+  uint64_t slot = 0;
+  uint64_t tag = 0;
+  if (!protocol::readVarint(data_, len_, pos_, slot) ||
+      !protocol::readVarint(data_, len_, pos_, tag)) {
+    error_ = true;
+    return false;
+  }
+
+  uint8_t kind = static_cast<uint8_t>(tag & ((1u << RECORD_KIND_BITS) - 1));
+  uint64_t delta = tag >> RECORD_KIND_BITS;
+  record.kind = static_cast<RecordKind>(kind);
+
+  if (kind == static_cast<uint8_t>(RecordKind::END)) {
+    record.slot = 0;
+    record.timeMs = delta; // absolute for the end record
+    complete_ = true;
+    return false;
+  }
+
+  if (slot >= slotTimesMs_.size()) {
+    error_ = true;
+    return false;
+  }
+  record.slot = static_cast<uint32_t>(slot);
+  slotTimesMs_[slot] += delta;
+  record.timeMs = slotTimesMs_[slot];
+
+  if (kind >= static_cast<uint8_t>(RecordKind::INPUT_FIRST) &&
+      kind <= static_cast<uint8_t>(RecordKind::INPUT_LAST)) {
+    record.input = kind;
+    return true;
+  }
+
+  record.input = 0;
+  if (kind == static_cast<uint8_t>(RecordKind::GARBAGE)) {
+    uint64_t lines = 0;
+    uint64_t hole = 0;
+    if (!protocol::readVarint(data_, len_, pos_, lines) ||
+        !protocol::readVarint(data_, len_, pos_, hole)) {
+      error_ = true;
+      return false;
+    }
+    record.lines = static_cast<uint32_t>(lines);
+    record.holeColumn = static_cast<uint32_t>(hole);
+    return true;
+  }
+  if (kind == static_cast<uint8_t>(RecordKind::GARBAGE_BATCH)) {
+    uint64_t count = 0;
+    if (!protocol::readVarint(data_, len_, pos_, count) || count == 0 ||
+        count > game::MAX_GARBAGE_SEGMENTS) {
+      error_ = true;
+      return false;
+    }
+    for (uint64_t i = 0; i < count; ++i) {
+      uint64_t lines = 0;
+      uint64_t hole = 0;
+      if (!protocol::readVarint(data_, len_, pos_, lines) ||
+          !protocol::readVarint(data_, len_, pos_, hole) || lines > UINT8_MAX ||
+          hole > UINT8_MAX) {
+        error_ = true;
+        return false;
+      }
+      record.garbage[i].lines = static_cast<uint8_t>(lines);
+      record.garbage[i].holeColumn = static_cast<uint8_t>(hole);
+    }
+    record.garbageCount = static_cast<uint8_t>(count);
+    return true;
+  }
+  if (kind == static_cast<uint8_t>(RecordKind::FORFEIT)) {
+    return true;
+  }
+  if (kind == static_cast<uint8_t>(RecordKind::PLACEMENT)) {
+    uint64_t x = 0;
+    uint64_t y = 0;
+    uint64_t flags = 0;
+    if (!protocol::readVarint(data_, len_, pos_, x) ||
+        !protocol::readVarint(data_, len_, pos_, y) ||
+        !protocol::readVarint(data_, len_, pos_, flags)) {
+      error_ = true;
+      return false;
+    }
+    record.placement.x = static_cast<int>(x) - PLACEMENT_X_OFFSET;
+    record.placement.y = static_cast<int>(y);
+    record.placement.rotation =
+        static_cast<game::Rotation>(flags & protocol::PLACE_ROTATION_MASK);
+    record.placement.spin = (flags & protocol::PLACE_FLAG_SPIN) != 0;
+    record.placement.hold = (flags & protocol::PLACE_FLAG_HOLD) != 0;
+    return true;
+  }
+
+  error_ = true; // unknown kind
+  return false;
+}
+
+void ReplayReader::seek(size_t offset,
+                        const std::vector<uint64_t> &slotTimesMs) {
+  pos_ = offset;
+  slotTimesMs_ = slotTimesMs;
+  complete_ = false;
+  error_ = false;
+}
+
+} // namespace replay
@@ -0,0 +1,134 @@
+#include "replay/ReplayRecorder.h"
+#include "protocol/Codec.h"
+#include "protocol/Message.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace replay {
+
+ReplayRecorder::ReplayRecorder(ReplayWriter &writer,
+                               const ReplayHeader &header)
+    : writer_(writer),
+      gameKey_(std::to_string(header.startedAtMs) + "-" +
+               std::to_string(header.roomId)),
+      lastTimeMs_(header.playerIds.size(), 0) {
+  buffer_.reserve(FLUSH_THRESHOLD * 2);
+  encodeHeader(header, buffer_);
+}
+
+ReplayRecorder::~ReplayRecorder() {
+  if (!finished_) {
+    uint64_t lastMs = 0;
+    for (uint64_t t : lastTimeMs_) {
+      lastMs = std::max(lastMs, t);
+    }
+    finish(lastMs);
+  }
+}
+
+void ReplayRecorder::recordInput(uint32_t slot, uint64_t timeMs,
+                                 game::Input input) {
+  writeTag(slot, timeMs, static_cast<uint8_t>(input));
+  maybeFlush();
+}
+
+void ReplayRecorder::recordPlacement(uint32_t slot, uint64_t timeMs,
+                                     const game::PlacementClaim &claim) {
+  writeTag(slot, timeMs, static_cast<uint8_t>(RecordKind::PLACEMENT));
+  protocol::writeVarint(buffer_,
+                        static_cast<uint64_t>(claim.x + PLACEMENT_X_OFFSET));
+  protocol::writeVarint(buffer_, static_cast<uint64_t>(claim.y));
+  protocol::writeVarint(
+      buffer_, static_cast<uint64_t>(claim.rotation) |
+                   (claim.spin ? protocol::PLACE_FLAG_SPIN : 0) |
+                   (claim.hold ? protocol::PLACE_FLAG_HOLD : 0));
+  maybeFlush();
+}
+
+void ReplayRecorder::recordGarbage(uint32_t slot, uint64_t timeMs, int lines,
+                                   int holeColumn) {
+  writeTag(slot, timeMs, static_cast<uint8_t>(RecordKind::GARBAGE));
+  protocol::writeVarint(buffer_, static_cast<uint64_t>(lines));
+  protocol::writeVarint(buffer_, static_cast<uint64_t>(holeColumn));
+  maybeFlush();
+}
+
+void ReplayRecorder::recordGarbage(uint32_t slot, uint64_t timeMs,
+                                   const game::GarbageSegment *segments,
+                                   int count) {
+  // a single segment keeps the older, shorter record
+  if (count == 1) {
+    recordGarbage(slot, timeMs, segments[0].lines, segments[0].holeColumn);
+    return;
+  }
+
+  writeTag(slot, timeMs, static_cast<uint8_t>(RecordKind::GARBAGE_BATCH));
+  protocol::writeVarint(buffer_, static_cast<uint64_t>(count));
+  for (int i = 0; i < count; ++i) {
+    protocol::writeVarint(buffer_, segments[i].lines);
+    protocol::writeVarint(buffer_, segments[i].holeColumn);
+  }
+  maybeFlush();
+}
+
+void ReplayRecorder::recordForfeit(uint32_t slot, uint64_t timeMs) {
+  writeTag(slot, timeMs, static_cast<uint8_t>(RecordKind::FORFEIT));
+  maybeFlush();
+}
+
+void ReplayRecorder::finish(uint64_t timeMs) {
+  if (finished_) {
+    return;
+  }
+  // end record carries absolute time since start
+  protocol::writeVarint(buffer_, 0);
+  protocol::writeVarint(buffer_,
+                        (timeMs << RECORD_KIND_BITS) |
+                            static_cast<uint8_t>(RecordKind::END));
+  writer_.submit(gameKey_, copyUnflushed(), true);
+  finished_ = true;
+}
+
+void ReplayRecorder::encodeHeader(const ReplayHeader &header,
+                                  std::vector<uint8_t> &out) {
+  out.insert(out.end(), REPLAY_MAGIC, REPLAY_MAGIC + 4);
+  out.push_back(REPLAY_VERSION);
+  protocol::writeLE(out, header.seed, 8);
+  protocol::writeLE(out, header.roomId, 4);
+  protocol::writeLE(out, header.startedAtMs, 8);
+  protocol::writeVarint(out, header.playerIds.size());
+  for (uint32_t playerId : header.playerIds) {
+    protocol::writeVarint(out, playerId);
+  }
+}
+
+void ReplayRecorder::writeTag(uint32_t slot, uint64_t timeMs, uint8_t kind) {
+  uint64_t &last = lastTimeMs_[slot];
+  // clock never goes backwards within a slot stream
+  uint64_t delta = timeMs > last ? timeMs - last : 0;
+  last += delta;
+  protocol::writeVarint(buffer_, slot);
+  protocol::writeVarint(buffer_, (delta << RECORD_KIND_BITS) | kind);
+}
+
+void ReplayRecorder::maybeFlush() {
+  if (buffer_.size() - flushedBytes_ < FLUSH_THRESHOLD) {
+    return;
+  }
+  writer_.submit(gameKey_, copyUnflushed(), false);
+}
+
+std::vector<uint8_t> ReplayRecorder::copyUnflushed() {
+  std::vector<uint8_t> chunk(
+      buffer_.begin() + static_cast<ptrdiff_t>(flushedBytes_), buffer_.end());
+  flushedBytes_ = buffer_.size();
+  return chunk;
+}
+
+std::vector<uint8_t> ReplayRecorder::takeLog() {
+  flushedBytes_ = 0;
+  return std::move(buffer_);
+}
+
+} // namespace replay
@@ -0,0 +1,102 @@
+#include "replay/ReplaySimulator.h"
+#include "game/PieceSequence.h"
+#include "game/Zobrist.h"
+#include "replay/ReplayReader.h"
+
+namespace replay {
+
+void ReplaySimulator::reset(const ReplayHeader &header) {
+  // players share one sequence, as in the room
+  auto sequence = std::make_shared<game::PieceSequence>(header.seed);
+  games_.clear();
+  games_.reserve(header.playerIds.size());
+  for (size_t i = 0; i < header.playerIds.size(); ++i) {
+    games_.push_back(std::make_unique<game::Game>(sequence));
+  }
+  frames_ = 0;
+}
+
+bool ReplaySimulator::restore(const uint8_t *data, size_t len,
+                              uint64_t frames) {
+  size_t pos = 0;
+  for (auto &game : games_) {
+    size_t used = game->decodeSnapshot(data + pos, len - pos);
+    if (used == 0) {
+      return false;
+    }
+    pos += used;
+  }
+  frames_ = frames;
+  return true;
+}
+
+bool ReplaySimulator::apply(const ReplayRecord &record) {
+  if (record.slot >= games_.size()) {
+    return false;
+  }
+  game::Game &game = *games_[record.slot];
+
+  switch (record.kind) {
+  case RecordKind::GARBAGE:
+    game.receiveGarbage(static_cast<int>(record.lines),
+                        static_cast<int>(record.holeColumn));
+    break;
+  case RecordKind::GARBAGE_BATCH:
+    game.receiveGarbage(record.garbage.data(), record.garbageCount);
+    break;
+  case RecordKind::FORFEIT:
+    game.forfeit();
+    break;
+  case RecordKind::PLACEMENT: {
+    game::PlacementClaim claim = record.placement;
+    claim.pieceIndex = game.getPiecesPlaced();
+    game.applyPlacement(claim);
+    break;
+  }
+  case RecordKind::END:
+    return true;
+  default:
+    game.applyInput(static_cast<game::Input>(record.input));
+    break;
+  }
+  ++frames_;
+  return true;
+}
+
+uint64_t ReplaySimulator::getStateHash() const {
+  uint64_t hash = 0;
+  for (size_t i = 0; i < games_.size(); ++i) {
+    hash ^= game::zobrist::mix(games_[i]->getStateHash() + i);
+  }
+  return hash;
+}
+
+bool ReplaySimulator::run(const uint8_t *data, size_t len,
+                          SimulationResult &result) {
+  ReplayReader reader(data, len);
+  ReplayHeader header;
+  if (!reader.readHeader(header)) {
+    result = SimulationResult();
+    return false;
+  }
+
+  reset(header);
+  ReplayRecord record;
+  while (reader.next(record)) {
+    if (!apply(record)) {
+      break;
+    }
+  }
+
+  result.complete = reader.isComplete();
+  result.frames = frames_;
+  result.durationMs = reader.isComplete() ? record.timeMs : 0;
+  result.slotHashes.resize(games_.size());
+  for (size_t i = 0; i < games_.size(); ++i) {
+    result.slotHashes[i] = games_[i]->getStateHash();
+  }
+  result.finalHash = getStateHash();
+  return result.complete;
+}
+
+} // namespace replay
@@ -0,0 +1,95 @@
+#include "replay/ReplayWriter.h"
+
+#include <iostream>
+#include <unordered_map>
+
+namespace replay {
+
+ReplayWriter::ReplayWriter(const std::string &directory,
+                           uint32_t keyframeInterval)
+    : directory_(directory), archive_(directory, keyframeInterval) {
+  if (!archive_.open()) {
+    std::cerr << "replays will not be archived" << std::endl;
+  }
+  thread_ = std::thread([this]() { run(); });
+}
+
+ReplayWriter::~ReplayWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void ReplayWriter::submit(const std::string &gameKey,
+                          std::vector<uint8_t> &&data, bool last) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(Chunk{gameKey, std::move(data), last});
+  }
+  wake_.notify_one();
+}
+
+void ReplayWriter::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  drained_.wait(lock, [this]() { return queue_.empty() && !busy_; });
+}
+
+uint64_t ReplayWriter::getBytesWritten() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytesWritten_;
+}
+
+void ReplayWriter::run() {
+  // replays of games still running, archived once complete
+  std::unordered_map<std::string, std::vector<uint8_t>> pending;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    wake_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      break; // stopping with nothing left to write
+    }
+
+    Chunk chunk = std::move(queue_.front());
+    queue_.pop_front();
+    busy_ = true;
+    lock.unlock();
+
+    size_t written = 0;
+    auto it = pending.find(chunk.gameKey);
+    if (it == pending.end()) {
+      it = pending.emplace(chunk.gameKey, std::move(chunk.data)).first;
+    } else {
+      it->second.insert(it->second.end(), chunk.data.begin(),
+                        chunk.data.end());
+    }
+    if (chunk.last) {
+      const std::vector<uint8_t> &replay = it->second;
+      if (archive_.append(replay.data(), replay.size()) != 0) {
+        written = replay.size();
+      }
+      pending.erase(it);
+    }
+
+    lock.lock();
+    bytesWritten_ += written;
+    busy_ = false;
+    if (queue_.empty()) {
+      drained_.notify_all();
+    }
+  }
+
+  if (!pending.empty()) {
+    std::cerr << pending.size() << " unfinished replays discarded"
+              << std::endl;
+  }
+  archive_.close();
+  drained_.notify_all();
+}
+
+} // namespace replay
@@ -0,0 +1,217 @@
+#include "replay/VerificationPool.h"
+#include "replay/ReplayReader.h"
+#include "replay/ReplaySimulator.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace replay {
+
+VerificationPool::VerificationPool(size_t threadCount, size_t capacity)
+    : capacity_(std::max<size_t>(capacity, 2)) {
+  notifyFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (notifyFd_ < 0) {
+    std::cerr << "failed to create verification eventfd: " << strerror(errno)
+              << std::endl;
+  }
+
+  // leave cores for the event loop and bots
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency() / 2);
+  }
+  threads_.reserve(threadCount);
+  for (size_t i = 0; i < threadCount; ++i) {
+    threads_.emplace_back([this]() { run(); });
+  }
+}
+
+VerificationPool::~VerificationPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread &thread : threads_) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+
+  if (notifyFd_ >= 0) {
+    close(notifyFd_);
+  }
+}
+
+SubmitStatus VerificationPool::submit(VerificationJob &&job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t depth = ranked_.size() + casual_.size();
+
+    if (job.ranked) {
+      if (depth >= capacity_) {
+        if (casual_.empty()) {
+          ++dropped_;
+          return SubmitStatus::DROPPED;
+        }
+        // ranked games displace the oldest casual game
+        casual_.pop_front();
+        ++dropped_;
+      }
+      ranked_.push_back(std::move(job));
+    } else {
+      if (depth >= capacity_) {
+        ++dropped_;
+        return SubmitStatus::DROPPED;
+      }
+      if (!sampleCasual(depth)) {
+        ++sampledOut_;
+        return SubmitStatus::SAMPLED_OUT;
+      }
+      casual_.push_back(std::move(job));
+    }
+  }
+  wake_.notify_one();
+  return SubmitStatus::QUEUED;
+}
+
+size_t VerificationPool::pollResults(std::vector<VerificationResult> &out) {
+  // drain eventfd counter
+  if (notifyFd_ >= 0) {
+    uint64_t count = 0;
+    ssize_t n = read(notifyFd_, &count, sizeof(count));
+    (void)n;
+  }
+
+  size_t start = out.size();
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (VerificationResult &result : results_) {
+    out.push_back(std::move(result));
+  }
+  results_.clear();
+  return out.size() - start;
+}
+
+size_t VerificationPool::getQueuedCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return ranked_.size() + casual_.size();
+}
+
+uint64_t VerificationPool::getSampledOutCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return sampledOut_;
+}
+
+uint64_t VerificationPool::getDroppedCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dropped_;
+}
+
+VerificationResult VerificationPool::verify(const VerificationJob &job) {
+  VerificationResult result;
+  result.roomId = job.roomId;
+  result.ranked = job.ranked;
+
+  ReplayReader reader(job.replay.data(), job.replay.size());
+  ReplayHeader header;
+  if (!reader.readHeader(header) ||
+      header.playerIds.size() != job.reports.size()) {
+    return result;
+  }
+  result.playerIds = header.playerIds;
+
+  ReplaySimulator simulator;
+  simulator.reset(header);
+
+  // top-out time is the time of the record that ended the slot's game
+  size_t slotCount = header.playerIds.size();
+  std::vector<uint64_t> toppedOutAtMs(slotCount, 0);
+  std::vector<bool> toppedOut(slotCount, false);
+
+  ReplayRecord record;
+  while (reader.next(record)) {
+    if (!simulator.apply(record)) {
+      return result;
+    }
+    size_t slot = record.slot;
+    if (!toppedOut[slot] && simulator.getGame(slot).isToppedOut()) {
+      toppedOut[slot] = true;
+      toppedOutAtMs[slot] = record.timeMs;
+    }
+  }
+  result.decoded = reader.isComplete();
+
+  result.mismatches.assign(slotCount, MISMATCH_NONE);
+  for (size_t slot = 0; slot < slotCount; ++slot) {
+    const game::Game &game = simulator.getGame(slot);
+    const SlotReport &report = job.reports[slot];
+    uint8_t bits = MISMATCH_NONE;
+    if (game.getPiecesPlaced() != report.piecesPlaced) {
+      bits |= MISMATCH_PIECES;
+    }
+    if (game.getLinesCleared() != report.linesCleared) {
+      bits |= MISMATCH_LINES;
+    }
+    if (game.getAttackSent() != report.attackSent) {
+      bits |= MISMATCH_ATTACK;
+    }
+    if (toppedOut[slot] != report.toppedOut ||
+        (report.toppedOut && toppedOutAtMs[slot] != report.toppedOutAtMs)) {
+      bits |= MISMATCH_TOP_OUT;
+    }
+    if (game.getStateHash() != report.stateHash) {
+      bits |= MISMATCH_STATE;
+    }
+    result.mismatches[slot] = bits;
+  }
+  return result;
+}
+
+void VerificationPool::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    wake_.wait(lock, [this]() {
+      return stopping_ || !ranked_.empty() || !casual_.empty();
+    });
+    if (stopping_) {
+      break;
+    }
+
+    // ranked lane first
+    std::deque<VerificationJob> &lane = ranked_.empty() ? casual_ : ranked_;
+    VerificationJob job = std::move(lane.front());
+    lane.pop_front();
+    lock.unlock();
+
+    VerificationResult result = verify(job);
+
+    lock.lock();
+    results_.push_back(std::move(result));
+
+    // wake the event loop
+    if (notifyFd_ >= 0) {
+      uint64_t one = 1;
+      ssize_t n = write(notifyFd_, &one, sizeof(one));
+      (void)n;
+    }
+  }
+}
+
+bool VerificationPool::sampleCasual(size_t depth) {
+  size_t half = capacity_ / 2;
+  if (depth < half) {
+    return true;
+  }
+
+  // keep probability falls linearly from 1 at half to 0 at capacity
+  sampleState_ ^= sampleState_ << 13;
+  sampleState_ ^= sampleState_ >> 7;
+  sampleState_ ^= sampleState_ << 17;
+  uint64_t roll = sampleState_ % (capacity_ - half);
+  return roll >= depth - half;
+}
+
+} // namespace replay
@@ -0,0 +1,218 @@
+#include "room/GarbageLedger.h"
+
+#include <algorithm>
+
+namespace room {
+
+namespace {
+
+/**
+ * clamp a line count to the event field
+ * @param lines line count
+ * @return lines capped to 255
+ */
+uint8_t eventLines(int lines) {
+  return static_cast<uint8_t>(std::min(lines, 255));
+}
+
+} // namespace
+
+GarbageLedger::GarbageLedger(size_t slotCount, uint64_t seed)
+    : pending_(slotCount), pendingLines_(slotCount, 0),
+      strategies_(slotCount, TargetStrategy::RANDOM), danger_(slotCount, 0),
+      lastAttacker_(slotCount, NO_SLOT), lastTarget_(slotCount, NO_SLOT),
+      alivePos_(slotCount), rng_(seed) {
+  alive_.reserve(slotCount);
+  for (size_t slot = 0; slot < slotCount; ++slot) {
+    alivePos_[slot] = alive_.size();
+    alive_.push_back(slot);
+  }
+  attacks_.reserve(slotCount);
+}
+
+void GarbageLedger::addAttack(size_t slot, int lines) {
+  if (lines > 0 && slot < pending_.size()) {
+    attacks_.push_back({slot, lines});
+  }
+}
+
+void GarbageLedger::setStrategy(size_t slot, TargetStrategy strategy) {
+  strategies_[slot] = strategy;
+}
+
+void GarbageLedger::setDanger(size_t slot, int height) {
+  danger_[slot] = height;
+}
+
+void GarbageLedger::markOut(size_t slot) {
+  if (!isAlive(slot)) {
+    return;
+  }
+
+  // swap with the last alive slot so removal stays O(1)
+  size_t pos = alivePos_[slot];
+  size_t last = alive_.back();
+  alive_[pos] = last;
+  alivePos_[last] = pos;
+  alive_.pop_back();
+  alivePos_[slot] = NO_SLOT;
+
+  pending_[slot].clear();
+  pendingLines_[slot] = 0;
+}
+
+void GarbageLedger::resolve(std::vector<GarbageEvent> &events,
+                            std::vector<GarbageDelivery> &deliveries) {
+  ++tick_;
+  deliveries.clear();
+  updateKnockoutTargets();
+
+  // attacks resolve in the order they were made, so an attack queued
+  // earlier in the tick can already be cancelled by its victim
+  for (const Attack &attack : attacks_) {
+    if (!isAlive(attack.slot)) {
+      continue;
+    }
+    int lines = attack.lines;
+
+    std::deque<PendingGarbage> &own = pending_[attack.slot];
+    int cancelled = 0;
+    while (lines > 0 && !own.empty()) {
+      int take = std::min(lines, own.front().lines);
+      own.front().lines -= take;
+      lines -= take;
+      cancelled += take;
+      if (own.front().lines == 0) {
+        own.pop_front();
+      }
+    }
+    if (cancelled > 0) {
+      pendingLines_[attack.slot] -= cancelled;
+      events.push_back({GarbageEventType::CANCELLED,
+                        static_cast<uint8_t>(attack.slot), 0,
+                        eventLines(cancelled)});
+    }
+    if (lines == 0) {
+      continue;
+    }
+
+    size_t target = pickTarget(attack.slot);
+    if (target == NO_SLOT) {
+      continue;
+    }
+    PendingGarbage garbage;
+    garbage.readyTick = tick_ + GARBAGE_DELAY_TICKS;
+    garbage.holeColumn = static_cast<uint8_t>(
+        rng_() % static_cast<uint64_t>(game::BOARD_WIDTH));
+    garbage.lines = lines;
+    pending_[target].push_back(garbage);
+    pendingLines_[target] += lines;
+    lastAttacker_[target] = attack.slot;
+    lastTarget_[attack.slot] = target;
+    events.push_back({GarbageEventType::QUEUED,
+                      static_cast<uint8_t>(attack.slot),
+                      static_cast<uint8_t>(target), eventLines(lines)});
+  }
+  attacks_.clear();
+
+  // land matured garbage, all segments of a victim in one delivery
+  for (size_t slot : alive_) {
+    std::deque<PendingGarbage> &queue = pending_[slot];
+    if (queue.empty() || queue.front().readyTick > tick_) {
+      continue;
+    }
+
+    GarbageDelivery delivery;
+    delivery.slot = slot;
+    int budget = GARBAGE_CAP_PER_TICK;
+    while (budget > 0 && delivery.count < game::MAX_GARBAGE_SEGMENTS &&
+           !queue.empty() && queue.front().readyTick <= tick_) {
+      PendingGarbage &front = queue.front();
+      int take = std::min(budget, front.lines);
+      delivery.segments[static_cast<size_t>(delivery.count++)] = {
+          static_cast<uint8_t>(take), front.holeColumn};
+      front.lines -= take;
+      budget -= take;
+      pendingLines_[slot] -= take;
+      events.push_back({GarbageEventType::APPLIED, static_cast<uint8_t>(slot),
+                        front.holeColumn, eventLines(take)});
+      if (front.lines == 0) {
+        queue.pop_front();
+      }
+    }
+    deliveries.push_back(delivery);
+  }
+}
+
+size_t GarbageLedger::getTarget(size_t slot) const {
+  if (!isAlive(slot)) {
+    return NO_SLOT;
+  }
+
+  size_t target = NO_SLOT;
+  switch (strategies_[slot]) {
+  case TargetStrategy::ATTACKERS:
+    target = lastAttacker_[slot];
+    break;
+  case TargetStrategy::KNOCKOUT:
+    target = (knockoutFirst_ != slot) ? knockoutFirst_ : knockoutSecond_;
+    break;
+  case TargetStrategy::RANDOM:
+    break;
+  }
+  if (target == NO_SLOT || target == slot || !isAlive(target)) {
+    target = lastTarget_[slot];
+  }
+  return (target != NO_SLOT && isAlive(target)) ? target : NO_SLOT;
+}
+
+size_t GarbageLedger::pickTarget(size_t attacker) {
+  switch (strategies_[attacker]) {
+  case TargetStrategy::ATTACKERS: {
+    size_t target = lastAttacker_[attacker];
+    if (target != NO_SLOT && target != attacker && isAlive(target)) {
+      return target;
+    }
+    break;
+  }
+  case TargetStrategy::KNOCKOUT: {
+    size_t target =
+        (knockoutFirst_ != attacker) ? knockoutFirst_ : knockoutSecond_;
+    if (target != NO_SLOT && isAlive(target)) {
+      return target;
+    }
+    break;
+  }
+  case TargetStrategy::RANDOM:
+    break;
+  }
+
+  // uniform over alive slots other than the attacker, which is alive
+  size_t count = alive_.size();
+  if (count < 2) {
+    return NO_SLOT;
+  }
+  size_t target = alive_[rng_() % (count - 1)];
+  return (target == attacker) ? alive_[count - 1] : target;
+}
+
+void GarbageLedger::updateKnockoutTargets() {
+  knockoutFirst_ = NO_SLOT;
+  knockoutSecond_ = NO_SLOT;
+  int firstScore = -1;
+  int secondScore = -1;
+  for (size_t slot : alive_) {
+    int score = danger_[slot] + pendingLines_[slot];
+    if (score > firstScore) {
+      knockoutSecond_ = knockoutFirst_;
+      secondScore = firstScore;
+      knockoutFirst_ = slot;
+      firstScore = score;
+    } else if (score > secondScore) {
+      knockoutSecond_ = slot;
+      secondScore = score;
+    }
+  }
+}
+
+} // namespace room
@@ -0,0 +1,170 @@
+#include "room/Match.h"
+
+namespace room {
+
+Match::Match(const Room &room, replay::ReplayWriter *writer,
+             uint64_t startedAtMs)
+    : roomId_(room.roomId), playerIds_(room.playerIds),
+      out_(room.playerIds.size(), false),
+      outAtMs_(room.playerIds.size(), 0),
+      aliveCount_(room.playerIds.size()),
+      garbage_(room.playerIds.size(), room.getSequenceSeed()) {
+  games_.reserve(playerIds_.size());
+  slotByPlayer_.reserve(playerIds_.size());
+  for (size_t i = 0; i < playerIds_.size(); ++i) {
+    slotByPlayer_[playerIds_[i]] = i;
+    games_.push_back(std::make_unique<game::Game>(room.pieceSequence));
+  }
+
+  if (writer != nullptr) {
+    replay::ReplayHeader header;
+    header.seed = room.getSequenceSeed();
+    header.roomId = roomId_;
+    header.startedAtMs = startedAtMs;
+    header.playerIds = playerIds_;
+    recorder_ = std::make_unique<replay::ReplayRecorder>(*writer, header);
+  }
+}
+
+game::InputResult Match::applyInput(uint32_t playerId, game::Input input,
+                                    uint64_t timeMs) {
+  int slot = getSlot(playerId);
+  if (slot < 0 || out_[static_cast<size_t>(slot)]) {
+    return game::InputResult();
+  }
+  size_t index = static_cast<size_t>(slot);
+
+  game::InputResult result = games_[index]->applyInput(input);
+  if (!result.accepted) {
+    return result; // rejected inputs do not change state, skip recording
+  }
+
+  if (recorder_) {
+    recorder_->recordInput(index, timeMs, input);
+  }
+  onMoveApplied(index, result, timeMs);
+  return result;
+}
+
+game::InputResult Match::applyPlacement(uint32_t playerId,
+                                        const game::PlacementClaim &claim,
+                                        uint64_t timeMs) {
+  int slot = getSlot(playerId);
+  if (slot < 0 || out_[static_cast<size_t>(slot)]) {
+    return game::InputResult();
+  }
+  size_t index = static_cast<size_t>(slot);
+
+  game::InputResult result = games_[index]->applyPlacement(claim);
+  if (!result.accepted) {
+    return result;
+  }
+
+  if (recorder_) {
+    recorder_->recordPlacement(index, timeMs, claim);
+  }
+  onMoveApplied(index, result, timeMs);
+  return result;
+}
+
+bool Match::forfeit(uint32_t playerId, uint64_t timeMs) {
+  int slot = getSlot(playerId);
+  if (slot < 0 || out_[static_cast<size_t>(slot)]) {
+    return false;
+  }
+  size_t index = static_cast<size_t>(slot);
+
+  games_[index]->forfeit();
+  if (recorder_) {
+    recorder_->recordForfeit(index, timeMs);
+  }
+  markOut(index, timeMs);
+  return true;
+}
+
+bool Match::setTargeting(uint32_t playerId, TargetStrategy strategy) {
+  int slot = getSlot(playerId);
+  if (slot < 0 || out_[static_cast<size_t>(slot)] ||
+      static_cast<uint8_t>(strategy) > static_cast<uint8_t>(
+                                            TargetStrategy::KNOCKOUT)) {
+    return false;
+  }
+  garbage_.setStrategy(static_cast<size_t>(slot), strategy);
+  return true;
+}
+
+const std::vector<GarbageEvent> &Match::tick(uint64_t timeMs) {
+  // knockouts between ticks are already in events_, keep them
+  garbage_.resolve(events_, deliveries_);
+
+  for (const GarbageDelivery &delivery : deliveries_) {
+    game::Game &game = *games_[delivery.slot];
+    if (recorder_) {
+      recorder_->recordGarbage(static_cast<uint32_t>(delivery.slot), timeMs,
+                               delivery.segments.data(), delivery.count);
+    }
+    if (game.receiveGarbage(delivery.segments.data(), delivery.count)) {
+      garbage_.setDanger(delivery.slot, game.getBoard().getBoardHeight());
+    } else {
+      markOut(delivery.slot, timeMs);
+    }
+  }
+
+  // hand out this tick's events, the next tick starts a fresh list
+  tickEvents_.swap(events_);
+  events_.clear();
+  return tickEvents_;
+}
+
+void Match::finish(uint64_t timeMs) {
+  if (recorder_) {
+    recorder_->finish(timeMs);
+  }
+}
+
+std::vector<uint8_t> Match::takeReplay() {
+  return recorder_ ? recorder_->takeLog() : std::vector<uint8_t>();
+}
+
+uint32_t Match::getWinner() const {
+  if (aliveCount_ != 1) {
+    return 0;
+  }
+  for (size_t i = 0; i < out_.size(); ++i) {
+    if (!out_[i]) {
+      return playerIds_[i];
+    }
+  }
+  return 0;
+}
+
+int Match::getSlot(uint32_t playerId) const {
+  auto it = slotByPlayer_.find(playerId);
+  return it == slotByPlayer_.end() ? -1 : static_cast<int>(it->second);
+}
+
+void Match::onMoveApplied(size_t slot, const game::InputResult &result,
+                          uint64_t timeMs) {
+  if (result.toppedOut) {
+    markOut(slot, timeMs);
+  } else if (result.locked) {
+    garbage_.addAttack(slot, result.attack);
+    garbage_.setDanger(slot, games_[slot]->getBoard().getBoardHeight());
+  }
+}
+
+void Match::markOut(size_t slot, uint64_t timeMs) {
+  if (!out_[slot]) {
+    out_[slot] = true;
+    outAtMs_[slot] = timeMs;
+    --aliveCount_;
+
+    size_t attacker = garbage_.getLastAttacker(slot);
+    garbage_.markOut(slot);
+    events_.push_back(
+        {GarbageEventType::KNOCKOUT, static_cast<uint8_t>(slot),
+         static_cast<uint8_t>(attacker == NO_SLOT ? slot : attacker), 0});
+  }
+}
+
+} // namespace room
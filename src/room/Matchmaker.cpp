@@ -0,0 +1,201 @@
+#include "room/Matchmaker.h"
+
+#include <algorithm>
+
+namespace room {
+
+Matchmaker::Matchmaker(const MatchmakerConfig &config)
+    : config_(config),
+      ratingBuckets_(MAX_MATCHMAKING_RATING / RATING_BUCKET_WIDTH + 1),
+      buckets_(ratingBuckets_ * LATENCY_TIER_COUNT) {
+  config_.matchSize = std::max<size_t>(config_.matchSize, 2);
+}
+
+uint32_t Matchmaker::join(uint32_t playerId, int rating, uint16_t latencyMs,
+                          uint64_t nowMs) {
+  if (playerId == 0) {
+    return NO_TICKET;
+  }
+
+  uint32_t entry = 0;
+  if (!free_.empty()) {
+    entry = free_.back();
+    free_.pop_back();
+  } else {
+    entry = static_cast<uint32_t>(entries_.size());
+    entries_.emplace_back();
+  }
+
+  Entry &e = entries_[entry];
+  e.playerId = playerId;
+  e.bucket = bucketOf(rating, latencyMs);
+  e.joinedAtMs = nowMs;
+  link(entry);
+  return entry;
+}
+
+bool Matchmaker::leave(uint32_t ticket, uint32_t playerId) {
+  if (!isQueued(ticket, playerId)) {
+    return false;
+  }
+  unlink(ticket);
+  return true;
+}
+
+size_t Matchmaker::formMatches(uint64_t nowMs, size_t maxMatches,
+                               std::vector<uint32_t> &matched) {
+  ++pass_;
+  size_t formed = 0;
+  const int tiers = static_cast<int>(LATENCY_TIER_COUNT);
+  const int ratingBuckets = static_cast<int>(ratingBuckets_);
+
+  // the queue is walked oldest first, entries freed on the way keep their
+  // queue link so the walk can step past them
+  uint32_t current = queueHead_;
+  while (current != NO_ENTRY && formed < maxMatches) {
+    const Entry &anchor = entries_[current];
+    if (anchor.playerId == 0 ||
+        buckets_[anchor.bucket].failedPass == pass_) {
+      current = anchor.queueNext;
+      continue;
+    }
+
+    // window around the anchor, wider the longer it waited
+    uint64_t waited =
+        nowMs > anchor.joinedAtMs ? (nowMs - anchor.joinedAtMs) / 1000 : 0;
+    int window = static_cast<int>(std::min<uint64_t>(
+        static_cast<uint64_t>(config_.ratingWindow) +
+            static_cast<uint64_t>(config_.ratingWidenPerSecond) * waited,
+        static_cast<uint64_t>(config_.maxRatingWindow)));
+    int radius = (window + RATING_BUCKET_WIDTH - 1) / RATING_BUCKET_WIDTH;
+    int spread = config_.latencyWidenSeconds == 0
+                     ? tiers - 1
+                     : static_cast<int>(std::min<uint64_t>(
+                           waited / config_.latencyWidenSeconds,
+                           static_cast<uint64_t>(tiers - 1)));
+    int tier = static_cast<int>(anchor.bucket / ratingBuckets_);
+    int rating = static_cast<int>(anchor.bucket % ratingBuckets_);
+    int tierLow = std::max(tier - spread, 0);
+    int tierHigh = std::min(tier + spread, tiers - 1);
+    int ratingLow = std::max(rating - radius, 0);
+    int ratingHigh = std::min(rating + radius, ratingBuckets - 1);
+
+    // count before taking anyone, so a failed anchor changes nothing
+    size_t available = 0;
+    for (int t = tierLow; t <= tierHigh && available < config_.matchSize;
+         ++t) {
+      for (int r = ratingLow; r <= ratingHigh; ++r) {
+        available += bucketAt(t, r).count;
+      }
+    }
+    if (available < config_.matchSize) {
+      buckets_[anchor.bucket].failedPass = pass_;
+      current = anchor.queueNext;
+      continue;
+    }
+
+    // the anchor plus the oldest players of the nearest buckets
+    size_t needed = config_.matchSize - 1;
+    matched.push_back(anchor.playerId);
+    unlink(current);
+    for (int d = 0; d <= radius && needed > 0; ++d) {
+      for (int side = 0; side < (d == 0 ? 1 : 2) && needed > 0; ++side) {
+        int r = (side == 0) ? rating - d : rating + d;
+        if (r < ratingLow || r > ratingHigh) {
+          continue;
+        }
+        for (int dt = 0; dt <= spread && needed > 0; ++dt) {
+          for (int tSide = 0; tSide < (dt == 0 ? 1 : 2) && needed > 0;
+               ++tSide) {
+            int t = (tSide == 0) ? tier - dt : tier + dt;
+            if (t < tierLow || t > tierHigh) {
+              continue;
+            }
+            Bucket &bucket = bucketAt(t, r);
+            while (bucket.count > 0 && needed > 0) {
+              uint32_t partner = bucket.head;
+              matched.push_back(entries_[partner].playerId);
+              unlink(partner);
+              --needed;
+            }
+          }
+        }
+      }
+    }
+
+    ++formed;
+    current = entries_[current].queueNext;
+  }
+  return formed;
+}
+
+uint32_t Matchmaker::bucketOf(int rating, uint16_t latencyMs) const {
+  size_t tier = 0;
+  while (tier < LATENCY_TIER_COUNT - 1 &&
+         latencyMs >= LATENCY_TIER_LIMITS_MS[tier]) {
+    ++tier;
+  }
+  int clamped = std::clamp(rating, 0, MAX_MATCHMAKING_RATING);
+  return static_cast<uint32_t>(
+      tier * ratingBuckets_ +
+      static_cast<size_t>(clamped / RATING_BUCKET_WIDTH));
+}
+
+void Matchmaker::link(uint32_t entry) {
+  Entry &e = entries_[entry];
+  Bucket &bucket = buckets_[e.bucket];
+
+  e.prev = bucket.tail;
+  e.next = NO_ENTRY;
+  if (bucket.tail != NO_ENTRY) {
+    entries_[bucket.tail].next = entry;
+  } else {
+    bucket.head = entry;
+  }
+  bucket.tail = entry;
+  ++bucket.count;
+
+  e.queuePrev = queueTail_;
+  e.queueNext = NO_ENTRY;
+  if (queueTail_ != NO_ENTRY) {
+    entries_[queueTail_].queueNext = entry;
+  } else {
+    queueHead_ = entry;
+  }
+  queueTail_ = entry;
+  ++queuedCount_;
+}
+
+void Matchmaker::unlink(uint32_t entry) {
+  Entry &e = entries_[entry];
+  Bucket &bucket = buckets_[e.bucket];
+
+  if (e.prev != NO_ENTRY) {
+    entries_[e.prev].next = e.next;
+  } else {
+    bucket.head = e.next;
+  }
+  if (e.next != NO_ENTRY) {
+    entries_[e.next].prev = e.prev;
+  } else {
+    bucket.tail = e.prev;
+  }
+  --bucket.count;
+
+  if (e.queuePrev != NO_ENTRY) {
+    entries_[e.queuePrev].queueNext = e.queueNext;
+  } else {
+    queueHead_ = e.queueNext;
+  }
+  if (e.queueNext != NO_ENTRY) {
+    entries_[e.queueNext].queuePrev = e.queuePrev;
+  } else {
+    queueTail_ = e.queuePrev;
+  }
+
+  e.playerId = 0;
+  free_.push_back(entry);
+  --queuedCount_;
+}
+
+} // namespace room
@@ -27,6 +27,9 @@ uint32_t RoomManager::createRoom(const std::string &roomName,
   // create new room
   Room room(roomId, roomName, hostPlayerId);
 
+  // a spectator that starts playing stops watching
+  stopSpectating(hostPlayerId);
+
   // store room and player mapping
   rooms_[roomId] = std::move(room);
   playerToRoom_[hostPlayerId] = roomId;
@@ -42,6 +45,45 @@ uint32_t RoomManager::createRoom(const std::string &roomName,
   return roomId;
 }
 
+uint32_t RoomManager::createMatchRoom(const uint32_t *playerIds,
+                                      size_t count) {
+  if (isMaxRoomsReached() || count == 0 || count > MAX_ROOM_PLAYERS) {
+    std::cerr << "no room for a match of " << count << " players"
+              << std::endl;
+    return 0;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (playerToRoom_.find(playerIds[i]) != playerToRoom_.end()) {
+      std::cerr << "player " << playerIds[i] << " is already in a room"
+                << std::endl;
+      return 0;
+    }
+  }
+
+  // matched games count for rating
+  uint32_t roomId = generateRoomId();
+  Room room(roomId, "match", playerIds[0]);
+  room.ranked = true;
+  for (size_t i = 1; i < count; ++i) {
+    room.addPlayer(playerIds[i]);
+  }
+
+  rooms_[roomId] = std::move(room);
+  for (size_t i = 0; i < count; ++i) {
+    stopSpectating(playerIds[i]);
+    playerToRoom_[playerIds[i]] = roomId;
+  }
+
+  std::cout << "match room created: roomId=" << roomId
+            << ", players=" << count << std::endl;
+
+  if (roomCreatedCallback_) {
+    roomCreatedCallback_(roomId);
+  }
+
+  return roomId;
+}
+
 bool RoomManager::removeRoom(uint32_t roomId) {
   auto it = rooms_.find(roomId);
   if (it == rooms_.end()) {
@@ -52,6 +94,9 @@ bool RoomManager::removeRoom(uint32_t roomId) {
   for (uint32_t playerId : it->second.playerIds) {
     playerToRoom_.erase(playerId);
   }
+  for (uint32_t playerId : it->second.spectatorIds) {
+    spectatorToRoom_.erase(playerId);
+  }
 
   // remove room
   rooms_.erase(it);
@@ -134,7 +179,8 @@ bool RoomManager::joinRoom(uint32_t roomId, uint32_t playerId) {
     return false;
   }
 
-  // update player mapping
+  // update player mapping, a spectator that starts playing stops watching
+  stopSpectating(playerId);
   playerToRoom_[playerId] = roomId;
 
   std::cout << "player " << playerId << " joined room " << roomId << std::endl;
@@ -183,6 +229,58 @@ bool RoomManager::leaveRoom(uint32_t playerId) {
   return true;
 }
 
+bool RoomManager::spectateRoom(uint32_t roomId, uint32_t playerId) {
+  // players watch their own room through their own updates
+  if (playerToRoom_.find(playerId) != playerToRoom_.end()) {
+    std::cerr << "player " << playerId << " is in a room, cannot spectate"
+              << std::endl;
+    return false;
+  }
+
+  Room *room = getRoom(roomId);
+  if (room == nullptr) {
+    std::cerr << "room " << roomId << " not found" << std::endl;
+    return false;
+  }
+
+  // watching another room replaces the current one
+  if (getSpectatedRoomId(playerId) == roomId) {
+    return true;
+  }
+  stopSpectating(playerId);
+
+  if (!room->addSpectator(playerId)) {
+    return false;
+  }
+  spectatorToRoom_[playerId] = roomId;
+
+  std::cout << "player " << playerId << " spectating room " << roomId
+            << std::endl;
+  return true;
+}
+
+bool RoomManager::stopSpectating(uint32_t playerId) {
+  auto it = spectatorToRoom_.find(playerId);
+  if (it == spectatorToRoom_.end()) {
+    return false;
+  }
+
+  Room *room = getRoom(it->second);
+  if (room != nullptr) {
+    room->removeSpectator(playerId);
+  }
+  spectatorToRoom_.erase(it);
+  return true;
+}
+
+uint32_t RoomManager::getSpectatedRoomId(uint32_t playerId) const {
+  auto it = spectatorToRoom_.find(playerId);
+  if (it == spectatorToRoom_.end()) {
+    return 0;
+  }
+  return it->second;
+}
+
 bool RoomManager::startGame(uint32_t roomId, uint32_t playerId) {
   Room *room = getRoom(roomId);
   if (room == nullptr) {
@@ -253,6 +351,35 @@ std::vector<uint32_t> RoomManager::getWaitingRoomIds() const {
   return roomIds;
 }
 
+network::Span<const uint32_t>
+RoomManager::getAllRoomIds(network::Arena &arena) const {
+  network::Span<uint32_t> roomIds =
+      arena.allocateArray<uint32_t>(rooms_.size());
+  size_t i = 0;
+  for (const auto &[roomId, room] : rooms_) {
+    roomIds[i++] = roomId;
+  }
+  return {roomIds.data, roomIds.size};
+}
+
+network::Span<const uint32_t>
+RoomManager::getWaitingRoomIds(network::Arena &arena) const {
+  // count first, the arena can not grow an array in place
+  size_t count = 0;
+  for (const auto &[roomId, room] : rooms_) {
+    count += room.isWaiting() ? 1 : 0;
+  }
+
+  network::Span<uint32_t> roomIds = arena.allocateArray<uint32_t>(count);
+  size_t i = 0;
+  for (const auto &[roomId, room] : rooms_) {
+    if (room.isWaiting()) {
+      roomIds[i++] = roomId;
+    }
+  }
+  return {roomIds.data, roomIds.size};
+}
+
 uint32_t RoomManager::generateRoomId() {
   // simple incrementing ID
   return nextRoomId_++;
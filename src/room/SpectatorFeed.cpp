@@ -0,0 +1,133 @@
+#include "room/SpectatorFeed.h"
+#include "game/BoardEncoder.h"
+#include "protocol/Codec.h"
+#include "protocol/Message.h"
+#include "room/Match.h"
+
+#include <algorithm>
+
+namespace room {
+
+SpectatorFeed::SpectatorFeed(size_t slotCount)
+    : slotCount_(slotCount), history_(slotCount * SPECTATOR_HISTORY) {
+  frames_.reserve(SPECTATOR_HISTORY + 1);
+  buffers_.reserve(SPECTATOR_FRAME_BUFFERS);
+}
+
+bool SpectatorFeed::hasChanges(const Match &match) const {
+  const SlotState *latest = statesOf(version_);
+  for (size_t slot = 0; slot < slotCount_; ++slot) {
+    if (latest[slot].boardVersion !=
+            match.getGame(slot).getBoard().getVersion() ||
+        latest[slot].pending != match.getGarbage().getPendingLines(slot) ||
+        latest[slot].out != match.isOut(slot)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void SpectatorFeed::publish(const Match &match) {
+  ++version_;
+  tick_ = match.getGarbage().getTick();
+  alive_ = static_cast<uint8_t>(match.getAliveCount());
+  frames_.clear();
+
+  // the slot overwritten is the frame that just fell out of the history
+  SlotState *states = &history_[(version_ % SPECTATOR_HISTORY) * slotCount_];
+  for (size_t slot = 0; slot < slotCount_; ++slot) {
+    states[slot].boardVersion = match.getGame(slot).getBoard().getVersion();
+    states[slot].pending = match.getGarbage().getPendingLines(slot);
+    states[slot].out = match.isOut(slot);
+  }
+}
+
+SpectatorFeed::Frame SpectatorFeed::getFrame(const Match &match,
+                                             uint32_t baseVersion) {
+  if (version_ == 0) {
+    return nullptr;
+  }
+
+  // bases the history no longer covers share the keyframe
+  if (baseVersion >= version_ ||
+      version_ - baseVersion >= SPECTATOR_HISTORY) {
+    baseVersion = 0;
+  }
+  for (const auto &[base, frame] : frames_) {
+    if (base == baseVersion) {
+      return frame;
+    }
+  }
+
+  std::shared_ptr<std::vector<uint8_t>> frame = takeBuffer();
+  beginFrame(baseVersion, *frame);
+  size_t boardCountOffset = frame->size();
+  frame->push_back(0);
+  uint8_t boards = 0;
+  const SlotState *latest = statesOf(version_);
+  const SlotState *base = baseVersion == 0 ? nullptr : statesOf(baseVersion);
+  for (size_t slot = 0; slot < slotCount_; ++slot) {
+    if (base != nullptr &&
+        base[slot].boardVersion == latest[slot].boardVersion &&
+        base[slot].pending == latest[slot].pending &&
+        base[slot].out == latest[slot].out) {
+      continue;
+    }
+    appendSlot(match, slot, base == nullptr ? 0 : base[slot].boardVersion,
+               *frame);
+    ++boards;
+  }
+  (*frame)[boardCountOffset] = boards;
+  endFrame(*frame);
+
+  frames_.emplace_back(baseVersion, frame);
+  return frame;
+}
+
+std::shared_ptr<std::vector<uint8_t>> SpectatorFeed::takeBuffer() {
+  for (const auto &buffer : buffers_) {
+    if (buffer.use_count() == 1) {
+      return buffer;
+    }
+  }
+
+  auto buffer = std::make_shared<std::vector<uint8_t>>();
+  if (buffers_.size() < SPECTATOR_FRAME_BUFFERS) {
+    buffers_.push_back(buffer);
+  }
+  return buffer;
+}
+
+void SpectatorFeed::appendSlot(const Match &match, size_t slot,
+                               uint32_t baseVersion,
+                               std::vector<uint8_t> &out) const {
+  const game::Board &board = match.getGame(slot).getBoard();
+  int pending = match.getGarbage().getPendingLines(slot);
+  out.push_back(static_cast<uint8_t>(slot));
+  out.push_back(match.isOut(slot) ? 1 : 0);
+  out.push_back(static_cast<uint8_t>(std::min(pending, 255)));
+  if (baseVersion == 0) {
+    game::BoardEncoder::encodeKeyframe(board, out);
+  } else {
+    game::BoardEncoder::encodeDelta(board, baseVersion, out);
+  }
+}
+
+void SpectatorFeed::beginFrame(uint32_t baseVersion,
+                               std::vector<uint8_t> &out) const {
+  out.clear();
+  out.resize(protocol::HEADER_SIZE);
+  protocol::writeLE(out, version_, 4);
+  protocol::writeLE(out, baseVersion, 4);
+  protocol::writeLE(out, tick_, 4);
+  out.push_back(alive_);
+}
+
+void SpectatorFeed::endFrame(std::vector<uint8_t> &out) {
+  size_t payloadLen = out.size() - protocol::HEADER_SIZE;
+  out[0] = static_cast<uint8_t>(payloadLen);
+  out[1] = static_cast<uint8_t>(payloadLen >> 8);
+  out[2] = static_cast<uint8_t>(protocol::MessageType::SPECTATOR_FRAME);
+}
+
+} // namespace room
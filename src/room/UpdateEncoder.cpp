@@ -0,0 +1,296 @@
+#include "room/UpdateEncoder.h"
+#include "game/BoardEncoder.h"
+#include "protocol/Codec.h"
+#include "protocol/Message.h"
+#include "room/Match.h"
+
+#include <algorithm>
+
+namespace room {
+
+namespace {
+
+/**
+ * append one garbage event in wire format
+ * @param out output buffer
+ * @param event garbage event
+ */
+void appendEvent(std::vector<uint8_t> &out, const GarbageEvent &event) {
+  out.push_back(static_cast<uint8_t>(event.type));
+  out.push_back(event.slot);
+  out.push_back(event.arg);
+  out.push_back(event.lines);
+}
+
+/**
+ * call a visitor with every slot an event concerns, knockouts excluded
+ * @param event garbage event
+ * @param visit visitor taking a slot
+ */
+template <typename Visit>
+void forEachConcerned(const GarbageEvent &event, Visit &&visit) {
+  visit(event.slot);
+  if (event.type == GarbageEventType::QUEUED) {
+    visit(event.arg);
+  }
+}
+
+/**
+ * check if a slot is in a small list
+ * @param list slots
+ * @param slot slot to find
+ * @return true if found
+ */
+bool contains(const std::vector<size_t> &list, size_t slot) {
+  return std::find(list.begin(), list.end(), slot) != list.end();
+}
+
+} // namespace
+
+UpdateEncoder::UpdateEncoder(size_t slotCount)
+    : slotCount_(slotCount), eventStart_(slotCount + 1, 0),
+      eventFill_(slotCount, 0), interest_(slotCount),
+      previousInterest_(slotCount), previousVersions_(slotCount, 0),
+      currentVersions_(slotCount, 0),
+      sentVersions_(slotCount * slotCount, UNKNOWN_VERSION),
+      deltaOffsets_(slotCount, 0), deltaLengths_(slotCount, 0),
+      keyframeOffsets_(slotCount, 0), keyframeLengths_(slotCount, 0),
+      summaryVersions_(slotCount, UNKNOWN_VERSION),
+      summaryPending_(slotCount, 0), summaryOut_(slotCount, false) {
+  for (size_t slot = 0; slot < slotCount; ++slot) {
+    interest_[slot].reserve(MAX_FULL_BOARDS);
+    previousInterest_[slot].reserve(MAX_FULL_BOARDS);
+  }
+}
+
+void UpdateEncoder::beginTick(const Match &match,
+                              const std::vector<GarbageEvent> &events) {
+  match_ = &match;
+  events_ = &events;
+
+  // board versions move on every tick, whether anything is sent or not
+  for (size_t slot = 0; slot < slotCount_; ++slot) {
+    previousVersions_[slot] = currentVersions_[slot];
+    currentVersions_[slot] = match.getGame(slot).getBoard().getVersion();
+    deltaLengths_[slot] = 0;
+    keyframeLengths_[slot] = 0;
+  }
+  boardPool_.clear();
+
+  // group own events by slot with a counting sort, O(events + players)
+  std::fill(eventStart_.begin(), eventStart_.end(), 0);
+  int queuedLines = 0;
+  for (const GarbageEvent &event : events) {
+    if (event.type == GarbageEventType::KNOCKOUT) {
+      continue; // everyone gets knockouts
+    }
+    if (event.type == GarbageEventType::QUEUED) {
+      queuedLines += event.lines;
+    }
+    forEachConcerned(event, [&](uint8_t slot) { ++eventStart_[slot + 1]; });
+  }
+  for (size_t slot = 0; slot < slotCount_; ++slot) {
+    eventStart_[slot + 1] += eventStart_[slot];
+    eventFill_[slot] = eventStart_[slot];
+  }
+  eventOrder_.resize(eventStart_[slotCount_]);
+  for (uint32_t i = 0; i < events.size(); ++i) {
+    if (events[i].type != GarbageEventType::KNOCKOUT) {
+      forEachConcerned(events[i], [&](uint8_t slot) {
+        eventOrder_[eventFill_[slot]++] = i;
+      });
+    }
+  }
+
+  // header and aggregate
+  const GarbageLedger &garbage = match.getGarbage();
+  shared_.clear();
+  protocol::writeLE(shared_, garbage.getTick(), 4);
+  shared_.push_back(static_cast<uint8_t>(match.getAliveCount()));
+  protocol::writeLE(shared_, static_cast<uint64_t>(queuedLines), 2);
+
+  // summaries of boards that changed since their last summary, taken
+  // round robin so every board gets its turn
+  size_t summaryCountOffset = shared_.size();
+  shared_.push_back(0);
+  summaryCount_ = 0;
+  for (size_t scanned = 0;
+       scanned < slotCount_ && summaryCount_ < MAX_SUMMARIES_PER_TICK;
+       ++scanned) {
+    size_t slot = summaryCursor_;
+    summaryCursor_ = (summaryCursor_ + 1) % slotCount_;
+
+    int pending = garbage.getPendingLines(slot);
+    bool out = match.isOut(slot);
+    if (summaryVersions_[slot] == currentVersions_[slot] &&
+        summaryPending_[slot] == pending && summaryOut_[slot] == out) {
+      continue;
+    }
+    summaryVersions_[slot] = currentVersions_[slot];
+    summaryPending_[slot] = pending;
+    summaryOut_[slot] = out;
+
+    const game::Board &board = match.getGame(slot).getBoard();
+    shared_.push_back(static_cast<uint8_t>(slot));
+    shared_.push_back(out ? 1 : 0);
+    shared_.push_back(static_cast<uint8_t>(std::min(pending, 255)));
+    for (int x = 0; x < game::BOARD_WIDTH; ++x) {
+      shared_.push_back(static_cast<uint8_t>(board.getColumnHeight(x)));
+    }
+    ++summaryCount_;
+  }
+  shared_[summaryCountOffset] = static_cast<uint8_t>(summaryCount_);
+
+  // event count is patched per player, knockouts follow it
+  countOffset_ = shared_.size();
+  protocol::writeLE(shared_, 0, 2);
+  knockouts_ = 0;
+  for (const GarbageEvent &event : events) {
+    if (event.type == GarbageEventType::KNOCKOUT) {
+      appendEvent(shared_, event);
+      ++knockouts_;
+    }
+  }
+
+  updateInterest();
+}
+
+bool UpdateEncoder::encodeFor(size_t slot, std::vector<uint8_t> &frame,
+                              bool boardsDue) {
+  uint32_t ownEvents = eventStart_[slot + 1] - eventStart_[slot];
+  size_t eventCount = knockouts_ + ownEvents;
+
+  frame.clear();
+  frame.resize(protocol::HEADER_SIZE);
+  frame.insert(frame.end(), shared_.begin(), shared_.end());
+  frame[protocol::HEADER_SIZE + countOffset_] =
+      static_cast<uint8_t>(eventCount);
+  frame[protocol::HEADER_SIZE + countOffset_ + 1] =
+      static_cast<uint8_t>(eventCount >> 8);
+  for (uint32_t i = eventStart_[slot]; i < eventStart_[slot + 1]; ++i) {
+    appendEvent(frame, (*events_)[eventOrder_[i]]);
+  }
+
+  // full boards of the interest set the player is not up to date with
+  size_t boardCountOffset = frame.size();
+  frame.push_back(0);
+  uint8_t boards = 0;
+  for (size_t opponent : interest_[slot]) {
+    uint32_t &sent = sentVersions_[slot * slotCount_ + opponent];
+    if (!boardsDue || sent == currentVersions_[opponent]) {
+      continue;
+    }
+    frame.push_back(static_cast<uint8_t>(opponent));
+    appendBoard(opponent, sent, frame);
+    sent = currentVersions_[opponent];
+    ++boards;
+  }
+  frame[boardCountOffset] = boards;
+
+  if (eventCount == 0 && summaryCount_ == 0 && boards == 0) {
+    return false;
+  }
+
+  size_t payloadLen = frame.size() - protocol::HEADER_SIZE;
+  frame[0] = static_cast<uint8_t>(payloadLen);
+  frame[1] = static_cast<uint8_t>(payloadLen >> 8);
+  frame[2] = static_cast<uint8_t>(protocol::MessageType::TICK_UPDATE);
+  return true;
+}
+
+void UpdateEncoder::forgetSent(size_t slot) {
+  if (slot >= slotCount_) {
+    return;
+  }
+  size_t begin = slot * slotCount_;
+  std::fill(sentVersions_.begin() + static_cast<ptrdiff_t>(begin),
+            sentVersions_.begin() + static_cast<ptrdiff_t>(begin + slotCount_),
+            UNKNOWN_VERSION);
+}
+
+void UpdateEncoder::restoreSent(size_t slot, size_t opponent,
+                                uint32_t version) {
+  if (slot >= slotCount_ || opponent >= slotCount_ || opponent == slot ||
+      version > currentVersions_[opponent]) {
+    return;
+  }
+  sentVersions_[slot * slotCount_ + opponent] = version;
+}
+
+void UpdateEncoder::updateInterest() {
+  const GarbageLedger &garbage = match_->getGarbage();
+  interest_.swap(previousInterest_);
+  for (std::vector<size_t> &interest : interest_) {
+    interest.clear();
+  }
+
+  // small rooms see every board in full
+  if (slotCount_ <= MAX_FULL_BOARDS + 1) {
+    for (size_t slot = 0; slot < slotCount_; ++slot) {
+      for (size_t opponent = 0; opponent < slotCount_; ++opponent) {
+        if (opponent != slot) {
+          interest_[slot].push_back(opponent);
+        }
+      }
+    }
+    return;
+  }
+
+  // own target first, then whoever is aiming at the player
+  for (size_t slot = 0; slot < slotCount_; ++slot) {
+    size_t target = garbage.getTarget(slot);
+    if (target != NO_SLOT) {
+      interest_[slot].push_back(target);
+    }
+  }
+  for (size_t slot = 0; slot < slotCount_; ++slot) {
+    size_t target = garbage.getTarget(slot);
+    if (target == NO_SLOT) {
+      continue;
+    }
+    std::vector<size_t> &interest = interest_[target];
+    if (interest.size() < MAX_FULL_BOARDS && !contains(interest, slot)) {
+      interest.push_back(slot);
+    }
+  }
+
+  // players forget boards that leave their set, a keyframe brings them back
+  for (size_t slot = 0; slot < slotCount_; ++slot) {
+    for (size_t opponent : previousInterest_[slot]) {
+      if (!contains(interest_[slot], opponent)) {
+        sentVersions_[slot * slotCount_ + opponent] = UNKNOWN_VERSION;
+      }
+    }
+  }
+}
+
+void UpdateEncoder::appendBoard(size_t opponent, uint32_t sent,
+                                std::vector<uint8_t> &out) {
+  const game::Board &board = match_->getGame(opponent).getBoard();
+
+  // a player that skipped ticks gets one delta over all of them
+  bool keyframe = sent == UNKNOWN_VERSION;
+  if (!keyframe && sent != previousVersions_[opponent]) {
+    game::BoardEncoder::encodeDelta(board, sent, out);
+    return;
+  }
+
+  std::vector<size_t> &offsets = keyframe ? keyframeOffsets_ : deltaOffsets_;
+  std::vector<size_t> &lengths = keyframe ? keyframeLengths_ : deltaLengths_;
+  if (lengths[opponent] == 0) {
+    offsets[opponent] = boardPool_.size();
+    if (keyframe) {
+      game::BoardEncoder::encodeKeyframe(board, boardPool_);
+    } else {
+      game::BoardEncoder::encodeDelta(board, previousVersions_[opponent],
+                                      boardPool_);
+    }
+    lengths[opponent] = boardPool_.size() - offsets[opponent];
+  }
+
+  auto begin = boardPool_.begin() + static_cast<ptrdiff_t>(offsets[opponent]);
+  out.insert(out.end(), begin,
+             begin + static_cast<ptrdiff_t>(lengths[opponent]));
+}
+
+} // namespace room
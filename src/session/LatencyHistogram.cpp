@@ -0,0 +1,62 @@
+#include "session/LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace session {
+
+void LatencyHistogram::record(uint64_t rttNs) {
+  ++buckets_[bucketOf(rttNs / 1000)];
+  ++count_;
+}
+
+uint64_t LatencyHistogram::getPercentileNs(double fraction) const {
+  if (count_ == 0) {
+    return 0;
+  }
+
+  // rank of the sample, 1-based, then the bucket that reaches it
+  double clamped = std::min(std::max(fraction, 0.0), 1.0);
+  uint64_t rank = static_cast<uint64_t>(
+      std::ceil(clamped * static_cast<double>(count_)));
+  rank = std::max<uint64_t>(rank, 1);
+  uint64_t seen = 0;
+  for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+    seen += buckets_[bucket];
+    if (seen >= rank) {
+      return lowerBound(bucket) * 1000;
+    }
+  }
+  return lowerBound(BUCKET_COUNT - 1) * 1000;
+}
+
+void LatencyHistogram::clear() {
+  buckets_.fill(0);
+  count_ = 0;
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t micros) {
+  constexpr uint64_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+  if (micros < SUB_BUCKETS) {
+    return static_cast<size_t>(micros);
+  }
+
+  // top SUB_BUCKET_BITS + 1 bits select the bucket within the magnitude
+  int msb = 63 - __builtin_clzll(micros);
+  int shift = msb - SUB_BUCKET_BITS;
+  size_t bucket = static_cast<size_t>(shift) * SUB_BUCKETS +
+                  static_cast<size_t>(micros >> shift);
+  return std::min(bucket, BUCKET_COUNT - 1);
+}
+
+uint64_t LatencyHistogram::lowerBound(size_t bucket) {
+  constexpr size_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+  if (bucket < 2 * SUB_BUCKETS) {
+    return bucket;
+  }
+  size_t shift = bucket / SUB_BUCKETS - 1;
+  uint64_t top = bucket % SUB_BUCKETS + SUB_BUCKETS;
+  return top << shift;
+}
+
+} // namespace session
@@ -1,11 +1,12 @@
 #include "session/SessionManager.h"
 
+#include <ctime>
 #include <iostream>
 
 namespace session {
 
-SessionManager::SessionManager(int heartbeatTimeout)
-    : heartbeatTimeout_(heartbeatTimeout) {}
+SessionManager::SessionManager(int heartbeatTimeout, int resumeGrace)
+    : heartbeatTimeout_(heartbeatTimeout), resumeGrace_(resumeGrace) {}
 
 uint32_t SessionManager::createSession(int socketFd) {
   // check if socket already has a session
@@ -17,13 +18,13 @@ uint32_t SessionManager::createSession(int socketFd) {
   // generate new player ID
   uint32_t playerId = generatePlayerId();
 
-  // create new session
-  Session session(socketFd);
-  session.playerId = playerId;
-
-  // store session
-  sessions_[playerId] = std::move(session);
-  fdToPlayerId_[socketFd] = playerId;
+  // store session, reusing the node of a removed one
+  Session &stored = sessionNodes_.insert(sessions_, playerId).first->second;
+  stored.reset();
+  stored.socketFd = socketFd;
+  stored.playerId = playerId;
+  fdNodes_.insert(fdToPlayerId_, socketFd).first->second = playerId;
+  issueToken(stored);
 
   std::cout << "session created: playerId=" << playerId << ", fd=" << socketFd
             << std::endl;
@@ -37,12 +38,17 @@ bool SessionManager::removeSession(uint32_t playerId) {
     return false;
   }
 
-  // remove from fd map
+  // remove from fd and token maps, a detached session has no fd entry
   int socketFd = it->second.socketFd;
-  fdToPlayerId_.erase(socketFd);
+  if (!it->second.isDetached()) {
+    fdNodes_.erase(fdToPlayerId_, socketFd);
+  }
+  tokenNodes_.erase(tokenToPlayerId_,
+                    tokenKey(it->second.resumeToken.data()));
 
-  // remove session
-  sessions_.erase(it);
+  // remove session, its node is kept for the next one
+  receivePool_.release(it->second.receiveBuffer);
+  sessionNodes_.erase(sessions_, it);
 
   std::cout << "session removed: playerId=" << playerId << ", fd=" << socketFd
             << std::endl;
@@ -60,6 +66,116 @@ bool SessionManager::removeSessionByFd(int socketFd) {
   return removeSession(playerId);
 }
 
+bool SessionManager::detachSession(uint32_t playerId) {
+  Session *session = getSession(playerId);
+  if (session == nullptr) {
+    return false;
+  }
+  if (session->isDetached()) {
+    return true;
+  }
+
+  fdNodes_.erase(fdToPlayerId_, session->socketFd);
+  session->socketFd = -1;
+  session->detachedAt = std::time(nullptr);
+  receivePool_.release(session->receiveBuffer);
+
+  std::cout << "session detached: playerId=" << playerId << std::endl;
+
+  return true;
+}
+
+uint32_t SessionManager::resumeSession(const uint8_t *token,
+                                       uint32_t freshPlayerId,
+                                       int &previousFd) {
+  previousFd = -1;
+  auto tokenIt = tokenToPlayerId_.find(tokenKey(token));
+  Session *fresh = getSession(freshPlayerId);
+  if (tokenIt == tokenToPlayerId_.end() || fresh == nullptr ||
+      fresh->isDetached() || tokenIt->second == freshPlayerId) {
+    return 0;
+  }
+  uint32_t playerId = tokenIt->second;
+  Session *session = getSession(playerId);
+  if (session == nullptr) {
+    return 0;
+  }
+
+  // compare every byte so timing does not tell how much of a guess matched
+  uint8_t diff = 0;
+  for (size_t i = 0; i < session->resumeToken.size(); ++i) {
+    diff |= static_cast<uint8_t>(session->resumeToken[i] ^ token[i]);
+  }
+  if (diff != 0) {
+    return 0;
+  }
+
+  // a connection the server has not seen drop yet is taken over
+  if (!session->isDetached()) {
+    previousFd = session->socketFd;
+    fdNodes_.erase(fdToPlayerId_, session->socketFd);
+  }
+
+  int socketFd = fresh->socketFd;
+  session->receiveBuffer.swap(fresh->receiveBuffer);
+  removeSession(freshPlayerId);
+
+  session->socketFd = socketFd;
+  session->detachedAt = 0;
+  session->rtt.pingSentNs = 0;
+  session->rate = RateController();
+  session->updateHeartbeat();
+  fdNodes_.insert(fdToPlayerId_, socketFd).first->second = playerId;
+
+  tokenNodes_.erase(tokenToPlayerId_, tokenKey(session->resumeToken.data()));
+  issueToken(*session);
+
+  std::cout << "session resumed: playerId=" << playerId << ", fd=" << socketFd
+            << std::endl;
+
+  return playerId;
+}
+
+size_t SessionManager::checkDetached() {
+  expired_.clear();
+  time_t now = std::time(nullptr);
+
+  for (const auto &[playerId, session] : sessions_) {
+    if (session.isDetached() &&
+        std::difftime(now, session.detachedAt) > resumeGrace_) {
+      expired_.push_back(playerId);
+    }
+  }
+
+  // the callback releases the room and queue state the session kept
+  for (uint32_t playerId : expired_) {
+    std::cout << "session resume expired: playerId=" << playerId << std::endl;
+
+    if (timeoutCallback_) {
+      timeoutCallback_(playerId);
+    }
+
+    removeSession(playerId);
+  }
+
+  return expired_.size();
+}
+
+void SessionManager::appendToReceiveBuffer(Session &session,
+                                           const uint8_t *data, size_t len) {
+  receivePool_.reserve(session.receiveBuffer,
+                       session.receiveBuffer.size() + len);
+  session.appendToReceiveBuffer(data, len);
+}
+
+void SessionManager::consumeReceiveBuffer(Session &session, size_t len) {
+  if (len >= session.receiveBuffer.size()) {
+    receivePool_.release(session.receiveBuffer);
+  } else {
+    session.consumeReceiveBuffer(len);
+  }
+}
+
 Session *SessionManager::getSession(uint32_t playerId) {
   auto it = sessions_.find(playerId);
   if (it == sessions_.end()) {
@@ -149,6 +265,17 @@ std::vector<uint32_t> SessionManager::checkTimeouts() {
   return timedOut;
 }
 
+bool SessionManager::recordPong(uint32_t playerId, uint32_t sequence,
+                                uint64_t sentNs, uint64_t nowNs) {
+  Session *session = getSession(playerId);
+  if (session == nullptr || !session->rtt.onPong(sequence, sentNs, nowNs)) {
+    return false;
+  }
+
+  latency_.record(session->rtt.lastNs);
+  return true;
+}
+
 bool SessionManager::setPlayerRoom(uint32_t playerId, uint32_t roomId) {
   Session *session = getSession(playerId);
   if (session == nullptr) {
@@ -184,6 +311,38 @@ std::vector<uint32_t> SessionManager::getAuthenticatedPlayers() const {
   return players;
 }
 
+network::Span<const uint32_t>
+SessionManager::getPlayersInRoom(uint32_t roomId,
+                                 network::Arena &arena) const {
+  // count first, the arena can not grow an array in place
+  size_t count = 0;
+  for (const auto &[playerId, session] : sessions_) {
+    count += session.roomId == roomId ? 1 : 0;
+  }
+
+  network::Span<uint32_t> players = arena.allocateArray<uint32_t>(count);
+  size_t i = 0;
+  for (const auto &[playerId, session] : sessions_) {
+    if (session.roomId == roomId) {
+      players[i++] = playerId;
+    }
+  }
+  return {players.data, players.size};
+}
+
+network::Span<const uint32_t>
+SessionManager::getAuthenticatedPlayers(network::Arena &arena) const {
+  network::Span<uint32_t> players =
+      arena.allocateArray<uint32_t>(getAuthenticatedCount());
+  size_t i = 0;
+  for (const auto &[playerId, session] : sessions_) {
+    if (session.isAuthenticated) {
+      players[i++] = playerId;
+    }
+  }
+  return {players.data, players.size};
+}
+
 size_t SessionManager::getAuthenticatedCount() const {
   size_t count = 0;
 
@@ -196,6 +355,32 @@ size_t SessionManager::getAuthenticatedCount() const {
   return count;
 }
 
+void SessionManager::issueToken(Session &session) {
+  // retry on the unlikely clash of lookup keys
+  while (true) {
+    for (size_t i = 0; i < session.resumeToken.size(); i += 4) {
+      uint32_t bits = random_();
+      for (size_t j = 0; j < 4; ++j) {
+        session.resumeToken[i + j] = static_cast<uint8_t>(bits >> (8 * j));
+      }
+    }
+    auto result = tokenNodes_.insert(tokenToPlayerId_,
+                                     tokenKey(session.resumeToken.data()));
+    if (result.second) {
+      result.first->second = session.playerId;
+      return;
+    }
+  }
+}
+
+uint64_t SessionManager::tokenKey(const uint8_t *token) {
+  uint64_t key = 0;
+  for (int i = 0; i < 8; ++i) {
+    key |= static_cast<uint64_t>(token[i]) << (8 * i);
+  }
+  return key;
+}
+
 uint32_t SessionManager::generatePlayerId() {
   // simple incrementing ID (could be improved with UUID or random generation)
   return nextPlayerId_++;
@@ -0,0 +1,164 @@
+#include "bot/Evaluator.h"
+#include "game/BoardBatch.h"
+#include "game/Piece.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace {
+
+constexpr int ROWS = game::BOARD_HEIGHT + game::BOARD_BUFFER;
+
+const char *const LEVEL_NAMES[] = {"scalar", "sse2", "avx2"};
+
+void printUsage(const char *program) {
+  std::cerr << "usage: " << program << " [-n rounds] [-s seed]" << std::endl;
+}
+
+/**
+ * fill a board with a random stack, full rows and buffer blocks included
+ * @param board board to fill
+ * @param rng random generator
+ */
+void randomBoard(game::Board &board, std::mt19937 &rng) {
+  board.clear();
+  int height = static_cast<int>(rng() % (ROWS + 1));
+  int density = static_cast<int>(rng() % 8);
+  for (int y = 0; y < height; ++y) {
+    bool full = rng() % 6 == 0;
+    for (int x = 0; x < game::BOARD_WIDTH; ++x) {
+      if (full || static_cast<int>(rng() % 8) < density) {
+        board.setCell(x, y, static_cast<uint8_t>(1 + rng() % 8));
+      }
+    }
+  }
+}
+
+/**
+ * compare every batch kernel and the batch evaluator against the scalar
+ * Board, Piece and Evaluator methods
+ * @param boards one board per lane
+ * @param evaluator evaluator to compare
+ * @return number of mismatches
+ */
+int checkBatch(const std::array<game::Board, game::BATCH_LANES> &boards,
+               const bot::Evaluator &evaluator) {
+  int mismatches = 0;
+  game::BoardBatch batch;
+  for (int lane = 0; lane < game::BATCH_LANES; ++lane) {
+    batch.load(lane, boards[lane]);
+  }
+
+  // collision at every position a search can try
+  for (int type = game::CELL_I; type <= game::CELL_L; ++type) {
+    for (int rotation = 0; rotation < 4; ++rotation) {
+      for (int y = -1; y <= ROWS + 1; ++y) {
+        for (int x = -4; x <= game::BOARD_WIDTH; ++x) {
+          auto pieceType = static_cast<game::CellType>(type);
+          auto pieceRotation = static_cast<game::Rotation>(rotation);
+          uint32_t lanes = batch.collides(pieceType, pieceRotation, x, y);
+          for (int lane = 0; lane < game::BATCH_LANES; ++lane) {
+            bool expected = game::Piece::collides(boards[lane], pieceType,
+                                                  pieceRotation, x, y);
+            mismatches += ((lanes >> lane & 1) != 0) != expected;
+          }
+        }
+      }
+    }
+  }
+
+  game::BoardBatch::LaneMasks fullRows;
+  game::BoardBatch::LaneHeights heights;
+  game::BoardBatch::LaneCounts holes;
+  batch.fullRows(fullRows);
+  batch.columnHeights(heights);
+  batch.holeCounts(holes);
+  for (int lane = 0; lane < game::BATCH_LANES; ++lane) {
+    const game::Board &board = boards[lane];
+    for (int y = 0; y < ROWS; ++y) {
+      mismatches += ((fullRows[lane] >> y & 1) != 0) != board.isRowFull(y);
+    }
+    for (int x = 0; x < game::BOARD_WIDTH; ++x) {
+      mismatches += heights[lane][x] != board.getColumnHeight(x);
+    }
+    mismatches += holes[lane] != bot::Evaluator::computeFeatures(board).holes;
+  }
+
+  // line clears, then scores of the cleared boards
+  game::BoardBatch::LaneCounts cleared;
+  batch.clearFullRows(cleared);
+  std::array<int, game::BATCH_LANES> lines{};
+  std::array<game::Board, game::BATCH_LANES> after = boards;
+  for (int lane = 0; lane < game::BATCH_LANES; ++lane) {
+    lines[lane] = after[lane].clearFullRows();
+    mismatches += cleared[lane] != lines[lane];
+    for (int y = 0; y < ROWS; ++y) {
+      mismatches += batch.getRowMask(lane, y) != after[lane].getRowMask(y);
+    }
+  }
+
+  std::array<double, game::BATCH_LANES> scores{};
+  evaluator.evaluateBatch(batch, game::BATCH_LANES, lines.data(),
+                          scores.data());
+  for (int lane = 0; lane < game::BATCH_LANES; ++lane) {
+    // bit identical, not approximately equal
+    mismatches += scores[lane] != evaluator.evaluate(after[lane], lines[lane]);
+  }
+
+  return mismatches;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  int rounds = 50;
+  uint32_t seed = 1;
+
+  // process command line argument
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    try {
+      if (arg == "-n" && i + 1 < argc) {
+        rounds = std::max(1, std::stoi(argv[++i]));
+      } else if (arg == "-s" && i + 1 < argc) {
+        seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+      } else {
+        printUsage(argv[0]);
+        return 1;
+      }
+    } catch (const std::exception &e) {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  bot::Evaluator evaluator;
+  game::SimdLevel best = game::BoardBatch::detectSimdLevel();
+  int failures = 0;
+
+  // every level the cpu supports runs the same boards
+  for (int level = 0; level <= static_cast<int>(best); ++level) {
+    game::BoardBatch::setSimdLevel(static_cast<game::SimdLevel>(level));
+    std::mt19937 rng(seed);
+    std::array<game::Board, game::BATCH_LANES> boards;
+    int mismatches = 0;
+    for (int round = 0; round < rounds; ++round) {
+      for (game::Board &board : boards) {
+        randomBoard(board, rng);
+      }
+      mismatches += checkBatch(boards, evaluator);
+    }
+
+    std::cout << LEVEL_NAMES[level] << ": " << rounds << " batches, "
+              << mismatches << " mismatches" << std::endl;
+    failures += mismatches;
+  }
+  game::BoardBatch::setSimdLevel(best);
+
+  return failures == 0 ? 0 : 1;
+}
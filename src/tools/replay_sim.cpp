@@ -0,0 +1,192 @@
+#include "replay/ReplayArchive.h"
+#include "replay/ReplaySimulator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/**
+ * ReplayJob stores a replay to simulate and its result.
+ * data points into storage for loose files or into a mapped archive.
+ */
+struct ReplayJob {
+  std::string name;
+  std::vector<uint8_t> storage;
+  const uint8_t *data = nullptr;
+  size_t len = 0;
+  replay::SimulationResult result;
+};
+
+void printUsage(const char *program) {
+  std::cerr << "usage: " << program
+            << " [-j threads] [-n repeat] <replay file|archive directory>..."
+            << std::endl;
+}
+
+bool isDirectory(const std::string &path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool loadFile(const std::string &path, std::vector<uint8_t> &data) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  data.assign(std::istreambuf_iterator<char>(file),
+              std::istreambuf_iterator<char>());
+  return true;
+}
+
+/**
+ * add every game of an archive as jobs
+ * @return true if the archive was opened
+ */
+bool addArchive(const std::string &path,
+                std::vector<std::unique_ptr<replay::ArchiveReader>> &archives,
+                std::vector<ReplayJob> &jobs) {
+  auto archive = std::make_unique<replay::ArchiveReader>();
+  if (!archive->open(path)) {
+    return false;
+  }
+  for (size_t i = 0; i < archive->getGameCount(); ++i) {
+    replay::ArchiveIndexEntry entry;
+    if (!archive->getEntry(i, entry)) {
+      continue;
+    }
+    ReplayJob job;
+    job.name = path + "#" + std::to_string(entry.gameId);
+    job.data = archive->getReplay(entry);
+    job.len = entry.replayLength;
+    jobs.push_back(std::move(job));
+  }
+  archives.push_back(std::move(archive));
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+  size_t repeat = 1;
+  std::vector<std::string> paths;
+
+  // process command line argument
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    try {
+      if (arg == "-j" && i + 1 < argc) {
+        threadCount = std::max(1, std::stoi(argv[++i]));
+      } else if (arg == "-n" && i + 1 < argc) {
+        repeat = std::max(1, std::stoi(argv[++i]));
+      } else if (!arg.empty() && arg[0] == '-') {
+        printUsage(argv[0]);
+        return 1;
+      } else {
+        paths.push_back(arg);
+      }
+    } catch (const std::exception &e) {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (paths.empty()) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  // load everything first so timing covers simulation only
+  std::vector<std::unique_ptr<replay::ArchiveReader>> archives;
+  std::vector<ReplayJob> jobs;
+  for (const std::string &path : paths) {
+    if (isDirectory(path)) {
+      if (!addArchive(path, archives, jobs)) {
+        std::cerr << "failed to open archive " << path << std::endl;
+      }
+      continue;
+    }
+    ReplayJob job;
+    job.name = path;
+    if (!loadFile(path, job.storage)) {
+      std::cerr << "failed to read " << path << std::endl;
+    }
+    job.data = job.storage.data();
+    job.len = job.storage.size();
+    jobs.push_back(std::move(job));
+  }
+  if (jobs.empty()) {
+    std::cerr << "no replays found" << std::endl;
+    return 1;
+  }
+
+  // workers pull (job, repetition) indices from a shared counter
+  size_t total = jobs.size() * repeat;
+  std::atomic<size_t> nextIndex{0};
+  std::atomic<uint64_t> totalFrames{0};
+  threadCount = std::min(threadCount, total);
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  workers.reserve(threadCount);
+  for (size_t t = 0; t < threadCount; ++t) {
+    workers.emplace_back([&]() {
+      replay::ReplaySimulator simulator;
+      replay::SimulationResult result;
+      uint64_t frames = 0;
+      size_t index;
+      while ((index = nextIndex.fetch_add(1)) < total) {
+        ReplayJob &job = jobs[index % jobs.size()];
+        simulator.run(job.data, job.len, result);
+        frames += result.frames;
+        if (index < jobs.size()) {
+          job.result = result; // first repetition owns the report
+        }
+      }
+      totalFrames.fetch_add(frames);
+    });
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  // per-game report
+  size_t failed = 0;
+  for (const ReplayJob &job : jobs) {
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx",
+                  static_cast<unsigned long long>(job.result.finalHash));
+    std::cout << job.name << " players=" << job.result.slotHashes.size()
+              << " frames=" << job.result.frames
+              << " duration=" << job.result.durationMs << "ms hash=" << hash
+              << (job.result.complete ? "" : " INCOMPLETE") << std::endl;
+    if (!job.result.complete) {
+      ++failed;
+    }
+  }
+
+  uint64_t frames = totalFrames.load();
+  double framesPerSecond = seconds > 0 ? frames / seconds : 0.0;
+  std::cout << "games: " << total << " (" << jobs.size() << " x " << repeat
+            << "), threads: " << threadCount << ", frames: " << frames
+            << ", time: " << seconds << "s" << std::endl;
+  std::cout << "throughput: " << static_cast<uint64_t>(framesPerSecond)
+            << " frames/s, "
+            << static_cast<uint64_t>(framesPerSecond / threadCount)
+            << " frames/s per thread" << std::endl;
+
+  return failed == 0 ? 0 : 2;
+}